@@ -0,0 +1,75 @@
+@tool
+extends EditorImportPlugin
+
+## Import plugin that converts SM64 decomp collision sources ([code].inc.c[/code] files using the [code]COL_*[/code] macros)
+## into [LibSM64SurfaceArray] resources, using [LibSM64CollisionParser].
+## The surfaces are kept in native SM64 units, so they are never rescaled.
+## Only files renamed to the [code].sm64col[/code] extension are imported, so other C sources in the project are left alone
+## (Godot picks importers by the last extension only, so a suffix such as [code].col.c[/code] can't be told apart from [code].c[/code]).
+
+
+func _get_importer_name() -> String:
+	return "libsm64.decomp_collision"
+
+
+func _get_visible_name() -> String:
+	return "LibSM64 Decomp Collision"
+
+
+func _get_recognized_extensions() -> PackedStringArray:
+	return ["sm64col"]
+
+
+func _get_save_extension() -> String:
+	return "sm64surf"
+
+
+func _get_resource_type() -> String:
+	return "LibSM64SurfaceArray"
+
+
+func _get_priority() -> float:
+	return 1.0
+
+
+func _get_import_order() -> int:
+	return 0
+
+
+func _get_preset_count() -> int:
+	return 1
+
+
+func _get_preset_name(_preset_index: int) -> String:
+	return "Default"
+
+
+func _get_import_options(_path: String, _preset_index: int) -> Array[Dictionary]:
+	return [
+		{
+			name = "terrain_type",
+			default_value = LibSM64.TERRAIN_GRASS,
+			property_hint = PROPERTY_HINT_ENUM,
+			hint_string = "Grass,Stone,Snow,Sand,Spooky,Water,Slide,Mask",
+		},
+		{
+			name = "compress",
+			default_value = true,
+		},
+	]
+
+
+func _get_option_visibility(_path: String, _option_name: StringName, _options: Dictionary) -> bool:
+	return true
+
+
+func _import(source_file: String, save_path: String, options: Dictionary, _platform_variants: Array[String], _gen_files: Array[String]) -> Error:
+	var parser := LibSM64CollisionParser.new()
+	parser.terrain_type = options.terrain_type
+
+	var surface_array := parser.parse_file(source_file)
+	if not surface_array:
+		return ERR_PARSE_ERROR
+
+	var flags := ResourceSaver.FLAG_COMPRESS if options.compress else ResourceSaver.FLAG_NONE
+	return ResourceSaver.save(surface_array, "%s.%s" % [save_path, _get_save_extension()], flags)
@@ -0,0 +1,95 @@
+@tool
+extends EditorExportPlugin
+
+## Export plugin that bakes the [code]libsm64[/code] surfaces of nodes in the static surfaces and surface objects groups of exported scenes.
+## The surfaces of each node are stored in the node's local space as [constant LibSM64SurfaceHandlerBase.BAKED_SURFACES_META] metadata,
+## so [LibSM64StaticSurfacesHandler] and [LibSM64SurfaceObjectsHandler] don't need to extract and convert them at runtime.
+## Surfaces are baked with the default [LibSM64FaceExtractor] tessellation settings.
+
+
+## Default groups of [LibSM64StaticSurfacesHandler] and [LibSM64SurfaceObjectsHandler], used along with the groups set in the handlers of each scene.
+const DEFAULT_SURFACE_GROUPS: Array[StringName] = [&"libsm64_static_surfaces", &"libsm64_surface_objects"]
+
+
+var _face_extractor: LibSM64FaceExtractor
+
+
+func _get_name() -> String:
+	return "LibSM64SurfacesExportPlugin"
+
+
+func _begin_customize_scenes(_platform: EditorExportPlatform, _features: PackedStringArray) -> bool:
+	_face_extractor = LibSM64FaceExtractor.new()
+	return true
+
+
+func _end_customize_scenes() -> void:
+	_face_extractor = null
+
+
+func _get_customization_configuration_hash() -> int:
+	# Baked surfaces depend on the scale factor they were converted with
+	return hash(LibSM64.scale_factor)
+
+
+func _customize_scene(scene: Node, _path: String) -> Node:
+	var groups := _find_surface_groups(scene)
+
+	var baked := false
+	for node in _get_scene_nodes(scene):
+		var node_3d := node as Node3D
+		if not node_3d or not _is_in_any_group(node_3d, groups):
+			continue
+		baked = _bake_node(node_3d) or baked
+
+	# Returning null keeps the original scene
+	return scene if baked else null
+
+
+func _find_surface_groups(scene: Node) -> Array[StringName]:
+	var groups: Array[StringName] = DEFAULT_SURFACE_GROUPS.duplicate()
+	for node in _get_scene_nodes(scene):
+		var group: Variant = null
+		if node is LibSM64StaticSurfacesHandler:
+			group = node.get(&"static_surfaces_group")
+		elif node is LibSM64SurfaceObjectsHandler:
+			group = node.get(&"surface_objects_group")
+		if group != null and not groups.has(StringName(group)):
+			groups.push_back(StringName(group))
+	return groups
+
+
+func _get_scene_nodes(scene: Node) -> Array[Node]:
+	var nodes: Array[Node] = [scene]
+	nodes.append_array(scene.find_children("*", "", true, false))
+	return nodes
+
+
+func _is_in_any_group(node: Node, groups: Array[StringName]) -> bool:
+	for group in groups:
+		if node.is_in_group(group):
+			return true
+	return false
+
+
+func _bake_node(node: Node3D) -> bool:
+	# CSG meshes are only built once the node is inside the tree, leave them to the runtime conversion
+	if node is CSGShape3D:
+		return false
+
+	var faces := _face_extractor.get_node_faces(node)
+	if faces.is_empty():
+		return false
+
+	var surface_array := LibSM64SurfaceArray.new()
+	surface_array.add_faces(faces, Transform3D(), _find_surface_properties(node))
+	node.set_meta(LibSM64SurfaceHandlerBase.BAKED_SURFACES_META, surface_array)
+	return true
+
+
+# Handler scripts aren't tool scripts, so read the component's property generically
+func _find_surface_properties(node: Node) -> LibSM64SurfaceProperties:
+	for child in node.get_children():
+		if child is LibSM64SurfacePropertiesComponent:
+			return child.get(&"surface_properties") as LibSM64SurfaceProperties
+	return null
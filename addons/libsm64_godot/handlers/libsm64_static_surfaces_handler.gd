@@ -12,7 +12,9 @@ extends LibSM64SurfaceHandlerBase
 ## [b]Note:[/b] calling this function multiple times will overwrite the previous calls.
 ## [b]Warning:[/b] These surfaces will delimit the bounderies of the [code]libsm64[/code] world in the XZ plane. This means that Mario can only be above theses surfaces and will hit "invisible walls" at the edges of the world.
 func load_static_surfaces() -> void:
-	var libsm64_surface_array := LibSM64SurfaceArray.new()
+	var nodes: Array[Node3D] = []
+	var properties: Array[LibSM64SurfaceProperties] = []
+	var baked_nodes: Array[Node3D] = []
 
 	for node in get_tree().get_nodes_in_group(static_surfaces_group):
 		var node_3d := node as Node3D
@@ -20,19 +22,18 @@ func load_static_surfaces() -> void:
 			push_error("Non Node3D %s in %s group" % [node, static_surfaces_group])
 			continue
 
-		var properties := find_surface_properties(node_3d)
-		var faces := get_faces_from_node(node_3d)
-		if faces.is_empty():
-			push_error("Faces array empty, skipping node %s" % node_3d.name)
+		if get_baked_surfaces(node_3d):
+			baked_nodes.push_back(node_3d)
 			continue
 
-		for i in range(0, faces.size(), 3):
-			var v1 := node_3d.global_transform * faces[i + 0]
-			var v2 := node_3d.global_transform * faces[i + 1]
-			var v3 := node_3d.global_transform * faces[i + 2]
-			if properties:
-				libsm64_surface_array.add_triangle_with_properties(v1, v2, v3, properties)
-			else:
-				libsm64_surface_array.add_triangle(v1, v2, v3)
+		nodes.push_back(node_3d)
+		properties.push_back(find_surface_properties(node_3d))
+
+	# Faces are extracted and converted in parallel, then merged in group order
+	var libsm64_surface_array := face_extractor.build_surface_array(nodes, properties)
+
+	# Surfaces baked at export time only need to be placed in the world
+	for node_3d in baked_nodes:
+		libsm64_surface_array.append_surfaces(get_baked_surfaces(node_3d), node_3d.global_transform)
 
 	LibSM64.static_surfaces_load(libsm64_surface_array)
@@ -9,6 +9,16 @@ extends Node
 const UNIT_BOX_SHAPE_3D_FACES: PackedVector3Array = [Vector3(-0.5, 0.5, 0.5), Vector3(0.5, 0.5, 0.5), Vector3(-0.5, -0.5, 0.5), Vector3(0.5, 0.5, 0.5), Vector3(0.5, -0.5, 0.5), Vector3(-0.5, -0.5, 0.5), Vector3(0.5, 0.5, -0.5), Vector3(-0.5, 0.5, -0.5), Vector3(0.5, -0.5, -0.5), Vector3(-0.5, 0.5, -0.5), Vector3(-0.5, -0.5, -0.5), Vector3(0.5, -0.5, -0.5), Vector3(0.5, 0.5, 0.5), Vector3(0.5, 0.5, -0.5), Vector3(0.5, -0.5, 0.5), Vector3(0.5, 0.5, -0.5), Vector3(0.5, -0.5, -0.5), Vector3(0.5, -0.5, 0.5), Vector3(-0.5, 0.5, -0.5), Vector3(-0.5, 0.5, 0.5), Vector3(-0.5, -0.5, -0.5), Vector3(-0.5, 0.5, 0.5), Vector3(-0.5, -0.5, 0.5), Vector3(-0.5, -0.5, -0.5), Vector3(0.5, 0.5, 0.5), Vector3(-0.5, 0.5, 0.5), Vector3(0.5, 0.5, -0.5), Vector3(-0.5, 0.5, 0.5), Vector3(-0.5, 0.5, -0.5), Vector3(0.5, 0.5, -0.5), Vector3(-0.5, -0.5, 0.5), Vector3(0.5, -0.5, 0.5), Vector3(-0.5, -0.5, -0.5), Vector3(0.5, -0.5, 0.5), Vector3(0.5, -0.5, -0.5), Vector3(-0.5, -0.5, -0.5)]
 
 
+## Name of the metadata holding the surfaces baked at export time by the [code]libsm64[/code] export plugin. See [method get_baked_surfaces].
+const BAKED_SURFACES_META := &"libsm64_baked_surfaces"
+
+
+## Shared native face extractor used by the handlers. Its tessellation settings
+## ([member LibSM64FaceExtractor.radial_segments], [member LibSM64FaceExtractor.rings] and
+## [member LibSM64FaceExtractor.world_boundary_bounds]) apply to every handler.
+static var face_extractor := LibSM64FaceExtractor.new()
+
+
 ## Find a [LibSM64SurfacePropertiesComponent] child in the given node and return its [LibSM64SurfaceProperties]
 static func find_surface_properties(node: Node) -> LibSM64SurfaceProperties:
 	for child in node.get_children():
@@ -17,60 +27,32 @@ static func find_surface_properties(node: Node) -> LibSM64SurfaceProperties:
 	return null
 
 
-## Get the faces from supported nodes (support for [MeshInstance3D] and partial support for [CollisionObject3D] and [CollisionShape3D])
+## Return the [LibSM64SurfaceArray] baked into [param node] at export time, in the node's local space, or [code]null[/code] if the node wasn't baked.
+## Baked surfaces skip face extraction and conversion at runtime.
+static func get_baked_surfaces(node: Node) -> LibSM64SurfaceArray:
+	return node.get_meta(BAKED_SURFACES_META, null) as LibSM64SurfaceArray
+
+
+## Get the faces from supported nodes ([MeshInstance3D], [MultiMeshInstance3D], root [CSGShape3D], [GridMap], [CollisionObject3D] and [CollisionShape3D]). See [method LibSM64FaceExtractor.get_node_faces].
 static func get_faces_from_node(node: Node3D) -> PackedVector3Array:
-	if node is CollisionObject3D:
-		return get_faces_from_collision_object_3d(node)
-	elif node is CollisionShape3D:
-		return get_faces_from_collision_shape_3d(node)
-	elif node is MeshInstance3D:
-		return node.get_mesh().get_faces()
-	else:
-		push_error("Unsupported node (%s) type: %s" % [node.name, node.get_class()])
-		return PackedVector3Array()
+	return face_extractor.get_node_faces(node)
 
 
 ## Get the faces from a [CollisionObject3D] (which can contain multiple [CollisionShape3D])
 static func get_faces_from_collision_object_3d(collision_object: CollisionObject3D) -> PackedVector3Array:
-	var faces := PackedVector3Array()
-	for node in collision_object.get_children():
-		var collision_shape := node as CollisionShape3D
-		if not collision_shape:
-			continue
-		var collision_shape_faces := get_faces_from_collision_shape_3d(collision_shape)
-		# Apply the local transform of the CollisionShape3D to the faces, since we want them in relation to their parent
-		faces.append_array(transform_packed_vector3_array(collision_shape_faces, collision_shape.transform))
-	return faces
-
-
-## Get the faces from a [CollisionShape3D] (support for [BoxShape3D] and [ConcavePolygonShape3D] currently)
+	return face_extractor.get_node_faces(collision_object)
+
+
+## Get the faces from a [CollisionShape3D] (support for every [Shape3D] type, see [method LibSM64FaceExtractor.get_shape_faces])
 static func get_faces_from_collision_shape_3d(collision_shape: CollisionShape3D) -> PackedVector3Array:
-	var shape = collision_shape.shape
-	if shape is BoxShape3D:
-		return get_faces_from_box_shape_3d(shape)
-	elif shape is ConcavePolygonShape3D:
-		return shape.get_faces()
-	else:
-		push_error("Unsupported shape type: ", shape.get_class())
-		return PackedVector3Array()
+	return face_extractor.get_shape_faces(collision_shape.shape)
 
 
 ## Get the faces from a [BoxShape3D]
 static func get_faces_from_box_shape_3d(box: BoxShape3D) -> PackedVector3Array:
-	var faces := PackedVector3Array()
-	var faces_size := UNIT_BOX_SHAPE_3D_FACES.size()
-	faces.resize(faces_size)
-	for i in range(faces_size):
-		# Copy the unit BoxShape3D faces vertices, scaling them to the size of the box
-		faces.set(i, UNIT_BOX_SHAPE_3D_FACES[i] * box.size)
-	return faces
+	return face_extractor.get_shape_faces(box)
 
 
 ## Apply a [Transform3D] to a all elements of a [PackedVector3Array]
 static func transform_packed_vector3_array(array: PackedVector3Array, transform: Transform3D) -> PackedVector3Array:
-	var ret := PackedVector3Array()
-	var size := array.size()
-	ret.resize(size)
-	for i in range(size):
-		ret.set(i, transform * array[i])
-	return ret
+	return transform * array
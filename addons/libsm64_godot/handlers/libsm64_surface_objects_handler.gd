@@ -4,14 +4,37 @@ extends LibSM64SurfaceHandlerBase
 ## Node that handles adding and updating nodes as Surface Objects for libsm64.
 
 
+## Emitted when all surface objects queued by [method load_surface_object_async] or [method load_all_surface_objects_async] are created.
+signal surface_objects_loaded
+
+
 ## Group name that contains the nodes that are part of the scene's surface objects.
 @export var surface_objects_group := &"libsm64_surface_objects"
+## Milliseconds per frame spent creating surface objects queued by [method load_surface_object_async].
+@export_range(0.1, 16.0, 0.1, "or_greater") var async_budget_msec := 2.0
 
 
 var _surface_objects_map := {}
+# Nodes sharing the same shapes or meshes share a single surface array
+var _surface_templates := LibSM64SurfaceTemplateCache.new()
+var _surface_object_queue := LibSM64SurfaceObjectQueue.new()
 var _time_since_last_tick := 0.0
 
 
+func _init() -> void:
+	_surface_templates.face_extractor = face_extractor
+	_surface_object_queue.face_extractor = face_extractor
+	_surface_object_queue.template_cache = _surface_templates
+	_surface_object_queue.surface_object_created.connect(_register_surface_object)
+	_surface_object_queue.finished.connect(surface_objects_loaded.emit)
+
+
+func _process(_delta: float) -> void:
+	if _surface_object_queue.get_pending_count() > 0:
+		_surface_object_queue.budget_msec = async_budget_msec
+		_surface_object_queue.process()
+
+
 func _physics_process(delta: float) -> void:
 	_time_since_last_tick += delta
 	if _time_since_last_tick >= LibSM64.tick_delta_time:
@@ -21,39 +44,49 @@ func _physics_process(delta: float) -> void:
 
 
 func _update_surface_objects() -> void:
+	if _surface_objects_map.is_empty():
+		return
+
+	# Objects that didn't move since the last tick are skipped natively
+	var transforms := []
+	transforms.resize(_surface_objects_map.size())
+	var i := 0
 	for node in _surface_objects_map:
-		var id := _surface_objects_map[node] as int
-		var transform := node.global_transform as Transform3D
-		var position := transform.origin
-		var rotation := transform.basis.get_rotation_quaternion()
-		LibSM64.surface_object_move(id, position, rotation)
+		transforms[i] = node.global_transform
+		i += 1
+	LibSM64.surface_object_move_batch(PackedInt32Array(_surface_objects_map.values()), transforms)
 
 
 ## Load a node as a surface object in the [code]libsm64[/code] world.
 func load_surface_object(node: Node3D) -> void:
-	var libsm64_surface_array := LibSM64SurfaceArray.new()
+	var libsm64_surface_array := get_baked_surfaces(node)
 
-	var faces := get_faces_from_node(node)
-	if faces.is_empty():
-		push_error("Node %s has no faces." % node.name)
-		return
+	if not libsm64_surface_array:
+		libsm64_surface_array = _surface_templates.get_node_surfaces(node, find_surface_properties(node))
+		if not libsm64_surface_array or libsm64_surface_array.get_surface_count() == 0:
+			push_error("Node %s has no faces." % node.name)
+			return
 
 	var transform := node.global_transform
 	var position := transform.origin
 	var rotation := transform.basis.get_rotation_quaternion()
-	var properties := find_surface_properties(node)
-
-	for i in range(0, faces.size(), 3):
-		var v1 := faces[i + 0]
-		var v2 := faces[i + 1]
-		var v3 := faces[i + 2]
-		if properties:
-			libsm64_surface_array.add_triangle_with_properties(v1, v2, v3, properties)
-		else:
-			libsm64_surface_array.add_triangle(v1, v2, v3)
 
 	var surface_object_id := LibSM64.surface_object_create(position, rotation, libsm64_surface_array)
 
+	_register_surface_object(node, surface_object_id)
+
+
+## Queue a node to be loaded as a surface object in the [code]libsm64[/code] world over the next frames.
+## Faces are converted on worker threads, once per surface template, and objects are created within [member async_budget_msec] per frame.
+func load_surface_object_async(node: Node3D) -> void:
+	_surface_object_queue.queue_node(node, find_surface_properties(node), get_baked_surfaces(node))
+
+
+func _register_surface_object(node: Node3D, surface_object_id: int) -> void:
+	# Creation failed, e.g. LibSM64.surface_object_capacity was reached
+	if surface_object_id < 0:
+		return
+
 	_surface_objects_map[node] = surface_object_id
 
 	# Clean up automaticaly if [Node3D] is removed from tree or freed
@@ -70,6 +103,17 @@ func load_all_surface_objects() -> void:
 		load_surface_object(node_3d)
 
 
+## Queue all nodes in the [member surface_objects_group] to be loaded as surface objects over the next frames, see [method load_surface_object_async].
+## [signal surface_objects_loaded] is emitted once all of them are created.
+func load_all_surface_objects_async() -> void:
+	for node in get_tree().get_nodes_in_group(surface_objects_group):
+		var node_3d := node as Node3D
+		if not node_3d:
+			push_warning("Non Node3D in %s group" % surface_objects_group)
+			continue
+		load_surface_object_async(node_3d)
+
+
 ## Delete a surface object created from the given [param node_3d] from the [code]libsm64[/code] world if present.
 func delete_surface_object(node_3d: Node3D) -> void:
 	var id := _surface_objects_map.get(node_3d, -1) as int
@@ -83,7 +127,7 @@ func delete_surface_object(node_3d: Node3D) -> void:
 
 ## Delete all surface objects from the [code]libsm64[/code] world.
 func delete_all_surface_objects() -> void:
-	for id in _surface_objects_map.values():
-		LibSM64.surface_object_delete(id)
+	_surface_object_queue.cancel()
+	LibSM64.surface_objects_delete(PackedInt32Array(_surface_objects_map.values()))
 
 	_surface_objects_map.clear()
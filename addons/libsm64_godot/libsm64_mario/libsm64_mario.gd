@@ -31,7 +31,35 @@ signal health_wedges_changed(health_wedges: int)
 ## if [code]true[/code], linearly interpolate Mario and transform
 ## from the SM64 engine's hardcoded 30 frames per second to the tick rate
 ## of the current [code]tick_process_mode[/code].
-@export var interpolate := true
+@export var interpolate := true:
+	set(value):
+		interpolate = value
+		if _id >= 0:
+			_update_interpolator_batch_membership()
+
+## Rendering mode used when [member interpolate] is [code]true[/code].
+## [constant LibSM64MarioInterpolator.MODE_EXTRAPOLATE] predicts Mario's pose past the
+## latest tick from his velocity, hiding the latency of interpolating between ticks.
+@export var interpolation_mode := LibSM64MarioInterpolator.MODE_INTERPOLATE:
+	set(value):
+		interpolation_mode = value
+		_mario_interpolator.mode = value
+		_mario_interpolator.extrapolate_mesh = value == LibSM64MarioInterpolator.MODE_EXTRAPOLATE
+
+## Seconds of ticks (states and geometry) kept in [member history] for rewinds and replays.
+## A value of [code]0.0[/code] disables the history.
+@export_range(0.0, 60.0, 0.1, "or_greater", "suffix:s") var history_length := 0.0:
+	set(value):
+		history_length = value
+		if history_length > 0.0:
+			if not history:
+				history = LibSM64MarioHistory.new()
+			history.capacity = ceili(history_length / LibSM64.tick_delta_time)
+		else:
+			history = null
+
+## Quantized history of Mario's last ticks, or [code]null[/code] if [member history_length] is [code]0.0[/code].
+var history: LibSM64MarioHistory
 
 @export_group("Mario Inputs Actions", "mario_inputs_")
 ## Action equivalent to pushing the joystick to the left.
@@ -173,9 +201,11 @@ var invincibility_time: float:
 			_mario_interpolator.mario_state_previous.invincibility_time = _invincibility_time
 
 var _water_level_in_libsm64 := -100000
-## The height of the water level in the [code]libsm64[/code] world for this Mario instance. If Mario is below this level, he will be considered swimming.
+## The height of the water level in the [code]libsm64[/code] world for this Mario instance. If Mario is below this level, he will be considered swimming. Set automatically while water volumes exist, see [method LibSM64.level_volume_add].
 var water_level: float:
 	get:
+		if _id >= 0:
+			return LibSM64.get_mario_water_level(_id)
 		return float(_water_level_in_libsm64) / LibSM64.scale_factor
 	set(value):
 		if _id < 0:
@@ -184,9 +214,11 @@ var water_level: float:
 		_water_level_in_libsm64 = int(value * LibSM64.scale_factor)
 
 var _gas_level_in_libsm64 := -100000
-## The height of the gas level in the [code]libsm64[/code] world for this Mario instance. If Mario is below this level, he will start coughing and take damage, eventually choking to death.
+## The height of the gas level in the [code]libsm64[/code] world for this Mario instance. If Mario is below this level, he will start coughing and take damage, eventually choking to death. Set automatically while gas volumes exist, see [method LibSM64.level_volume_add].
 var gas_level: float:
 	get:
+		if _id >= 0:
+			return LibSM64.get_mario_gas_level(_id)
 		return float(_gas_level_in_libsm64) / LibSM64.scale_factor
 	set(value):
 		if _id < 0:
@@ -196,6 +228,8 @@ var gas_level: float:
 
 var _mesh_instance: MeshInstance3D
 var _mesh: ArrayMesh
+var _mesh_array_mesh_triangles: Array
+var _mesh_material: StandardMaterial3D
 
 var _mario_interpolator := LibSM64MarioInterpolator.new()
 
@@ -204,10 +238,18 @@ var _vanish_material := preload("res://addons/libsm64_godot/libsm64_mario/libsm6
 var _metal_material := preload("res://addons/libsm64_godot/libsm64_mario/libsm64_mario_metal_material.tres") as StandardMaterial3D
 var _wing_material := preload("res://addons/libsm64_godot/libsm64_mario/libsm64_mario_wing_material.tres") as StandardMaterial3D
 
-var _time_since_last_tick := 0.0
-var _last_tick_usec := Time.get_ticks_usec()
 var _reset_interpolation_next_tick := false
 
+## Interpolator batch shared by all Marios, evaluated once per frame.
+static var _interpolator_batch := LibSM64MarioInterpolatorBatch.new()
+static var _interpolated_process_frame := -1
+
+## Tick clock shared by all Marios so every interpolator uses the same [code]lerp_t[/code].
+static var _time_since_last_tick := 0.0
+static var _last_tick_usec := Time.get_ticks_usec()
+static var _ticked_physics_frame := -1
+static var _ticks_this_physics_frame := 0
+
 
 func _ready() -> void:
 	## Mario's mesh vertices are in global space.
@@ -221,21 +263,38 @@ func _ready() -> void:
 	_mesh_instance.mesh = _mesh
 
 
+func _notification(what: int) -> void:
+	if what == NOTIFICATION_PREDELETE and _interpolator_batch.has_interpolator(_mario_interpolator):
+		_interpolator_batch.remove_interpolator(_mario_interpolator)
+
+
 func _process(delta: float) -> void:
 	if _id < 0:
 		return
 
-	var lerp_t = (Time.get_ticks_usec() - _last_tick_usec) / (LibSM64.tick_delta_time * 1000000.0)
+	if interpolate:
+		_interpolate_all_marios()
+
+	_update_lerped_members_from_mario_state()
+	_update_mesh()
+
+
+## Interpolate every Mario in a single native call, once per process frame.
+static func _interpolate_all_marios() -> void:
+	var process_frame := Engine.get_process_frames()
+	if process_frame == _interpolated_process_frame:
+		return
+	_interpolated_process_frame = process_frame
 
-	_update_lerped_members_from_mario_state(lerp_t)
-	_update_mesh(lerp_t)
+	var lerp_t := (Time.get_ticks_usec() - _last_tick_usec) / (LibSM64.tick_delta_time * 1000000.0)
+	_interpolator_batch.interpolate(lerp_t)
 
 
-func _update_lerped_members_from_mario_state(lerp_t: float) -> void:
+func _update_lerped_members_from_mario_state() -> void:
 	var mario_state: LibSM64MarioState
 	if interpolate:
-		mario_state = _mario_interpolator.interpolate_mario_state(lerp_t)
-	else:
+		mario_state = _mario_interpolator.get_interpolated_mario_state()
+	if not mario_state:
 		mario_state = _mario_interpolator.mario_state_current
 
 	global_position = mario_state.position
@@ -244,7 +303,7 @@ func _update_lerped_members_from_mario_state(lerp_t: float) -> void:
 	_invincibility_time = mario_state.invincibility_time
 
 
-func _update_mesh(lerp_t: float) -> void:
+func _update_mesh() -> void:
 	var material: StandardMaterial3D
 	match _flags & LibSM64.MARIO_SPECIAL_CAPS:
 		LibSM64.MARIO_VANISH_CAP :
@@ -258,11 +317,17 @@ func _update_mesh(lerp_t: float) -> void:
 
 	var array_mesh_triangles: Array
 	if interpolate:
-		array_mesh_triangles = _mario_interpolator.interpolate_array_mesh_triangles(lerp_t)
-	else:
+		array_mesh_triangles = _mario_interpolator.get_interpolated_array_mesh_triangles()
+	if array_mesh_triangles.is_empty():
 		array_mesh_triangles = _mario_interpolator.array_mesh_triangles_current
 
+	# Unchanged geometry (e.g. an idle Mario) is handed out as the same array, skip the upload
+	if is_same(array_mesh_triangles, _mesh_array_mesh_triangles) and material == _mesh_material:
+		return
+
 	if not array_mesh_triangles.is_empty() and not array_mesh_triangles[ArrayMesh.ARRAY_VERTEX].is_empty():
+		_mesh_array_mesh_triangles = array_mesh_triangles
+		_mesh_material = material
 		_mesh.clear_surfaces()
 		_mesh.add_surface_from_arrays(Mesh.PRIMITIVE_TRIANGLES, array_mesh_triangles)
 		_mesh_instance.set_surface_override_material(0, material)
@@ -272,12 +337,26 @@ func _physics_process(delta):
 	if _id < 0:
 		return
 
+	for i in _advance_tick_clock(delta):
+		_tick()
+		_update_non_lerped_members_from_mario_state()
+
+
+## Advance the shared tick clock once per physics frame and return how many ticks are due.
+static func _advance_tick_clock(delta: float) -> int:
+	var physics_frame := Engine.get_physics_frames()
+	if physics_frame == _ticked_physics_frame:
+		return _ticks_this_physics_frame
+	_ticked_physics_frame = physics_frame
+
+	_ticks_this_physics_frame = 0
 	_time_since_last_tick += delta
 	while _time_since_last_tick >= LibSM64.tick_delta_time:
-		_tick()
-		_last_tick_usec = Time.get_ticks_usec()
+		_ticks_this_physics_frame += 1
 		_time_since_last_tick -= LibSM64.tick_delta_time
-		_update_non_lerped_members_from_mario_state()
+	if _ticks_this_physics_frame > 0:
+		_last_tick_usec = Time.get_ticks_usec()
+	return _ticks_this_physics_frame
 
 
 func _update_non_lerped_members_from_mario_state() -> void:
@@ -307,6 +386,9 @@ func create() -> void:
 	_mario_interpolator.array_mesh_triangles_previous = _mario_interpolator.array_mesh_triangles_current
 
 	reset_interpolation()
+	_update_interpolator_batch_membership()
+	if history:
+		history.clear()
 
 	_default_material.albedo_texture = LibSM64Global.mario_texture
 	_wing_material.albedo_texture = LibSM64Global.mario_texture
@@ -320,6 +402,7 @@ func delete() -> void:
 		return
 	LibSM64.mario_delete(_id)
 	_id = -1
+	_update_interpolator_batch_membership()
 
 
 ## Teleport mario in the [code]libsm64[/code] world.
@@ -420,12 +503,24 @@ func _tick() -> void:
 	_mario_interpolator.mario_state_current = mario_tick_output[0]
 	_mario_interpolator.array_mesh_triangles_current = mario_tick_output[1]
 
+	if history:
+		history.push(mario_tick_output[0], mario_tick_output[1])
+
 	if _reset_interpolation_next_tick:
 		_mario_interpolator.mario_state_previous = _mario_interpolator.mario_state_current
 		_mario_interpolator.array_mesh_triangles_previous = _mario_interpolator.array_mesh_triangles_current
 		_reset_interpolation_next_tick = false
 
 
+func _update_interpolator_batch_membership() -> void:
+	var should_be_batched := interpolate and _id >= 0
+	if should_be_batched != _interpolator_batch.has_interpolator(_mario_interpolator):
+		if should_be_batched:
+			_interpolator_batch.add_interpolator(_mario_interpolator)
+		else:
+			_interpolator_batch.remove_interpolator(_mario_interpolator)
+
+
 static func _to_action_name(action: int) -> StringName:
 	match action:
 		LibSM64.ACT_IDLE:
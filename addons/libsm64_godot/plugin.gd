@@ -2,9 +2,22 @@
 extends EditorPlugin
 
 
+const LibSM64CollisionImportPlugin := preload("res://addons/libsm64_godot/editor/libsm64_collision_import_plugin.gd")
+const LibSM64SurfacesExportPlugin := preload("res://addons/libsm64_godot/editor/libsm64_surfaces_export_plugin.gd")
+
+var _collision_import_plugin: EditorImportPlugin
+var _surfaces_export_plugin: EditorExportPlugin
+
+
 func _enter_tree():
-	pass
+	_collision_import_plugin = LibSM64CollisionImportPlugin.new()
+	add_import_plugin(_collision_import_plugin)
+	_surfaces_export_plugin = LibSM64SurfacesExportPlugin.new()
+	add_export_plugin(_surfaces_export_plugin)
 
 
 func _exit_tree():
-	pass
+	remove_import_plugin(_collision_import_plugin)
+	_collision_import_plugin = null
+	remove_export_plugin(_surfaces_export_plugin)
+	_surfaces_export_plugin = null
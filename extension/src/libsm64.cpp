@@ -1,7 +1,12 @@
 #include <libsm64.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
 #include <godot_cpp/classes/array_mesh.hpp>
 #include <godot_cpp/classes/project_settings.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
 
 #include <libsm64_mario_geometry.hpp>
 #include <libsm64_mario_inputs.hpp>
@@ -9,6 +14,12 @@
 #include <libsm64_surface_array.hpp>
 
 constexpr char SCALE_FACTOR_SETTING_NAME[] = "libsm64/scale_factor";
+// Surface query batches at least this big are split across the WorkerThreadPool
+constexpr int64_t SURFACE_QUERY_THREADING_THRESHOLD = 64;
+// Volumes covering more cells than this are kept out of the grid
+constexpr int64_t LEVEL_VOLUME_MAX_CELLS = 1024;
+// Water and gas level given to Marios outside of every volume, in libsm64 units (same default as LibSM64Mario)
+constexpr signed int SM64_NO_LEVEL = -100000;
 
 // SM64 3D vector to Godot 3D vector
 // Winding order: counter-clockwise (SM64) -> clockwise (Godot)
@@ -170,7 +181,22 @@ static void SM64PlaySoundFunction(uint32_t soundBits, float *pos) {
 		return;
 	}
 
-	play_sound_function.call(soundBits, sm64_3d_to_godot(pos));
+	// Same conversion as the other outputs, so positions stay in Godot world space after a world origin rebase
+	play_sound_function.call(soundBits, sm64_3d_to_godot(pos, libsm64->get_scale_factor()) + libsm64->get_world_origin());
+}
+
+static uint64_t hash_floats(const float *p_data, size_t p_count, uint64_t p_hash) {
+	// FNV-1a over the bit patterns of the floats
+	for (size_t i = 0; i < p_count; i++) {
+		uint32_t bits;
+		memcpy(&bits, &p_data[i], sizeof(bits));
+		p_hash = (p_hash ^ bits) * 0x100000001b3ULL;
+	}
+	return p_hash;
+}
+
+static _FORCE_INLINE_ int64_t level_volume_cell_key(int64_t p_x, int64_t p_z) {
+	return static_cast<int64_t>((static_cast<uint64_t>(p_x) << 32) ^ (static_cast<uint64_t>(p_z) & 0xFFFFFFFF));
 }
 
 LibSM64::LibSM64() {
@@ -206,6 +232,62 @@ godot::real_t LibSM64::get_scale_factor() const {
 	return scale_factor;
 }
 
+void LibSM64::set_world_origin(const godot::Vector3 &p_value) {
+	float origin[3];
+	godot_to_sm64(p_value, origin, scale_factor);
+
+	int32_t offset[3];
+	int32_t shift[3];
+	for (int i = 0; i < 3; i++) {
+		offset[i] = static_cast<int32_t>(godot::Math::round(origin[i]));
+		shift[i] = offset[i] - world_origin_offset[i];
+	}
+	if (shift[0] == 0 && shift[1] == 0 && shift[2] == 0) {
+		return;
+	}
+
+	for (int i = 0; i < 3; i++) {
+		world_origin_offset[i] = offset[i];
+		origin[i] = static_cast<float>(offset[i]);
+	}
+	world_origin = sm64_3d_to_godot(origin, scale_factor);
+
+	// Moving everything by whole libsm64 units keeps the static surfaces exact
+	for (auto &[mario_id, mario_origin_state] : mario_origin_states) {
+		for (int i = 0; i < 3; i++) {
+			mario_origin_state.position[i] -= static_cast<float>(shift[i]);
+		}
+		sm64_set_mario_position(mario_id, mario_origin_state.position[0], mario_origin_state.position[1], mario_origin_state.position[2]);
+		if (mario_origin_state.has_water_level) {
+			sm64_set_mario_water_level(mario_id, static_cast<signed int>((mario_origin_state.water_level - world_origin.y) * scale_factor));
+		}
+		if (mario_origin_state.has_gas_level) {
+			sm64_set_mario_gas_level(mario_id, static_cast<signed int>((mario_origin_state.gas_level - world_origin.y) * scale_factor));
+		}
+	}
+
+	for (const auto &[object_id, object] : surface_objects) {
+		sm64_move_surface_object(object);
+	}
+
+	if (!static_surfaces.empty()) {
+		load_static_surfaces();
+	}
+}
+
+godot::Vector3 LibSM64::get_world_origin() const {
+	return world_origin;
+}
+
+void LibSM64::set_world_origin_threshold(godot::real_t p_value) {
+	ERR_FAIL_COND(p_value < 0);
+	world_origin_threshold = p_value;
+}
+
+godot::real_t LibSM64::get_world_origin_threshold() const {
+	return world_origin_threshold;
+}
+
 double LibSM64::get_tick_delta_time() const {
 	return tick_delta_time;
 }
@@ -233,12 +315,40 @@ godot::Ref<godot::Image> LibSM64::global_init(const godot::PackedByteArray &p_ro
 	mario_image_bytes.resize(4 * SM64_TEXTURE_WIDTH * SM64_TEXTURE_HEIGHT);
 
 	sm64_global_init(p_rom.ptr(), mario_image_bytes.ptrw());
+	initialized = true;
+	init_generation++;
 
 	return godot::Image::create_from_data(SM64_TEXTURE_WIDTH, SM64_TEXTURE_HEIGHT, false, godot::Image::FORMAT_RGBA8, mario_image_bytes);
 }
 
 void LibSM64::global_terminate() {
 	sm64_global_terminate();
+	initialized = false;
+	mario_geometry_caches.clear();
+	static_surfaces.clear();
+	loaded_static_surfaces.clear();
+	all_static_surfaces_loaded = true;
+	static_surfaces_bvh = SM64SurfaceBVH();
+	static_surfaces_bvh_dirty = true;
+	mario_origin_states.clear();
+	level_volume_clear();
+	// Slots keep their versions, so IDs from before the terminate stay invalid
+	for (const auto &[object_id, object] : surface_objects) {
+		release_surface_object_slot(object_id);
+	}
+	surface_objects.clear();
+	surface_array_bvhs.clear();
+	surface_object_peak_count = 0;
+	static_surface_groups.clear();
+	queued_surface_object_moves.clear();
+}
+
+bool LibSM64::is_initialized() const {
+	return initialized;
+}
+
+uint64_t LibSM64::get_init_generation() const {
+	return init_generation;
 }
 
 void LibSM64::audio_init(const godot::PackedByteArray &p_rom) {
@@ -269,16 +379,138 @@ godot::PackedVector2Array LibSM64::audio_tick(int p_queued_frames, int p_desired
 void LibSM64::static_surfaces_load(const godot::Ref<LibSM64SurfaceArray> &p_surfaces) {
 	ERR_FAIL_NULL(p_surfaces);
 
-	sm64_static_surfaces_load(p_surfaces->sm64_surfaces.data(), p_surfaces->sm64_surfaces.size());
+	// A copy is kept to reload the surfaces around a new world origin
+	static_surfaces = p_surfaces->sm64_surfaces;
+	static_surfaces_bvh_dirty = true;
+	load_static_surfaces();
+}
+
+int LibSM64::static_surfaces_add(const godot::Ref<LibSM64SurfaceArray> &p_surfaces) {
+	ERR_FAIL_NULL_V(p_surfaces, -1);
+	ERR_FAIL_COND_V_MSG(p_surfaces->sm64_surfaces.empty(), -1, "[libsm64-godot] Can't add an empty static surface group.");
+
+	// libsm64 can't partially update its static surfaces, so groups are surface objects that never move.
+	// They are placed at the center of their bounds, keeping the local vertices small.
+	int64_t min_coordinates[3] = { std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::max() };
+	int64_t max_coordinates[3] = { std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::min() };
+	for (const auto &surface : p_surfaces->sm64_surfaces) {
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				min_coordinates[j] = godot::MIN(min_coordinates[j], static_cast<int64_t>(surface.vertices[i][j]));
+				max_coordinates[j] = godot::MAX(max_coordinates[j], static_cast<int64_t>(surface.vertices[i][j]));
+			}
+		}
+	}
+	int32_t center[3];
+	float center_position[3];
+	for (int j = 0; j < 3; j++) {
+		center[j] = static_cast<int32_t>((min_coordinates[j] + max_coordinates[j]) / 2);
+		center_position[j] = static_cast<float>(center[j]);
+	}
+
+	godot::Ref<LibSM64SurfaceArray> local_surfaces;
+	local_surfaces.instantiate();
+	local_surfaces->scale_factor = p_surfaces->scale_factor;
+	local_surfaces->sm64_surfaces = p_surfaces->sm64_surfaces;
+	for (auto &surface : local_surfaces->sm64_surfaces) {
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				surface.vertices[i][j] -= center[j];
+			}
+		}
+	}
+
+	// Placed at the exact center, a round trip through Godot units could move the group off by one unit
+	const int group_id = add_surface_object(sm64_3d_to_godot(center_position, scale_factor), godot::Quaternion(), local_surfaces, center);
+	if (group_id < 0) {
+		return -1;
+	}
+	static_surface_groups.insert(group_id);
+
+	return group_id;
+}
+
+void LibSM64::static_surfaces_remove(int p_group_id) {
+	ERR_FAIL_COND_MSG(static_surface_groups.count(p_group_id) == 0, godot::vformat("[libsm64-godot] %d is not a static surface group.", p_group_id));
+
+	surface_object_delete(p_group_id);
+}
+
+void LibSM64::release_surface_object_slot(uint32_t p_object_id) {
+	const uint32_t slot = p_object_id & SURFACE_OBJECT_SLOT_MASK;
+	surface_object_slot_versions[slot] = (surface_object_slot_versions[slot] + 1) & SURFACE_OBJECT_VERSION_MASK;
+	free_surface_object_slots.push_back(slot);
+}
+
+void LibSM64::load_static_surfaces() {
+	if (world_origin_offset[0] == 0 && world_origin_offset[1] == 0 && world_origin_offset[2] == 0) {
+		sm64_static_surfaces_load(static_surfaces.data(), static_surfaces.size());
+		if (!all_static_surfaces_loaded) {
+			all_static_surfaces_loaded = true;
+			loaded_static_surfaces.clear();
+			static_surfaces_bvh_dirty = true;
+		}
+		return;
+	}
+
+	// Triangles that can't be represented around the current origin are left out instead of wrapping around
+	constexpr int64_t min_coordinate = std::numeric_limits<int16_t>::min();
+	constexpr int64_t max_coordinate = std::numeric_limits<int16_t>::max();
+	std::vector<struct SM64Surface> translated_surfaces;
+	translated_surfaces.reserve(static_surfaces.size());
+	std::vector<struct SM64Surface> in_range_surfaces;
+	for (const auto &surface : static_surfaces) {
+		struct SM64Surface translated_surface = surface;
+		bool in_range = true;
+		for (int i = 0; i < 3 && in_range; i++) {
+			for (int j = 0; j < 3; j++) {
+				const int64_t coordinate = static_cast<int64_t>(surface.vertices[i][j]) - world_origin_offset[j];
+				if (coordinate < min_coordinate || coordinate > max_coordinate) {
+					in_range = false;
+					break;
+				}
+				translated_surface.vertices[i][j] = static_cast<int32_t>(coordinate);
+			}
+		}
+		if (in_range) {
+			translated_surfaces.push_back(translated_surface);
+			in_range_surfaces.push_back(surface);
+		}
+	}
+
+	sm64_static_surfaces_load(translated_surfaces.data(), translated_surfaces.size());
+
+	// Queries only see what libsm64 got, the BVH is rebuilt whenever surfaces are left out
+	const bool all_loaded = translated_surfaces.size() == static_surfaces.size();
+	if (!all_loaded || !all_static_surfaces_loaded) {
+		static_surfaces_bvh_dirty = true;
+	}
+	all_static_surfaces_loaded = all_loaded;
+	loaded_static_surfaces = all_loaded ? std::vector<struct SM64Surface>() : std::move(in_range_surfaces);
 }
 
 int32_t LibSM64::mario_create(const godot::Vector3 &p_position) {
+	// The floor Mario is created on may belong to a parked surface object
+	if (surface_object_activation_distance > 0.0) {
+		for (auto &[object_id, object] : surface_objects) {
+			if (is_surface_object_near(object, { p_position }, surface_object_activation_distance)) {
+				activate_surface_object(object);
+			}
+		}
+	}
+
 	float x, y, z;
-	godot_to_sm64(p_position, x, y, z, scale_factor);
+	godot_to_sm64(p_position - world_origin, x, y, z, scale_factor);
 
 	int32_t mario_id = sm64_mario_create(x, y, z);
 	ERR_FAIL_COND_V_MSG(mario_id < 0, mario_id, "[libsm64-godot] Failed to create Mario. Have you created a floor for him to stand on yet?");
 
+	MarioOriginState &mario_origin_state = mario_origin_states[mario_id];
+	mario_origin_state = MarioOriginState();
+	mario_origin_state.position[0] = x;
+	mario_origin_state.position[1] = y;
+	mario_origin_state.position[2] = z;
+
 	return mario_id;
 }
 
@@ -288,14 +520,66 @@ godot::Array LibSM64::mario_tick(int32_t p_mario_id, const godot::Ref<LibSM64Mar
 	ERR_FAIL_COND_V(p_mario_id < 0, ret);
 	ERR_FAIL_NULL_V(p_mario_inputs, ret);
 
+	flush_surface_object_moves();
+	update_mario_level_volumes(p_mario_id);
+	// Roughly once per tick of every Mario
+	if (surface_object_activation_distance > 0.0 && ++mario_ticks_since_activation >= mario_origin_states.size()) {
+		update_surface_object_activation();
+	}
+
 	const struct SM64MarioInputs sm64_mario_inputs = p_mario_inputs->to_sm64();
 	struct SM64MarioState sm64_mario_state; // NOLINT(cppcoreguidelines-pro-type-member-init)
 	LibSM64MarioGeometry sm64_mario_geometry;
 	sm64_mario_tick(p_mario_id, &sm64_mario_inputs, &sm64_mario_state, sm64_mario_geometry.data());
 
+	// Geometry is relative to the origin Mario was ticked with, the origin may move right after
+	const godot::Vector3 origin = world_origin;
 	godot::Ref<LibSM64MarioState> mario_state = memnew(LibSM64MarioState(sm64_mario_state, scale_factor));
+	mario_state->set_position(mario_state->get_position() + origin);
+
+	MarioOriginState &mario_origin_state = mario_origin_states[p_mario_id];
+	memcpy(mario_origin_state.position, sm64_mario_state.position, sizeof(mario_origin_state.position));
+	// At most once per tick of every Mario, around their centroid so Marios far apart don't pull the origin back and forth
+	if (world_origin_threshold > 0.0 && ++mario_ticks_since_rebase >= mario_origin_states.size()) {
+		float centroid[3] = { 0.0f, 0.0f, 0.0f };
+		for (const auto &[mario_id, other_origin_state] : mario_origin_states) {
+			for (int i = 0; i < 3; i++) {
+				centroid[i] += other_origin_state.position[i];
+			}
+		}
+		for (int i = 0; i < 3; i++) {
+			centroid[i] /= static_cast<float>(mario_origin_states.size());
+		}
+
+		const float threshold = static_cast<float>(world_origin_threshold * scale_factor);
+		if (godot::Math::abs(centroid[0]) > threshold || godot::Math::abs(centroid[1]) > threshold || godot::Math::abs(centroid[2]) > threshold) {
+			mario_ticks_since_rebase = 0;
+			set_world_origin(sm64_3d_to_godot(centroid, scale_factor) + origin);
+		}
+	}
 
 	const int vertex_count = sm64_mario_geometry.triangles() * 3;
+
+	// Idle Marios produce the same geometry tick after tick, skip the conversion and hand out the previous arrays
+	const bool wing_cap = sm64_mario_state.flags & MARIO_WING_CAP;
+	const float hashed_scale_factor = static_cast<float>(scale_factor);
+	uint64_t geometry_hash = 0xcbf29ce484222325ULL;
+	geometry_hash = hash_floats(&hashed_scale_factor, 1, geometry_hash);
+	const float hashed_origin[3] = { static_cast<float>(origin.x), static_cast<float>(origin.y), static_cast<float>(origin.z) };
+	geometry_hash = hash_floats(hashed_origin, 3, geometry_hash);
+	geometry_hash = hash_floats(sm64_mario_geometry.position.data(), 3 * vertex_count, geometry_hash);
+	geometry_hash = hash_floats(sm64_mario_geometry.normal.data(), 3 * vertex_count, geometry_hash);
+	geometry_hash = hash_floats(sm64_mario_geometry.color.data(), 3 * vertex_count, geometry_hash);
+	geometry_hash = hash_floats(sm64_mario_geometry.uv.data(), 2 * vertex_count, geometry_hash);
+	geometry_hash = (geometry_hash ^ static_cast<uint64_t>(wing_cap)) * 0x100000001b3ULL;
+
+	MarioGeometryCache &geometry_cache = mario_geometry_caches[p_mario_id];
+	if (!geometry_cache.array_mesh_triangles.is_empty() && geometry_cache.hash == geometry_hash) {
+		ret.append(mario_state);
+		ret.append(geometry_cache.array_mesh_triangles);
+		ret.append(false);
+		return ret;
+	}
 	godot::PackedVector3Array position;
 	position.resize(vertex_count);
 	godot::PackedVector3Array normal;
@@ -306,8 +590,14 @@ godot::Array LibSM64::mario_tick(int32_t p_mario_id, const godot::Ref<LibSM64Mar
 	uv.resize(vertex_count);
 
 	sm64_3d_to_godot(sm64_mario_geometry.position.data(), position.ptrw(), vertex_count, scale_factor);
+	if (origin != godot::Vector3()) {
+		godot::Vector3 *position_ptrw = position.ptrw();
+		for (int i = 0; i < vertex_count; i++) {
+			position_ptrw[i] += origin;
+		}
+	}
 	sm64_3d_to_godot(sm64_mario_geometry.normal.data(), normal.ptrw(), vertex_count);
-	sm64_color_to_godot(sm64_mario_geometry.color.data(), color.ptrw(), vertex_count, sm64_mario_state.flags & MARIO_WING_CAP);
+	sm64_color_to_godot(sm64_mario_geometry.color.data(), color.ptrw(), vertex_count, wing_cap);
 	sm64_2d_to_godot(sm64_mario_geometry.uv.data(), uv.ptrw(), vertex_count);
 
 	godot::Array array_mesh_triangles;
@@ -317,8 +607,12 @@ godot::Array LibSM64::mario_tick(int32_t p_mario_id, const godot::Ref<LibSM64Mar
 	array_mesh_triangles[godot::ArrayMesh::ARRAY_COLOR] = color;
 	array_mesh_triangles[godot::ArrayMesh::ARRAY_TEX_UV] = uv;
 
+	geometry_cache.hash = geometry_hash;
+	geometry_cache.array_mesh_triangles = array_mesh_triangles;
+
 	ret.append(mario_state);
 	ret.append(array_mesh_triangles);
+	ret.append(true);
 
 	return ret;
 }
@@ -327,6 +621,8 @@ void LibSM64::mario_delete(int32_t p_mario_id) {
 	ERR_FAIL_COND(p_mario_id < 0);
 
 	sm64_mario_delete(p_mario_id);
+	mario_geometry_caches.erase(p_mario_id);
+	mario_origin_states.erase(p_mario_id);
 }
 
 void LibSM64::set_mario_action(int32_t p_mario_id, godot::BitField<ActionFlags> p_action) {
@@ -363,8 +659,13 @@ void LibSM64::set_mario_position(int32_t p_mario_id, const godot::Vector3 &p_pos
 	ERR_FAIL_COND(p_mario_id < 0);
 
 	float x, y, z;
-	godot_to_sm64(p_position, x, y, z, scale_factor);
+	godot_to_sm64(p_position - world_origin, x, y, z, scale_factor);
 	sm64_set_mario_position(p_mario_id, x, y, z);
+
+	MarioOriginState &mario_origin_state = mario_origin_states[p_mario_id];
+	mario_origin_state.position[0] = x;
+	mario_origin_state.position[1] = y;
+	mario_origin_state.position[2] = z;
 }
 
 void LibSM64::set_mario_angle(int32_t p_mario_id, const godot::Quaternion &p_angle) {
@@ -404,13 +705,41 @@ void LibSM64::set_mario_invincibility(int32_t p_mario_id, double p_time) {
 void LibSM64::set_mario_water_level(int32_t p_mario_id, godot::real_t p_level) {
 	ERR_FAIL_COND(p_mario_id < 0);
 
-	sm64_set_mario_water_level(p_mario_id, static_cast<signed int>(p_level * scale_factor));
+	sm64_set_mario_water_level(p_mario_id, static_cast<signed int>((p_level - world_origin.y) * scale_factor));
+
+	MarioOriginState &mario_origin_state = mario_origin_states[p_mario_id];
+	mario_origin_state.has_water_level = true;
+	mario_origin_state.water_level = p_level;
+	mario_origin_state.water_level_from_volume = false;
 }
 
 void LibSM64::set_mario_gas_level(int32_t p_mario_id, godot::real_t p_level) {
 	ERR_FAIL_COND(p_mario_id < 0);
 
-	sm64_set_mario_gas_level(p_mario_id, static_cast<signed int>(p_level * scale_factor));
+	sm64_set_mario_gas_level(p_mario_id, static_cast<signed int>((p_level - world_origin.y) * scale_factor));
+
+	MarioOriginState &mario_origin_state = mario_origin_states[p_mario_id];
+	mario_origin_state.has_gas_level = true;
+	mario_origin_state.gas_level = p_level;
+	mario_origin_state.gas_level_from_volume = false;
+}
+
+godot::real_t LibSM64::get_mario_water_level(int32_t p_mario_id) const {
+	auto it = mario_origin_states.find(p_mario_id);
+	if (it == mario_origin_states.end() || !it->second.has_water_level) {
+		// Where libsm64's own "no level" height is in Godot units, like every other level
+		return SM64_NO_LEVEL / scale_factor + world_origin.y;
+	}
+	return it->second.water_level;
+}
+
+godot::real_t LibSM64::get_mario_gas_level(int32_t p_mario_id) const {
+	auto it = mario_origin_states.find(p_mario_id);
+	if (it == mario_origin_states.end() || !it->second.has_gas_level) {
+		// Where libsm64's own "no level" height is in Godot units, like every other level
+		return SM64_NO_LEVEL / scale_factor + world_origin.y;
+	}
+	return it->second.gas_level;
 }
 
 void LibSM64::set_mario_health(int32_t p_mario_id, uint16_t p_health) {
@@ -423,7 +752,7 @@ void LibSM64::mario_take_damage(int32_t p_mario_id, uint32_t p_damage, uint32_t
 	ERR_FAIL_COND(p_mario_id < 0);
 
 	float x, y, z;
-	godot_to_sm64(p_position, x, y, z, scale_factor);
+	godot_to_sm64(p_position - world_origin, x, y, z, scale_factor);
 	sm64_mario_take_damage(p_mario_id, p_damage, p_subtype, x, y, z);
 }
 
@@ -455,38 +784,1081 @@ void LibSM64::mario_attack(int32_t p_mario_id, const godot::Vector3 &p_position,
 	ERR_FAIL_COND(p_mario_id < 0);
 
 	float x, y, z;
-	godot_to_sm64(p_position, x, y, z, scale_factor);
+	godot_to_sm64(p_position - world_origin, x, y, z, scale_factor);
 	sm64_mario_attack(p_mario_id, x, y, z, p_hitbox_height * scale_factor);
 }
 
 int LibSM64::surface_object_create(const godot::Vector3 &p_position, const godot::Quaternion &p_rotation, const godot::Ref<LibSM64SurfaceArray> &p_surfaces) {
+	return add_surface_object(p_position, p_rotation, p_surfaces, nullptr);
+}
+
+int LibSM64::add_surface_object(const godot::Vector3 &p_position, const godot::Quaternion &p_rotation, const godot::Ref<LibSM64SurfaceArray> &p_surfaces, const int32_t *p_sm64_position) {
 	ERR_FAIL_NULL_V(p_surfaces, -1);
+	ERR_FAIL_COND_V_MSG(surface_objects.size() >= get_surface_object_capacity_limit(), -1, godot::vformat("[libsm64-godot] Can't create more than %d surface objects.", static_cast<int64_t>(get_surface_object_capacity_limit())));
+
+	// IDs are handed out here rather than by libsm64, parked objects get a new libsm64 ID when activated again.
+	// Slots of deleted objects are reused first, so the slots stay within [0, peak count) however many objects are spawned over time
+	uint32_t slot;
+	if (free_surface_object_slots.empty()) {
+		slot = static_cast<uint32_t>(surface_object_slot_versions.size());
+		surface_object_slot_versions.push_back(0);
+	} else {
+		slot = free_surface_object_slots.back();
+		free_surface_object_slots.pop_back();
+	}
+	const uint32_t object_id = (surface_object_slot_versions[slot] << SURFACE_OBJECT_SLOT_BITS) | slot;
+	surface_object_peak_count = godot::MAX(surface_object_peak_count, surface_objects.size() + 1);
+
+	SurfaceObject &object = surface_objects[object_id];
+	object.position = p_position;
+	object.rotation = p_rotation;
+	object.basis = godot::Basis(p_rotation);
+	object.surfaces = p_surfaces;
+	if (p_sm64_position != nullptr) {
+		object.has_sm64_position = true;
+		for (int i = 0; i < 3; i++) {
+			object.sm64_position[i] = p_sm64_position[i];
+		}
+	}
+
+	// Bounding sphere around the center of the surfaces' bounds, used for the proximity activation
+	const std::vector<struct SM64Surface> &surfaces = p_surfaces->sm64_surfaces;
+	if (!surfaces.empty()) {
+		float min_vertex[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+		float max_vertex[3] = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+		for (const auto &surface : surfaces) {
+			for (int i = 0; i < 3; i++) {
+				for (int j = 0; j < 3; j++) {
+					min_vertex[j] = godot::MIN(min_vertex[j], static_cast<float>(surface.vertices[i][j]));
+					max_vertex[j] = godot::MAX(max_vertex[j], static_cast<float>(surface.vertices[i][j]));
+				}
+			}
+		}
+		const float center[3] = { (min_vertex[0] + max_vertex[0]) * 0.5f, (min_vertex[1] + max_vertex[1]) * 0.5f, (min_vertex[2] + max_vertex[2]) * 0.5f };
+		object.bounds_center = sm64_3d_to_godot(center, scale_factor);
+		for (const auto &surface : surfaces) {
+			for (int i = 0; i < 3; i++) {
+				const float vertex[3] = { static_cast<float>(surface.vertices[i][0]), static_cast<float>(surface.vertices[i][1]), static_cast<float>(surface.vertices[i][2]) };
+				object.bounds_radius = godot::MAX(object.bounds_radius, object.bounds_center.distance_to(sm64_3d_to_godot(vertex, scale_factor)));
+			}
+		}
+	}
+
+	if (surface_object_activation_distance <= 0.0 || is_surface_object_near(object, get_mario_positions(), surface_object_activation_distance)) {
+		activate_surface_object(object);
+	}
+
+	return object_id;
+}
+
+void LibSM64::surface_object_move(uint32_t p_object_id, const godot::Vector3 &p_position, const godot::Quaternion &p_rotation) {
+	auto it = surface_objects.find(p_object_id);
+	ERR_FAIL_COND_MSG(it == surface_objects.end(), godot::vformat("[libsm64-godot] Surface object %d doesn't exist.", p_object_id));
+
+	SurfaceObject &object = it->second;
+	object.position = p_position;
+	object.rotation = p_rotation;
+	object.basis = godot::Basis(p_rotation);
+	object.has_sm64_position = false;
+	sm64_move_surface_object(object);
+}
+
+int LibSM64::surface_object_move_batch(const godot::PackedInt32Array &p_object_ids, const godot::Array &p_transforms) {
+	ERR_FAIL_COND_V_MSG(p_object_ids.size() != p_transforms.size(), 0, "[libsm64-godot] object_ids and transforms must have the same size.");
+
+	const int32_t *object_ids = p_object_ids.ptr();
+	int moved_count = 0;
+	for (int64_t i = 0; i < p_object_ids.size(); i++) {
+		auto it = surface_objects.find(static_cast<uint32_t>(object_ids[i]));
+		ERR_CONTINUE_MSG(it == surface_objects.end(), godot::vformat("[libsm64-godot] Surface object %d doesn't exist.", object_ids[i]));
+
+		if (move_surface_object(it->second, p_transforms[i])) {
+			moved_count++;
+		}
+	}
+
+	return moved_count;
+}
+
+void LibSM64::surface_object_queue_move(uint32_t p_object_id, const godot::Transform3D &p_transform) {
+	ERR_FAIL_COND_MSG(surface_objects.count(p_object_id) == 0, godot::vformat("[libsm64-godot] Surface object %d doesn't exist.", p_object_id));
+
+	queued_surface_object_moves[p_object_id] = p_transform;
+}
+
+int LibSM64::flush_surface_object_moves() {
+	int moved_count = 0;
+	for (const auto &[object_id, transform] : queued_surface_object_moves) {
+		auto it = surface_objects.find(object_id);
+		if (it != surface_objects.end() && move_surface_object(it->second, transform)) {
+			moved_count++;
+		}
+	}
+	queued_surface_object_moves.clear();
+
+	return moved_count;
+}
+
+void LibSM64::surface_object_delete(uint32_t p_object_id) {
+	auto it = surface_objects.find(p_object_id);
+	ERR_FAIL_COND_MSG(it == surface_objects.end(), godot::vformat("[libsm64-godot] Surface object %d doesn't exist.", p_object_id));
+
+	park_surface_object(it->second);
+	if (it->second.bvh && it->second.bvh.use_count() == 1) {
+		// Last object using this BVH
+		surface_array_bvhs.erase(it->second.surfaces.ptr());
+	}
+	surface_objects.erase(it);
+	release_surface_object_slot(p_object_id);
+	static_surface_groups.erase(p_object_id);
+	queued_surface_object_moves.erase(p_object_id);
+}
+
+godot::PackedInt32Array LibSM64::surface_objects_create(const godot::Array &p_transforms, const godot::Array &p_surfaces) {
+	godot::PackedInt32Array object_ids;
+	ERR_FAIL_COND_V_MSG(p_transforms.size() != p_surfaces.size(), object_ids, "[libsm64-godot] transforms and surfaces must have the same size.");
+	// Checked up front so a batch is either created whole or not at all
+	ERR_FAIL_COND_V_MSG(surface_objects.size() + p_transforms.size() > get_surface_object_capacity_limit(), object_ids, godot::vformat("[libsm64-godot] Can't create %d surface objects, only %d more fit.", p_transforms.size(), static_cast<int64_t>(get_surface_object_capacity_limit() - surface_objects.size())));
+	for (int64_t i = 0; i < p_transforms.size(); i++) {
+		ERR_FAIL_COND_V_MSG(p_transforms[i].get_type() != godot::Variant::TRANSFORM3D, object_ids, godot::vformat("[libsm64-godot] transforms[%d] is not a Transform3D.", i));
+		const godot::Ref<LibSM64SurfaceArray> surfaces = p_surfaces[i];
+		ERR_FAIL_COND_V_MSG(surfaces.is_null(), object_ids, godot::vformat("[libsm64-godot] surfaces[%d] is not a LibSM64SurfaceArray.", i));
+	}
+
+	object_ids.resize(p_transforms.size());
+	int32_t *object_ids_ptrw = object_ids.ptrw();
+	for (int64_t i = 0; i < p_transforms.size(); i++) {
+		const godot::Transform3D transform = p_transforms[i];
+		const godot::Ref<LibSM64SurfaceArray> surfaces = p_surfaces[i];
+		object_ids_ptrw[i] = surface_object_create(transform.origin, transform.basis.get_rotation_quaternion(), surfaces);
+	}
+
+	return object_ids;
+}
+
+int LibSM64::surface_objects_delete(const godot::PackedInt32Array &p_object_ids) {
+	const int32_t *object_ids = p_object_ids.ptr();
+	int deleted_count = 0;
+	for (int64_t i = 0; i < p_object_ids.size(); i++) {
+		ERR_CONTINUE_MSG(surface_objects.count(static_cast<uint32_t>(object_ids[i])) == 0, godot::vformat("[libsm64-godot] Surface object %d doesn't exist.", object_ids[i]));
+
+		surface_object_delete(static_cast<uint32_t>(object_ids[i]));
+		deleted_count++;
+	}
+
+	return deleted_count;
+}
+
+void LibSM64::set_surface_object_capacity(int p_value) {
+	ERR_FAIL_COND(p_value < 0);
+	surface_object_capacity = p_value;
+}
+
+int LibSM64::get_surface_object_capacity() const {
+	return surface_object_capacity;
+}
+
+godot::Dictionary LibSM64::get_surface_object_stats() const {
+	int64_t surface_count = 0;
+	for (const auto &[object_id, object] : surface_objects) {
+		surface_count += object.surfaces->sm64_surfaces.size();
+	}
+
+	godot::Dictionary stats;
+	stats["live"] = static_cast<int64_t>(surface_objects.size());
+	stats["active"] = get_active_surface_object_count();
+	stats["peak"] = static_cast<int64_t>(surface_object_peak_count);
+	stats["capacity"] = static_cast<int64_t>(get_surface_object_capacity_limit());
+	stats["free_ids"] = static_cast<int64_t>(free_surface_object_slots.size());
+	stats["surfaces"] = surface_count;
+	return stats;
+}
+
+size_t LibSM64::get_surface_object_capacity_limit() const {
+	// IDs are passed to Godot as 32 bit signed integers, with the slot's version in the upper bits
+	const size_t id_limit = static_cast<size_t>(SURFACE_OBJECT_SLOT_MASK) + 1;
+	return surface_object_capacity > 0 ? godot::MIN(static_cast<size_t>(surface_object_capacity), id_limit) : id_limit;
+}
+
+void LibSM64::set_surface_object_activation_distance(godot::real_t p_value) {
+	ERR_FAIL_COND(p_value < 0);
+	surface_object_activation_distance = p_value;
+	update_surface_object_activation();
+}
+
+godot::real_t LibSM64::get_surface_object_activation_distance() const {
+	return surface_object_activation_distance;
+}
+
+int LibSM64::update_surface_object_activation() {
+	mario_ticks_since_activation = 0;
+
+	const std::vector<godot::Vector3> mario_positions = get_mario_positions();
+	int active_count = 0;
+	for (auto &[object_id, object] : surface_objects) {
+		bool active = true;
+		if (surface_object_activation_distance > 0.0) {
+			// Active objects are kept a bit farther than they are activated, so objects at the edge don't flicker
+			const godot::real_t distance = surface_object_activation_distance * (object.sm64_object_id >= 0 ? 1.25 : 1.0);
+			active = is_surface_object_near(object, mario_positions, distance);
+		}
+
+		if (active) {
+			activate_surface_object(object);
+			active_count++;
+		} else {
+			park_surface_object(object);
+		}
+	}
+
+	return active_count;
+}
+
+int LibSM64::get_active_surface_object_count() const {
+	int active_count = 0;
+	for (const auto &[object_id, object] : surface_objects) {
+		if (object.sm64_object_id >= 0) {
+			active_count++;
+		}
+	}
+	return active_count;
+}
+
+bool LibSM64::move_surface_object(SurfaceObject &r_object, const godot::Transform3D &p_transform) {
+	if (p_transform.origin == r_object.position && p_transform.basis == r_object.basis) {
+		return false;
+	}
+
+	r_object.position = p_transform.origin;
+	r_object.rotation = p_transform.basis.get_rotation_quaternion();
+	r_object.basis = p_transform.basis;
+	r_object.has_sm64_position = false;
+	sm64_move_surface_object(r_object);
+
+	return true;
+}
+
+void LibSM64::get_surface_object_sm64_position(const SurfaceObject &p_object, float *r_position) const {
+	if (p_object.has_sm64_position) {
+		for (int i = 0; i < 3; i++) {
+			r_position[i] = static_cast<float>(static_cast<int64_t>(p_object.sm64_position[i]) - world_origin_offset[i]);
+		}
+	} else {
+		godot_to_sm64(p_object.position - world_origin, r_position, scale_factor);
+	}
+}
+
+void LibSM64::sm64_move_surface_object(const SurfaceObject &p_object) {
+	// Parked objects only keep their transform, it's applied when they are activated
+	if (p_object.sm64_object_id < 0) {
+		return;
+	}
+
+	struct SM64ObjectTransform object_transform; // NOLINT(cppcoreguidelines-pro-type-member-init)
+	get_surface_object_sm64_position(p_object, object_transform.position);
+	godot_to_sm64_object_rotation(p_object.rotation, object_transform.eulerRotation);
+	sm64_surface_object_move(static_cast<uint32_t>(p_object.sm64_object_id), &object_transform);
+}
+
+void LibSM64::activate_surface_object(SurfaceObject &r_object) {
+	if (r_object.sm64_object_id >= 0) {
+		return;
+	}
 
 	struct SM64ObjectTransform object_transform; // NOLINT(cppcoreguidelines-pro-type-member-init)
-	godot_to_sm64(p_position, object_transform.position, scale_factor);
-	godot_to_sm64_object_rotation(p_rotation, object_transform.eulerRotation);
+	get_surface_object_sm64_position(r_object, object_transform.position);
+	godot_to_sm64_object_rotation(r_object.rotation, object_transform.eulerRotation);
 
 	const struct SM64SurfaceObject object = {
 		object_transform,
-		static_cast<uint32_t>(p_surfaces->sm64_surfaces.size()),
-		const_cast<SM64Surface *>(p_surfaces->sm64_surfaces.data())
+		static_cast<uint32_t>(r_object.surfaces->sm64_surfaces.size()),
+		r_object.surfaces->sm64_surfaces.data()
 	};
 
-	return sm64_surface_object_create(&object);
+	r_object.sm64_object_id = sm64_surface_object_create(&object);
 }
 
-void LibSM64::surface_object_move(uint32_t p_object_id, const godot::Vector3 &p_position, const godot::Quaternion &p_rotation) {
-	ERR_FAIL_COND(p_object_id < 0);
+void LibSM64::park_surface_object(SurfaceObject &r_object) {
+	if (r_object.sm64_object_id < 0) {
+		return;
+	}
 
-	struct SM64ObjectTransform object_transform; // NOLINT(cppcoreguidelines-pro-type-member-init)
-	godot_to_sm64(p_position, object_transform.position, scale_factor);
-	godot_to_sm64_object_rotation(p_rotation, object_transform.eulerRotation);
+	sm64_surface_object_delete(static_cast<uint32_t>(r_object.sm64_object_id));
+	r_object.sm64_object_id = -1;
+}
 
-	sm64_surface_object_move(p_object_id, &object_transform);
+bool LibSM64::is_surface_object_near(const SurfaceObject &p_object, const std::vector<godot::Vector3> &p_positions, godot::real_t p_distance) const {
+	const godot::Vector3 center = p_object.position + godot::Basis(p_object.rotation).xform(p_object.bounds_center);
+	const godot::real_t reach = p_object.bounds_radius + p_distance;
+	for (const godot::Vector3 &position : p_positions) {
+		if (position.distance_squared_to(center) <= reach * reach) {
+			return true;
+		}
+	}
+	return false;
 }
 
-void LibSM64::surface_object_delete(uint32_t p_object_id) {
-	sm64_surface_object_delete(p_object_id);
+std::vector<godot::Vector3> LibSM64::get_mario_positions() const {
+	std::vector<godot::Vector3> positions;
+	positions.reserve(mario_origin_states.size());
+	for (const auto &[mario_id, mario_origin_state] : mario_origin_states) {
+		positions.push_back(sm64_3d_to_godot(mario_origin_state.position, scale_factor) + world_origin);
+	}
+	return positions;
+}
+
+godot::Dictionary LibSM64::surface_find_floor(const godot::Vector3 &p_position) {
+	godot::Dictionary result;
+	SurfaceHit hit;
+	if (find_floor(p_position, hit)) {
+		result["height"] = hit.height;
+		result["normal"] = hit.normal;
+		result["surface_type"] = hit.surface_type;
+		result["terrain_type"] = hit.terrain_type;
+	}
+	return result;
+}
+
+godot::Dictionary LibSM64::surface_find_floor_batch(const godot::PackedVector3Array &p_positions) {
+	return find_surfaces_batch(p_positions, false);
+}
+
+godot::Dictionary LibSM64::surface_find_ceil(const godot::Vector3 &p_position) {
+	godot::Dictionary result;
+	SurfaceHit hit;
+	if (find_ceil(p_position, hit)) {
+		result["height"] = hit.height;
+		result["normal"] = hit.normal;
+		result["surface_type"] = hit.surface_type;
+		result["terrain_type"] = hit.terrain_type;
+	}
+	return result;
+}
+
+godot::Dictionary LibSM64::surface_find_ceil_batch(const godot::PackedVector3Array &p_positions) {
+	return find_surfaces_batch(p_positions, true);
+}
+
+godot::Dictionary LibSM64::surface_find_wall_collisions(const godot::Vector3 &p_position, godot::real_t p_offset_y, godot::real_t p_radius) {
+	struct SM64WallCollisionData collision_data = {}; // NOLINT(cppcoreguidelines-pro-type-member-init)
+	godot_to_sm64(p_position - world_origin, collision_data.x, collision_data.y, collision_data.z, scale_factor);
+	collision_data.offsetY = p_offset_y * scale_factor;
+	collision_data.radius = p_radius * scale_factor;
+	sm64_surface_find_wall_collisions(&collision_data);
+
+	const float position[3] = { collision_data.x, collision_data.y, collision_data.z };
+	godot::PackedVector3Array normals;
+	godot::PackedInt32Array surface_types;
+	godot::PackedInt32Array terrain_types;
+	for (int i = 0; i < collision_data.numWalls && i < 4; i++) {
+		const float normal[3] = { collision_data.walls[i]->normal.x, collision_data.walls[i]->normal.y, collision_data.walls[i]->normal.z };
+		normals.push_back(sm64_3d_to_godot(normal));
+		surface_types.push_back(collision_data.walls[i]->type);
+		terrain_types.push_back(collision_data.walls[i]->terrain);
+	}
+
+	godot::Dictionary result;
+	result["position"] = sm64_3d_to_godot(position, scale_factor) + world_origin;
+	result["normals"] = normals;
+	result["surface_types"] = surface_types;
+	result["terrain_types"] = terrain_types;
+	return result;
+}
+
+godot::Dictionary LibSM64::surface_find_wall_collisions_batch(const godot::PackedVector3Array &p_positions, godot::real_t p_offset_y, godot::real_t p_radius) {
+	const int64_t count = p_positions.size();
+	godot::PackedVector3Array positions;
+	godot::PackedInt32Array wall_counts;
+	positions.resize(count);
+	wall_counts.resize(count);
+	// Walls of every position one after the other, wall_counts gives how many belong to each position
+	godot::PackedVector3Array normals;
+	godot::PackedInt32Array surface_types;
+	godot::PackedInt32Array terrain_types;
+
+	const godot::Vector3 *positions_read = p_positions.ptr();
+	godot::Vector3 *positions_write = positions.ptrw();
+	int32_t *wall_counts_write = wall_counts.ptrw();
+	for (int64_t i = 0; i < count; i++) {
+		struct SM64WallCollisionData collision_data = {}; // NOLINT(cppcoreguidelines-pro-type-member-init)
+		godot_to_sm64(positions_read[i] - world_origin, collision_data.x, collision_data.y, collision_data.z, scale_factor);
+		collision_data.offsetY = p_offset_y * scale_factor;
+		collision_data.radius = p_radius * scale_factor;
+		sm64_surface_find_wall_collisions(&collision_data);
+
+		const float position[3] = { collision_data.x, collision_data.y, collision_data.z };
+		positions_write[i] = sm64_3d_to_godot(position, scale_factor) + world_origin;
+		const int wall_count = godot::MIN(static_cast<int>(collision_data.numWalls), 4);
+		wall_counts_write[i] = wall_count;
+		for (int j = 0; j < wall_count; j++) {
+			const float normal[3] = { collision_data.walls[j]->normal.x, collision_data.walls[j]->normal.y, collision_data.walls[j]->normal.z };
+			normals.push_back(sm64_3d_to_godot(normal));
+			surface_types.push_back(collision_data.walls[j]->type);
+			terrain_types.push_back(collision_data.walls[j]->terrain);
+		}
+	}
+
+	godot::Dictionary result;
+	result["positions"] = positions;
+	result["wall_counts"] = wall_counts;
+	result["normals"] = normals;
+	result["surface_types"] = surface_types;
+	result["terrain_types"] = terrain_types;
+	return result;
+}
+
+godot::real_t LibSM64::surface_find_water_level(const godot::Vector3 &p_position) {
+	float x, y, z;
+	godot_to_sm64(p_position - world_origin, x, y, z, scale_factor);
+	return sm64_surface_find_water_level(x, z) / scale_factor + world_origin.y;
+}
+
+godot::PackedFloat32Array LibSM64::surface_find_water_level_batch(const godot::PackedVector3Array &p_positions) {
+	godot::PackedFloat32Array levels;
+	levels.resize(p_positions.size());
+
+	const godot::Vector3 *positions = p_positions.ptr();
+	float *levels_write = levels.ptrw();
+	for (int64_t i = 0; i < p_positions.size(); i++) {
+		float x, y, z;
+		godot_to_sm64(positions[i] - world_origin, x, y, z, scale_factor);
+		levels_write[i] = sm64_surface_find_water_level(x, z) / scale_factor + world_origin.y;
+	}
+	return levels;
+}
+
+godot::real_t LibSM64::surface_find_poison_gas_level(const godot::Vector3 &p_position) {
+	float x, y, z;
+	godot_to_sm64(p_position - world_origin, x, y, z, scale_factor);
+	return sm64_surface_find_poison_gas_level(x, z) / scale_factor + world_origin.y;
+}
+
+godot::PackedFloat32Array LibSM64::surface_find_poison_gas_level_batch(const godot::PackedVector3Array &p_positions) {
+	godot::PackedFloat32Array levels;
+	levels.resize(p_positions.size());
+
+	const godot::Vector3 *positions = p_positions.ptr();
+	float *levels_write = levels.ptrw();
+	for (int64_t i = 0; i < p_positions.size(); i++) {
+		float x, y, z;
+		godot_to_sm64(positions[i] - world_origin, x, y, z, scale_factor);
+		levels_write[i] = sm64_surface_find_poison_gas_level(x, z) / scale_factor + world_origin.y;
+	}
+	return levels;
+}
+
+bool LibSM64::find_floor(const godot::Vector3 &p_position, SurfaceHit &r_hit) const {
+	float x, y, z;
+	godot_to_sm64(p_position - world_origin, x, y, z, scale_factor);
+
+	struct SM64SurfaceCollisionData *floor = nullptr;
+	const float height = sm64_surface_find_floor(x, y, z, &floor);
+	if (floor == nullptr) {
+		return false;
+	}
+
+	const float normal[3] = { floor->normal.x, floor->normal.y, floor->normal.z };
+	r_hit.height = height / scale_factor + world_origin.y;
+	r_hit.normal = sm64_3d_to_godot(normal);
+	r_hit.surface_type = floor->type;
+	r_hit.terrain_type = floor->terrain;
+	return true;
+}
+
+bool LibSM64::find_ceil(const godot::Vector3 &p_position, SurfaceHit &r_hit) const {
+	float x, y, z;
+	godot_to_sm64(p_position - world_origin, x, y, z, scale_factor);
+
+	struct SM64SurfaceCollisionData *ceil = nullptr;
+	const float height = sm64_surface_find_ceil(x, y, z, &ceil);
+	if (ceil == nullptr) {
+		return false;
+	}
+
+	const float normal[3] = { ceil->normal.x, ceil->normal.y, ceil->normal.z };
+	r_hit.height = height / scale_factor + world_origin.y;
+	r_hit.normal = sm64_3d_to_godot(normal);
+	r_hit.surface_type = ceil->type;
+	r_hit.terrain_type = ceil->terrain;
+	return true;
+}
+
+godot::Dictionary LibSM64::find_surfaces_batch(const godot::PackedVector3Array &p_positions, bool p_ceil) const {
+	const int64_t count = p_positions.size();
+	godot::PackedFloat32Array heights;
+	godot::PackedVector3Array normals;
+	godot::PackedInt32Array surface_types;
+	godot::PackedInt32Array terrain_types;
+	heights.resize(count);
+	normals.resize(count);
+	surface_types.resize(count);
+	terrain_types.resize(count);
+
+	const godot::Vector3 *positions = p_positions.ptr();
+	float *heights_write = heights.ptrw();
+	godot::Vector3 *normals_write = normals.ptrw();
+	int32_t *surface_types_write = surface_types.ptrw();
+	int32_t *terrain_types_write = terrain_types.ptrw();
+	for (int64_t i = 0; i < count; i++) {
+		SurfaceHit hit;
+		if (p_ceil ? find_ceil(positions[i], hit) : find_floor(positions[i], hit)) {
+			heights_write[i] = hit.height;
+			normals_write[i] = hit.normal;
+			surface_types_write[i] = hit.surface_type;
+			terrain_types_write[i] = hit.terrain_type;
+		} else {
+			// Misses are marked with a -1 surface type and an infinite height away from the query
+			heights_write[i] = p_ceil ? std::numeric_limits<float>::infinity() : -std::numeric_limits<float>::infinity();
+			normals_write[i] = godot::Vector3();
+			surface_types_write[i] = -1;
+			terrain_types_write[i] = -1;
+		}
+	}
+
+	godot::Dictionary result;
+	result["heights"] = heights;
+	result["normals"] = normals;
+	result["surface_types"] = surface_types;
+	result["terrain_types"] = terrain_types;
+	return result;
+}
+
+godot::Dictionary LibSM64::surface_raycast(const godot::Vector3 &p_from, const godot::Vector3 &p_to) {
+	prepare_surface_queries();
+
+	SurfaceQueryHit hit;
+	if (!cast_surfaces(p_from, p_to, 0.0, hit)) {
+		return godot::Dictionary();
+	}
+	return surface_query_hit_to_dictionary(hit);
+}
+
+godot::Dictionary LibSM64::surface_raycast_batch(const godot::PackedVector3Array &p_from, const godot::PackedVector3Array &p_to) {
+	ERR_FAIL_COND_V_MSG(p_from.size() != p_to.size(), godot::Dictionary(), "[libsm64-godot] from and to must have the same size.");
+
+	SurfaceQueryBatch batch = { this, p_from.ptr(), p_to.ptr(), 0.0, false, {}, {} };
+	return run_surface_query_batch(batch, p_from.size());
+}
+
+godot::Dictionary LibSM64::surface_sphere_cast(const godot::Vector3 &p_from, const godot::Vector3 &p_to, godot::real_t p_radius) {
+	ERR_FAIL_COND_V(p_radius < 0, godot::Dictionary());
+	prepare_surface_queries();
+
+	SurfaceQueryHit hit;
+	if (!cast_surfaces(p_from, p_to, p_radius, hit)) {
+		return godot::Dictionary();
+	}
+	return surface_query_hit_to_dictionary(hit);
+}
+
+godot::Dictionary LibSM64::surface_sphere_cast_batch(const godot::PackedVector3Array &p_from, const godot::PackedVector3Array &p_to, godot::real_t p_radius) {
+	ERR_FAIL_COND_V_MSG(p_from.size() != p_to.size(), godot::Dictionary(), "[libsm64-godot] from and to must have the same size.");
+	ERR_FAIL_COND_V(p_radius < 0, godot::Dictionary());
+
+	SurfaceQueryBatch batch = { this, p_from.ptr(), p_to.ptr(), p_radius, false, {}, {} };
+	return run_surface_query_batch(batch, p_from.size());
+}
+
+godot::Dictionary LibSM64::surface_closest_point(const godot::Vector3 &p_position, godot::real_t p_max_distance) {
+	ERR_FAIL_COND_V(p_max_distance < 0, godot::Dictionary());
+	prepare_surface_queries();
+
+	SurfaceQueryHit hit;
+	if (!find_closest_surface_point(p_position, p_max_distance, hit)) {
+		return godot::Dictionary();
+	}
+	return surface_query_hit_to_dictionary(hit);
+}
+
+godot::Dictionary LibSM64::surface_closest_point_batch(const godot::PackedVector3Array &p_positions, godot::real_t p_max_distance) {
+	ERR_FAIL_COND_V(p_max_distance < 0, godot::Dictionary());
+
+	SurfaceQueryBatch batch = { this, p_positions.ptr(), nullptr, p_max_distance, true, {}, {} };
+	return run_surface_query_batch(batch, p_positions.size());
+}
+
+void LibSM64::prepare_surface_queries() {
+	// Objects are queried where the next mario_tick would find them
+	flush_surface_object_moves();
+
+	if (static_surfaces_bvh_dirty) {
+		static_surfaces_bvh.build(get_loaded_static_surfaces());
+		static_surfaces_bvh_dirty = false;
+	}
+
+	for (auto &[object_id, object] : surface_objects) {
+		if (object.sm64_object_id < 0 || object.bvh) {
+			continue;
+		}
+
+		// Instanced props share a surface array, so its BVH is only built once
+		std::weak_ptr<SM64SurfaceBVH> &shared_bvh = surface_array_bvhs[object.surfaces.ptr()];
+		object.bvh = shared_bvh.lock();
+		if (!object.bvh) {
+			object.bvh = std::make_shared<SM64SurfaceBVH>();
+			object.bvh->build(object.surfaces->sm64_surfaces);
+			shared_bvh = object.bvh;
+		}
+	}
+}
+
+const std::vector<struct SM64Surface> &LibSM64::get_loaded_static_surfaces() const {
+	return all_static_surfaces_loaded ? static_surfaces : loaded_static_surfaces;
+}
+
+bool LibSM64::cast_surfaces(const godot::Vector3 &p_from, const godot::Vector3 &p_to, godot::real_t p_radius, SurfaceQueryHit &r_hit) const {
+	// Static surfaces are kept without the world origin offset, so the query is converted without it too
+	float from[3], to[3];
+	godot_to_sm64(p_from, from, scale_factor);
+	godot_to_sm64(p_to, to, scale_factor);
+
+	SM64SurfaceHit hit;
+	bool found = false;
+	if (static_surfaces_bvh.cast(from, to, p_radius * scale_factor, hit)) {
+		set_surface_query_hit(hit, get_loaded_static_surfaces(), -1, godot::Transform3D(), r_hit);
+		found = true;
+	}
+
+	const godot::Vector3 direction = p_to - p_from;
+	const godot::real_t length_squared = direction.length_squared();
+	for (const auto &[object_id, object] : surface_objects) {
+		// Parked objects aren't part of Mario's collision either
+		if (object.sm64_object_id < 0 || !object.bvh) {
+			continue;
+		}
+
+		// Bounding sphere against the part of the segment that could still beat the current hit
+		const godot::Transform3D transform(godot::Basis(object.rotation), object.position);
+		const godot::Vector3 center = transform.xform(object.bounds_center);
+		const godot::real_t segment_t = length_squared > 0.0 ? godot::CLAMP((center - p_from).dot(direction) / length_squared, 0.0, hit.fraction) : 0.0;
+		const godot::real_t reach = object.bounds_radius + p_radius;
+		if ((p_from + direction * segment_t).distance_squared_to(center) > reach * reach) {
+			continue;
+		}
+
+		float local_from[3], local_to[3];
+		godot_to_sm64(transform.basis.xform_inv(p_from - object.position), local_from, scale_factor);
+		godot_to_sm64(transform.basis.xform_inv(p_to - object.position), local_to, scale_factor);
+		if (object.bvh->cast(local_from, local_to, p_radius * scale_factor, hit)) {
+			set_surface_query_hit(hit, object.surfaces->sm64_surfaces, static_cast<int>(object_id), transform, r_hit);
+			found = true;
+		}
+	}
+
+	if (found) {
+		r_hit.distance = r_hit.fraction * godot::Math::sqrt(length_squared);
+	}
+	return found;
+}
+
+bool LibSM64::find_closest_surface_point(const godot::Vector3 &p_position, godot::real_t p_max_distance, SurfaceQueryHit &r_hit) const {
+	float position[3];
+	godot_to_sm64(p_position, position, scale_factor);
+
+	SM64SurfaceHit hit;
+	hit.distance = p_max_distance * scale_factor;
+	bool found = false;
+	if (static_surfaces_bvh.closest_point(position, hit)) {
+		set_surface_query_hit(hit, get_loaded_static_surfaces(), -1, godot::Transform3D(), r_hit);
+		found = true;
+	}
+
+	for (const auto &[object_id, object] : surface_objects) {
+		if (object.sm64_object_id < 0 || !object.bvh) {
+			continue;
+		}
+
+		const godot::Transform3D transform(godot::Basis(object.rotation), object.position);
+		if (p_position.distance_to(transform.xform(object.bounds_center)) - object.bounds_radius > hit.distance / scale_factor) {
+			continue;
+		}
+
+		float local_position[3];
+		godot_to_sm64(transform.basis.xform_inv(p_position - object.position), local_position, scale_factor);
+		if (object.bvh->closest_point(local_position, hit)) {
+			set_surface_query_hit(hit, object.surfaces->sm64_surfaces, static_cast<int>(object_id), transform, r_hit);
+			found = true;
+		}
+	}
+
+	if (found) {
+		r_hit.fraction = 0.0;
+		r_hit.distance = hit.distance / scale_factor;
+	}
+	return found;
+}
+
+void LibSM64::set_surface_query_hit(const SM64SurfaceHit &p_hit, const std::vector<struct SM64Surface> &p_surfaces, int p_object_id, const godot::Transform3D &p_transform, SurfaceQueryHit &r_hit) const {
+	const struct SM64Surface &surface = p_surfaces[p_hit.surface_index];
+	r_hit.position = p_transform.xform(sm64_3d_to_godot(p_hit.position, scale_factor));
+	r_hit.normal = p_transform.basis.xform(sm64_3d_to_godot(p_hit.normal));
+	r_hit.fraction = p_hit.fraction;
+	r_hit.surface_type = surface.type;
+	r_hit.terrain_type = surface.terrain;
+	r_hit.object_id = p_object_id;
+}
+
+godot::Dictionary LibSM64::run_surface_query_batch(SurfaceQueryBatch &r_batch, int64_t p_count) {
+	prepare_surface_queries();
+
+	r_batch.hits.resize(p_count);
+	r_batch.found.resize(p_count);
+	if (p_count < SURFACE_QUERY_THREADING_THRESHOLD) {
+		for (int64_t i = 0; i < p_count; i++) {
+			surface_query_task(&r_batch, static_cast<uint32_t>(i));
+		}
+	} else {
+		// The BVHs are only read from here on, so every query can run on its own
+		godot::WorkerThreadPool *worker_thread_pool = godot::WorkerThreadPool::get_singleton();
+		const int64_t group_id = worker_thread_pool->add_native_group_task(&LibSM64::surface_query_task, &r_batch, static_cast<int>(p_count), -1, true, "LibSM64 surface queries");
+		worker_thread_pool->wait_for_group_task_completion(group_id);
+	}
+
+	godot::PackedVector3Array positions;
+	godot::PackedVector3Array normals;
+	godot::PackedFloat32Array distances;
+	godot::PackedInt32Array surface_types;
+	godot::PackedInt32Array terrain_types;
+	godot::PackedInt32Array object_ids;
+	positions.resize(p_count);
+	normals.resize(p_count);
+	distances.resize(p_count);
+	surface_types.resize(p_count);
+	terrain_types.resize(p_count);
+	object_ids.resize(p_count);
+
+	godot::Vector3 *positions_write = positions.ptrw();
+	godot::Vector3 *normals_write = normals.ptrw();
+	float *distances_write = distances.ptrw();
+	int32_t *surface_types_write = surface_types.ptrw();
+	int32_t *terrain_types_write = terrain_types.ptrw();
+	int32_t *object_ids_write = object_ids.ptrw();
+	for (int64_t i = 0; i < p_count; i++) {
+		// Misses keep the default hit: no surface type and the end of the query
+		const SurfaceQueryHit &hit = r_batch.hits[i];
+		positions_write[i] = r_batch.found[i] ? hit.position : (r_batch.closest_point ? r_batch.from[i] : r_batch.to[i]);
+		normals_write[i] = hit.normal;
+		distances_write[i] = r_batch.found[i] ? hit.distance : std::numeric_limits<float>::infinity();
+		surface_types_write[i] = hit.surface_type;
+		terrain_types_write[i] = hit.terrain_type;
+		object_ids_write[i] = hit.object_id;
+	}
+
+	godot::Dictionary result;
+	result["positions"] = positions;
+	result["normals"] = normals;
+	result["distances"] = distances;
+	result["surface_types"] = surface_types;
+	result["terrain_types"] = terrain_types;
+	result["object_ids"] = object_ids;
+	return result;
+}
+
+void LibSM64::surface_query_task(void *p_userdata, uint32_t p_index) {
+	auto *batch = static_cast<SurfaceQueryBatch *>(p_userdata);
+	SurfaceQueryHit &hit = batch->hits[p_index];
+	if (batch->closest_point) {
+		batch->found[p_index] = batch->libsm64->find_closest_surface_point(batch->from[p_index], batch->radius, hit);
+	} else {
+		batch->found[p_index] = batch->libsm64->cast_surfaces(batch->from[p_index], batch->to[p_index], batch->radius, hit);
+	}
+}
+
+godot::Dictionary LibSM64::surface_query_hit_to_dictionary(const SurfaceQueryHit &p_hit) {
+	godot::Dictionary result;
+	result["position"] = p_hit.position;
+	result["normal"] = p_hit.normal;
+	result["distance"] = p_hit.distance;
+	result["surface_type"] = p_hit.surface_type;
+	result["terrain_type"] = p_hit.terrain_type;
+	result["object_id"] = p_hit.object_id;
+	return result;
+}
+
+int LibSM64::level_volume_add(LevelVolumeType p_type, const godot::AABB &p_bounds) {
+	ERR_FAIL_INDEX_V(p_type, 2, -1);
+	ERR_FAIL_COND_V_MSG(p_bounds.size.x < 0 || p_bounds.size.y < 0 || p_bounds.size.z < 0, -1, "[libsm64-godot] Level volume bounds can't have a negative size.");
+
+	LevelVolume volume;
+	volume.type = p_type;
+	volume.bounds = p_bounds;
+	return add_level_volume(std::move(volume));
+}
+
+int LibSM64::level_volume_add_box(LevelVolumeType p_type, const godot::Transform3D &p_transform, const godot::Vector3 &p_size) {
+	godot::Array planes;
+	for (int i = 0; i < 3; i++) {
+		const godot::Vector3 axis = p_transform.basis.get_column(i);
+		const godot::real_t axis_length = axis.length();
+		ERR_FAIL_COND_V_MSG(axis_length <= 0.0, -1, "[libsm64-godot] Level volume box transform can't have a zero scale.");
+
+		const godot::Vector3 normal = axis / axis_length;
+		const godot::real_t extent = p_size[i] * 0.5 * axis_length;
+		const godot::real_t center_distance = normal.dot(p_transform.origin);
+		planes.push_back(godot::Plane(normal, center_distance + extent));
+		planes.push_back(godot::Plane(-normal, -center_distance + extent));
+	}
+	return level_volume_add_convex(p_type, planes);
+}
+
+int LibSM64::level_volume_add_convex(LevelVolumeType p_type, const godot::Array &p_planes) {
+	ERR_FAIL_INDEX_V(p_type, 2, -1);
+	LevelVolume volume;
+	volume.type = p_type;
+	volume.planes.reserve(p_planes.size());
+	for (int64_t i = 0; i < p_planes.size(); i++) {
+		ERR_FAIL_COND_V_MSG(p_planes[i].get_type() != godot::Variant::PLANE, -1, "[libsm64-godot] Level volume planes must be Plane values.");
+		volume.planes.push_back(p_planes[i]);
+	}
+
+	// The bounds are made of the corners where 3 planes meet inside every other plane
+	bool has_corner = false;
+	const size_t plane_count = volume.planes.size();
+	for (size_t i = 0; i < plane_count; i++) {
+		for (size_t j = i + 1; j < plane_count; j++) {
+			for (size_t k = j + 1; k < plane_count; k++) {
+				const godot::Plane &a = volume.planes[i];
+				const godot::Plane &b = volume.planes[j];
+				const godot::Plane &c = volume.planes[k];
+				const godot::real_t determinant = a.normal.dot(b.normal.cross(c.normal));
+				if (godot::Math::abs(determinant) < CMP_EPSILON) {
+					continue;
+				}
+
+				const godot::Vector3 corner = (b.normal.cross(c.normal) * a.d + c.normal.cross(a.normal) * b.d + a.normal.cross(b.normal) * c.d) / determinant;
+				bool inside = true;
+				for (const godot::Plane &plane : volume.planes) {
+					if (plane.distance_to(corner) > CMP_EPSILON * 100.0) {
+						inside = false;
+						break;
+					}
+				}
+				if (!inside) {
+					continue;
+				}
+
+				if (has_corner) {
+					volume.bounds.expand_to(corner);
+				} else {
+					volume.bounds = godot::AABB(corner, godot::Vector3());
+					has_corner = true;
+				}
+			}
+		}
+	}
+	ERR_FAIL_COND_V_MSG(!has_corner, -1, "[libsm64-godot] Level volume planes don't enclose a bounded volume.");
+
+	return add_level_volume(std::move(volume));
+}
+
+void LibSM64::level_volume_remove(int p_volume_id) {
+	auto it = level_volumes.find(static_cast<uint32_t>(p_volume_id));
+	ERR_FAIL_COND_MSG(it == level_volumes.end(), godot::vformat("[libsm64-godot] Level volume %d doesn't exist.", p_volume_id));
+
+	erase_level_volume_cells(it->first, it->second);
+	const LevelVolumeType type = it->second.type;
+	level_volumes.erase(it);
+	if (--level_volume_counts[type] == 0) {
+		clear_mario_volume_levels(type);
+	}
+}
+
+void LibSM64::level_volume_clear() {
+	level_volumes.clear();
+	level_volume_cells.clear();
+	large_level_volumes.clear();
+	level_volume_counts[LEVEL_VOLUME_WATER] = 0;
+	level_volume_counts[LEVEL_VOLUME_GAS] = 0;
+	clear_mario_volume_levels(LEVEL_VOLUME_WATER);
+	clear_mario_volume_levels(LEVEL_VOLUME_GAS);
+}
+
+int LibSM64::get_level_volume_count() const {
+	return static_cast<int>(level_volumes.size());
+}
+
+void LibSM64::set_level_volume_cell_size(godot::real_t p_value) {
+	ERR_FAIL_COND(p_value <= 0);
+	level_volume_cell_size = p_value;
+
+	level_volume_cells.clear();
+	large_level_volumes.clear();
+	for (const auto &[volume_id, volume] : level_volumes) {
+		insert_level_volume_cells(volume_id, volume);
+	}
+}
+
+godot::real_t LibSM64::get_level_volume_cell_size() const {
+	return level_volume_cell_size;
+}
+
+int LibSM64::add_level_volume(LevelVolume &&p_volume) {
+	const uint32_t volume_id = next_level_volume_id++;
+	level_volume_counts[p_volume.type]++;
+	LevelVolume &volume = level_volumes[volume_id];
+	volume = std::move(p_volume);
+	insert_level_volume_cells(volume_id, volume);
+	return static_cast<int>(volume_id);
+}
+
+bool LibSM64::get_level_volume_cells(const godot::AABB &p_bounds, int64_t *r_min_cell, int64_t *r_max_cell) const {
+	const godot::Vector3 end = p_bounds.get_end();
+	r_min_cell[0] = static_cast<int64_t>(godot::Math::floor(p_bounds.position.x / level_volume_cell_size));
+	r_min_cell[1] = static_cast<int64_t>(godot::Math::floor(p_bounds.position.z / level_volume_cell_size));
+	r_max_cell[0] = static_cast<int64_t>(godot::Math::floor(end.x / level_volume_cell_size));
+	r_max_cell[1] = static_cast<int64_t>(godot::Math::floor(end.z / level_volume_cell_size));
+	return (r_max_cell[0] - r_min_cell[0] + 1) * (r_max_cell[1] - r_min_cell[1] + 1) <= LEVEL_VOLUME_MAX_CELLS;
+}
+
+void LibSM64::insert_level_volume_cells(uint32_t p_volume_id, const LevelVolume &p_volume) {
+	int64_t min_cell[2], max_cell[2];
+	if (!get_level_volume_cells(p_volume.bounds, min_cell, max_cell)) {
+		large_level_volumes.push_back(p_volume_id);
+		return;
+	}
+
+	for (int64_t x = min_cell[0]; x <= max_cell[0]; x++) {
+		for (int64_t z = min_cell[1]; z <= max_cell[1]; z++) {
+			level_volume_cells[level_volume_cell_key(x, z)].push_back(p_volume_id);
+		}
+	}
+}
+
+void LibSM64::erase_level_volume_cells(uint32_t p_volume_id, const LevelVolume &p_volume) {
+	int64_t min_cell[2], max_cell[2];
+	if (!get_level_volume_cells(p_volume.bounds, min_cell, max_cell)) {
+		large_level_volumes.erase(std::remove(large_level_volumes.begin(), large_level_volumes.end(), p_volume_id), large_level_volumes.end());
+		return;
+	}
+
+	for (int64_t x = min_cell[0]; x <= max_cell[0]; x++) {
+		for (int64_t z = min_cell[1]; z <= max_cell[1]; z++) {
+			auto it = level_volume_cells.find(level_volume_cell_key(x, z));
+			if (it == level_volume_cells.end()) {
+				continue;
+			}
+			std::vector<uint32_t> &cell = it->second;
+			cell.erase(std::remove(cell.begin(), cell.end(), p_volume_id), cell.end());
+			if (cell.empty()) {
+				level_volume_cells.erase(it);
+			}
+		}
+	}
+}
+
+bool LibSM64::find_level_volume_level(LevelVolumeType p_type, const godot::Vector3 &p_position, godot::real_t &r_level) const {
+	bool found = false;
+	auto check_volume = [&](uint32_t p_volume_id) {
+		const LevelVolume &volume = level_volumes.at(p_volume_id);
+		if (volume.type != p_type) {
+			return;
+		}
+
+		// Vertical extent of the volume on Mario's column
+		godot::real_t bottom, top;
+		if (volume.planes.empty()) {
+			const godot::Vector3 end = volume.bounds.get_end();
+			if (p_position.x < volume.bounds.position.x || p_position.x > end.x || p_position.z < volume.bounds.position.z || p_position.z > end.z) {
+				return;
+			}
+			bottom = volume.bounds.position.y;
+			top = end.y;
+		} else {
+			bottom = -std::numeric_limits<godot::real_t>::infinity();
+			top = std::numeric_limits<godot::real_t>::infinity();
+			for (const godot::Plane &plane : volume.planes) {
+				const godot::real_t horizontal = plane.d - plane.normal.x * p_position.x - plane.normal.z * p_position.z;
+				if (godot::Math::abs(plane.normal.y) < CMP_EPSILON) {
+					if (horizontal < 0.0) {
+						return;
+					}
+				} else if (plane.normal.y > 0.0) {
+					top = godot::MIN(top, horizontal / plane.normal.y);
+				} else {
+					bottom = godot::MAX(bottom, horizontal / plane.normal.y);
+				}
+			}
+			if (bottom > top) {
+				return;
+			}
+		}
+
+		// Volumes entirely above Mario don't count, the highest surface among the ones he's in or above wins
+		if (p_position.y < bottom || (found && top <= r_level)) {
+			return;
+		}
+		r_level = top;
+		found = true;
+	};
+
+	const int64_t cell_x = static_cast<int64_t>(godot::Math::floor(p_position.x / level_volume_cell_size));
+	const int64_t cell_z = static_cast<int64_t>(godot::Math::floor(p_position.z / level_volume_cell_size));
+	auto it = level_volume_cells.find(level_volume_cell_key(cell_x, cell_z));
+	if (it != level_volume_cells.end()) {
+		for (const uint32_t volume_id : it->second) {
+			check_volume(volume_id);
+		}
+	}
+	for (const uint32_t volume_id : large_level_volumes) {
+		check_volume(volume_id);
+	}
+
+	return found;
+}
+
+void LibSM64::update_mario_level_volumes(int32_t p_mario_id) {
+	if (level_volume_counts[LEVEL_VOLUME_WATER] == 0 && level_volume_counts[LEVEL_VOLUME_GAS] == 0) {
+		return;
+	}
+
+	auto it = mario_origin_states.find(p_mario_id);
+	if (it == mario_origin_states.end()) {
+		return;
+	}
+	MarioOriginState &mario_origin_state = it->second;
+	const godot::Vector3 position = sm64_3d_to_godot(mario_origin_state.position, scale_factor) + world_origin;
+
+	// libsm64 is only called when a level actually changes
+	godot::real_t level;
+	if (level_volume_counts[LEVEL_VOLUME_WATER] > 0) {
+		if (find_level_volume_level(LEVEL_VOLUME_WATER, position, level)) {
+			if (!mario_origin_state.has_water_level || mario_origin_state.water_level != level) {
+				set_mario_water_level(p_mario_id, level);
+			}
+			mario_origin_state.water_level_from_volume = true;
+		} else if (mario_origin_state.has_water_level) {
+			sm64_set_mario_water_level(p_mario_id, SM64_NO_LEVEL);
+			mario_origin_state.has_water_level = false;
+			mario_origin_state.water_level_from_volume = false;
+		}
+	}
+	if (level_volume_counts[LEVEL_VOLUME_GAS] > 0) {
+		if (find_level_volume_level(LEVEL_VOLUME_GAS, position, level)) {
+			if (!mario_origin_state.has_gas_level || mario_origin_state.gas_level != level) {
+				set_mario_gas_level(p_mario_id, level);
+			}
+			mario_origin_state.gas_level_from_volume = true;
+		} else if (mario_origin_state.has_gas_level) {
+			sm64_set_mario_gas_level(p_mario_id, SM64_NO_LEVEL);
+			mario_origin_state.has_gas_level = false;
+			mario_origin_state.gas_level_from_volume = false;
+		}
+	}
+}
+
+void LibSM64::clear_mario_volume_levels(LevelVolumeType p_type) {
+	// update_mario_level_volumes stops once the last volume of a type is removed, so the levels it set would stay forever
+	for (auto &[mario_id, mario_origin_state] : mario_origin_states) {
+		if (p_type == LEVEL_VOLUME_WATER && mario_origin_state.water_level_from_volume) {
+			sm64_set_mario_water_level(mario_id, SM64_NO_LEVEL);
+			mario_origin_state.has_water_level = false;
+			mario_origin_state.water_level_from_volume = false;
+		} else if (p_type == LEVEL_VOLUME_GAS && mario_origin_state.gas_level_from_volume) {
+			sm64_set_mario_gas_level(mario_id, SM64_NO_LEVEL);
+			mario_origin_state.has_gas_level = false;
+			mario_origin_state.gas_level_from_volume = false;
+		}
+	}
 }
 
 void LibSM64::seq_player_play_sequence(SeqPlayer p_player, SeqId p_seq_id, double p_fade_in_time) {
@@ -511,7 +1883,7 @@ uint16_t LibSM64::get_current_background_music() {
 
 void LibSM64::play_sound(godot::BitField<SoundBits> p_sound_bits, const godot::Vector3 &p_position) {
 	float pos[3];
-	godot_to_sm64(p_position, pos, scale_factor);
+	godot_to_sm64(p_position - world_origin, pos, scale_factor);
 	sm64_play_sound(static_cast<uint32_t>(p_sound_bits), pos);
 }
 
@@ -528,6 +1900,26 @@ void LibSM64::_bind_methods() {
 	godot::ClassDB::bind_method(godot::D_METHOD("get_scale_factor"), &LibSM64::get_scale_factor);
 	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::FLOAT, "scale_factor"), "set_scale_factor", "get_scale_factor");
 
+	godot::ClassDB::bind_method(godot::D_METHOD("set_world_origin", "value"), &LibSM64::set_world_origin);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_world_origin"), &LibSM64::get_world_origin);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::VECTOR3, "world_origin"), "set_world_origin", "get_world_origin");
+
+	godot::ClassDB::bind_method(godot::D_METHOD("set_world_origin_threshold", "value"), &LibSM64::set_world_origin_threshold);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_world_origin_threshold"), &LibSM64::get_world_origin_threshold);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::FLOAT, "world_origin_threshold"), "set_world_origin_threshold", "get_world_origin_threshold");
+
+	godot::ClassDB::bind_method(godot::D_METHOD("set_surface_object_activation_distance", "value"), &LibSM64::set_surface_object_activation_distance);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_surface_object_activation_distance"), &LibSM64::get_surface_object_activation_distance);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::FLOAT, "surface_object_activation_distance"), "set_surface_object_activation_distance", "get_surface_object_activation_distance");
+
+	godot::ClassDB::bind_method(godot::D_METHOD("set_surface_object_capacity", "value"), &LibSM64::set_surface_object_capacity);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_surface_object_capacity"), &LibSM64::get_surface_object_capacity);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::INT, "surface_object_capacity"), "set_surface_object_capacity", "get_surface_object_capacity");
+
+	godot::ClassDB::bind_method(godot::D_METHOD("set_level_volume_cell_size", "value"), &LibSM64::set_level_volume_cell_size);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_level_volume_cell_size"), &LibSM64::get_level_volume_cell_size);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::FLOAT, "level_volume_cell_size"), "set_level_volume_cell_size", "get_level_volume_cell_size");
+
 	godot::ClassDB::bind_method(godot::D_METHOD("get_tick_delta_time"), &LibSM64::get_tick_delta_time);
 	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::FLOAT, "tick_delta_time"), "", "get_tick_delta_time");
 
@@ -541,6 +1933,8 @@ void LibSM64::_bind_methods() {
 	godot::ClassDB::bind_method(godot::D_METHOD("audio_tick", "queued_frames", "desired_frames"), &LibSM64::audio_tick);
 
 	godot::ClassDB::bind_method(godot::D_METHOD("static_surfaces_load", "surfaces"), &LibSM64::static_surfaces_load);
+	godot::ClassDB::bind_method(godot::D_METHOD("static_surfaces_add", "surfaces"), &LibSM64::static_surfaces_add);
+	godot::ClassDB::bind_method(godot::D_METHOD("static_surfaces_remove", "group_id"), &LibSM64::static_surfaces_remove);
 
 	godot::ClassDB::bind_method(godot::D_METHOD("mario_create", "position"), &LibSM64::mario_create);
 	godot::ClassDB::bind_method(godot::D_METHOD("mario_tick", "mario_id", "mario_inputs"), &LibSM64::mario_tick);
@@ -558,6 +1952,8 @@ void LibSM64::_bind_methods() {
 	godot::ClassDB::bind_method(godot::D_METHOD("set_mario_invincibility", "mario_id", "time"), &LibSM64::set_mario_invincibility);
 	godot::ClassDB::bind_method(godot::D_METHOD("set_mario_water_level", "mario_id", "level"), &LibSM64::set_mario_water_level);
 	godot::ClassDB::bind_method(godot::D_METHOD("set_mario_gas_level", "mario_id", "level"), &LibSM64::set_mario_gas_level);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_mario_water_level", "mario_id"), &LibSM64::get_mario_water_level);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_mario_gas_level", "mario_id"), &LibSM64::get_mario_gas_level);
 	godot::ClassDB::bind_method(godot::D_METHOD("set_mario_health", "mario_id", "health"), &LibSM64::set_mario_health);
 	godot::ClassDB::bind_method(godot::D_METHOD("mario_take_damage", "mario_id", "damage", "subtype", "position"), &LibSM64::mario_take_damage);
 	godot::ClassDB::bind_method(godot::D_METHOD("mario_heal", "mario_id", "heal_counter"), &LibSM64::mario_heal);
@@ -568,7 +1964,39 @@ void LibSM64::_bind_methods() {
 
 	godot::ClassDB::bind_method(godot::D_METHOD("surface_object_create", "position", "rotation", "surfaces"), &LibSM64::surface_object_create);
 	godot::ClassDB::bind_method(godot::D_METHOD("surface_object_move", "object_id", "position", "rotation"), &LibSM64::surface_object_move);
+	godot::ClassDB::bind_method(godot::D_METHOD("surface_object_move_batch", "object_ids", "transforms"), &LibSM64::surface_object_move_batch);
+	godot::ClassDB::bind_method(godot::D_METHOD("surface_object_queue_move", "object_id", "transform"), &LibSM64::surface_object_queue_move);
+	godot::ClassDB::bind_method(godot::D_METHOD("flush_surface_object_moves"), &LibSM64::flush_surface_object_moves);
 	godot::ClassDB::bind_method(godot::D_METHOD("surface_object_delete", "object_id"), &LibSM64::surface_object_delete);
+	godot::ClassDB::bind_method(godot::D_METHOD("update_surface_object_activation"), &LibSM64::update_surface_object_activation);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_active_surface_object_count"), &LibSM64::get_active_surface_object_count);
+	godot::ClassDB::bind_method(godot::D_METHOD("surface_objects_create", "transforms", "surfaces"), &LibSM64::surface_objects_create);
+	godot::ClassDB::bind_method(godot::D_METHOD("surface_objects_delete", "object_ids"), &LibSM64::surface_objects_delete);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_surface_object_stats"), &LibSM64::get_surface_object_stats);
+
+	godot::ClassDB::bind_method(godot::D_METHOD("surface_find_floor", "position"), &LibSM64::surface_find_floor);
+	godot::ClassDB::bind_method(godot::D_METHOD("surface_find_floor_batch", "positions"), &LibSM64::surface_find_floor_batch);
+	godot::ClassDB::bind_method(godot::D_METHOD("surface_find_ceil", "position"), &LibSM64::surface_find_ceil);
+	godot::ClassDB::bind_method(godot::D_METHOD("surface_find_ceil_batch", "positions"), &LibSM64::surface_find_ceil_batch);
+	godot::ClassDB::bind_method(godot::D_METHOD("surface_find_wall_collisions", "position", "offset_y", "radius"), &LibSM64::surface_find_wall_collisions);
+	godot::ClassDB::bind_method(godot::D_METHOD("surface_find_wall_collisions_batch", "positions", "offset_y", "radius"), &LibSM64::surface_find_wall_collisions_batch);
+	godot::ClassDB::bind_method(godot::D_METHOD("surface_find_water_level", "position"), &LibSM64::surface_find_water_level);
+	godot::ClassDB::bind_method(godot::D_METHOD("surface_find_water_level_batch", "positions"), &LibSM64::surface_find_water_level_batch);
+	godot::ClassDB::bind_method(godot::D_METHOD("surface_find_poison_gas_level", "position"), &LibSM64::surface_find_poison_gas_level);
+	godot::ClassDB::bind_method(godot::D_METHOD("surface_find_poison_gas_level_batch", "positions"), &LibSM64::surface_find_poison_gas_level_batch);
+	godot::ClassDB::bind_method(godot::D_METHOD("surface_raycast", "from", "to"), &LibSM64::surface_raycast);
+	godot::ClassDB::bind_method(godot::D_METHOD("surface_raycast_batch", "from", "to"), &LibSM64::surface_raycast_batch);
+	godot::ClassDB::bind_method(godot::D_METHOD("surface_sphere_cast", "from", "to", "radius"), &LibSM64::surface_sphere_cast);
+	godot::ClassDB::bind_method(godot::D_METHOD("surface_sphere_cast_batch", "from", "to", "radius"), &LibSM64::surface_sphere_cast_batch);
+	godot::ClassDB::bind_method(godot::D_METHOD("surface_closest_point", "position", "max_distance"), &LibSM64::surface_closest_point);
+	godot::ClassDB::bind_method(godot::D_METHOD("surface_closest_point_batch", "positions", "max_distance"), &LibSM64::surface_closest_point_batch);
+
+	godot::ClassDB::bind_method(godot::D_METHOD("level_volume_add", "type", "bounds"), &LibSM64::level_volume_add);
+	godot::ClassDB::bind_method(godot::D_METHOD("level_volume_add_box", "type", "transform", "size"), &LibSM64::level_volume_add_box);
+	godot::ClassDB::bind_method(godot::D_METHOD("level_volume_add_convex", "type", "planes"), &LibSM64::level_volume_add_convex);
+	godot::ClassDB::bind_method(godot::D_METHOD("level_volume_remove", "volume_id"), &LibSM64::level_volume_remove);
+	godot::ClassDB::bind_method(godot::D_METHOD("level_volume_clear"), &LibSM64::level_volume_clear);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_level_volume_count"), &LibSM64::get_level_volume_count);
 
 	godot::ClassDB::bind_method(godot::D_METHOD("seq_player_play_sequence", "player", "seq_id", "fade_in_time"), &LibSM64::seq_player_play_sequence, DEFVAL(0.0));
 	godot::ClassDB::bind_method(godot::D_METHOD("play_music", "player", "seq_args", "fade_in_time"), &LibSM64::play_music, DEFVAL(0.0));
@@ -1749,4 +3177,7 @@ void LibSM64::_bind_methods() {
 	BIND_BITFIELD_FLAG(SOUND_OBJ2_MONTY_MOLE_APPEAR);
 	BIND_BITFIELD_FLAG(SOUND_OBJ2_BOSS_DIALOG_GRUNT);
 	BIND_BITFIELD_FLAG(SOUND_OBJ2_MRI_SPINNING);
+
+	BIND_ENUM_CONSTANT(LEVEL_VOLUME_WATER);
+	BIND_ENUM_CONSTANT(LEVEL_VOLUME_GAS);
 }
@@ -1,6 +1,11 @@
 #ifndef LIBSM64GD_LIBSM64_H
 #define LIBSM64GD_LIBSM64_H
 
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
 #include <godot_cpp/core/class_db.hpp>
 
 #include <godot_cpp/classes/image.hpp>
@@ -10,6 +15,8 @@
 
 #include <libsm64.h>
 
+#include <libsm64_surface_bvh.hpp>
+
 class LibSM64MarioInputs;
 class LibSM64SurfaceArray;
 
@@ -1385,9 +1392,20 @@ public:
 	#define INT_SUBTYPE_BIG_KNOCKBACK 0x00000008 /* Used by Bowser, sets Mario's forward velocity to 40 on hit */
 	// clang-format on
 
+	enum LevelVolumeType {
+		LEVEL_VOLUME_WATER,
+		LEVEL_VOLUME_GAS,
+	};
+
 	void set_scale_factor(godot::real_t p_value);
 	godot::real_t get_scale_factor() const;
 
+	void set_world_origin(const godot::Vector3 &p_value);
+	godot::Vector3 get_world_origin() const;
+
+	void set_world_origin_threshold(godot::real_t p_value);
+	godot::real_t get_world_origin_threshold() const;
+
 	double get_tick_delta_time() const;
 
 	// typedef void (*SM64DebugPrintFunctionPtr)( const char * );
@@ -1404,6 +1422,9 @@ public:
 	godot::Ref<godot::Image> global_init(const godot::PackedByteArray &p_rom);
 	// extern SM64_LIB_FN void sm64_global_terminate( void );
 	void global_terminate();
+	bool is_initialized() const;
+	// Incremented by every global_init, so IDs from a previous initialization can be told apart
+	uint64_t get_init_generation() const;
 
 	// extern SM64_LIB_FN void sm64_audio_init( const uint8_t *rom );
 	void audio_init(const godot::PackedByteArray &p_rom);
@@ -1412,6 +1433,8 @@ public:
 
 	// extern SM64_LIB_FN void sm64_static_surfaces_load( const struct SM64Surface *surfaceArray, uint32_t numSurfaces );
 	void static_surfaces_load(const godot::Ref<LibSM64SurfaceArray> &p_surfaces);
+	int static_surfaces_add(const godot::Ref<LibSM64SurfaceArray> &p_surfaces);
+	void static_surfaces_remove(int p_group_id);
 
 	// extern SM64_LIB_FN int32_t sm64_mario_create( float x, float y, float z );
 	int32_t mario_create(const godot::Vector3 &p_position);
@@ -1446,6 +1469,8 @@ public:
 	void set_mario_water_level(int32_t p_mario_id, godot::real_t p_level);
 	// extern SM64_LIB_FN void sm64_set_mario_gas_level(int32_t marioId, signed int level);
 	void set_mario_gas_level(int32_t p_mario_id, godot::real_t p_level);
+	godot::real_t get_mario_water_level(int32_t p_mario_id) const;
+	godot::real_t get_mario_gas_level(int32_t p_mario_id) const;
 	// extern SM64_LIB_FN void sm64_set_mario_health(int32_t marioId, uint16_t health);
 	void set_mario_health(int32_t p_mario_id, uint16_t p_health);
 	// extern SM64_LIB_FN void sm64_mario_take_damage(int32_t marioId, uint32_t damage, uint32_t subtype, float x, float y, float z);
@@ -1465,17 +1490,57 @@ public:
 	int surface_object_create(const godot::Vector3 &p_position, const godot::Quaternion &p_rotation, const godot::Ref<LibSM64SurfaceArray> &p_surfaces);
 	// extern SM64_LIB_FN void sm64_surface_object_move( uint32_t objectId, const struct SM64ObjectTransform *transform );
 	void surface_object_move(uint32_t p_object_id, const godot::Vector3 &p_position, const godot::Quaternion &p_rotation);
+	int surface_object_move_batch(const godot::PackedInt32Array &p_object_ids, const godot::Array &p_transforms);
+	void surface_object_queue_move(uint32_t p_object_id, const godot::Transform3D &p_transform);
+	int flush_surface_object_moves();
 	// extern SM64_LIB_FN void sm64_surface_object_delete( uint32_t objectId );
 	void surface_object_delete(uint32_t p_object_id);
 
+	void set_surface_object_activation_distance(godot::real_t p_value);
+	godot::real_t get_surface_object_activation_distance() const;
+	int update_surface_object_activation();
+	int get_active_surface_object_count() const;
+
+	godot::PackedInt32Array surface_objects_create(const godot::Array &p_transforms, const godot::Array &p_surfaces);
+	int surface_objects_delete(const godot::PackedInt32Array &p_object_ids);
+	void set_surface_object_capacity(int p_value);
+	int get_surface_object_capacity() const;
+	godot::Dictionary get_surface_object_stats() const;
+
 	// extern SM64_LIB_FN int32_t sm64_surface_find_wall_collision( float *xPtr, float *yPtr, float *zPtr, float offsetY, float radius );
 	// extern SM64_LIB_FN int32_t sm64_surface_find_wall_collisions( struct SM64WallCollisionData *colData );
+	godot::Dictionary surface_find_wall_collisions(const godot::Vector3 &p_position, godot::real_t p_offset_y, godot::real_t p_radius);
+	godot::Dictionary surface_find_wall_collisions_batch(const godot::PackedVector3Array &p_positions, godot::real_t p_offset_y, godot::real_t p_radius);
 	// extern SM64_LIB_FN float sm64_surface_find_ceil( float posX, float posY, float posZ, struct SM64SurfaceCollisionData **pceil );
+	godot::Dictionary surface_find_ceil(const godot::Vector3 &p_position);
+	godot::Dictionary surface_find_ceil_batch(const godot::PackedVector3Array &p_positions);
 	// extern SM64_LIB_FN float sm64_surface_find_floor_height_and_data( float xPos, float yPos, float zPos, struct SM64FloorCollisionData **floorGeo );
 	// extern SM64_LIB_FN float sm64_surface_find_floor_height( float x, float y, float z );
 	// extern SM64_LIB_FN float sm64_surface_find_floor( float xPos, float yPos, float zPos, struct SM64SurfaceCollisionData **pfloor );
+	godot::Dictionary surface_find_floor(const godot::Vector3 &p_position);
+	godot::Dictionary surface_find_floor_batch(const godot::PackedVector3Array &p_positions);
 	// extern SM64_LIB_FN float sm64_surface_find_water_level( float x, float z );
+	godot::real_t surface_find_water_level(const godot::Vector3 &p_position);
+	godot::PackedFloat32Array surface_find_water_level_batch(const godot::PackedVector3Array &p_positions);
 	// extern SM64_LIB_FN float sm64_surface_find_poison_gas_level( float x, float z );
+	godot::real_t surface_find_poison_gas_level(const godot::Vector3 &p_position);
+	godot::PackedFloat32Array surface_find_poison_gas_level_batch(const godot::PackedVector3Array &p_positions);
+
+	godot::Dictionary surface_raycast(const godot::Vector3 &p_from, const godot::Vector3 &p_to);
+	godot::Dictionary surface_raycast_batch(const godot::PackedVector3Array &p_from, const godot::PackedVector3Array &p_to);
+	godot::Dictionary surface_sphere_cast(const godot::Vector3 &p_from, const godot::Vector3 &p_to, godot::real_t p_radius);
+	godot::Dictionary surface_sphere_cast_batch(const godot::PackedVector3Array &p_from, const godot::PackedVector3Array &p_to, godot::real_t p_radius);
+	godot::Dictionary surface_closest_point(const godot::Vector3 &p_position, godot::real_t p_max_distance);
+	godot::Dictionary surface_closest_point_batch(const godot::PackedVector3Array &p_positions, godot::real_t p_max_distance);
+
+	int level_volume_add(LevelVolumeType p_type, const godot::AABB &p_bounds);
+	int level_volume_add_box(LevelVolumeType p_type, const godot::Transform3D &p_transform, const godot::Vector3 &p_size);
+	int level_volume_add_convex(LevelVolumeType p_type, const godot::Array &p_planes);
+	void level_volume_remove(int p_volume_id);
+	void level_volume_clear();
+	int get_level_volume_count() const;
+	void set_level_volume_cell_size(godot::real_t p_value);
+	godot::real_t get_level_volume_cell_size() const;
 
 	// extern SM64_LIB_FN void sm64_seq_player_play_sequence(uint8_t player, uint8_t seqId, uint16_t arg2);
 	void seq_player_play_sequence(SeqPlayer p_player, SeqId p_seq_id, double p_fade_in_time = 0.0);
@@ -1498,8 +1563,170 @@ protected:
 	static void _bind_methods();
 
 private:
+	struct MarioGeometryCache {
+		uint64_t hash = 0;
+		godot::Array array_mesh_triangles;
+	};
+
+	// Mario state that depends on the world origin, in libsm64 units relative to the origin
+	struct MarioOriginState {
+		float position[3] = { 0.0f, 0.0f, 0.0f };
+		bool has_water_level = false;
+		godot::real_t water_level = 0.0;
+		bool has_gas_level = false;
+		godot::real_t gas_level = 0.0;
+		// Set when the level comes from a level volume rather than set_mario_water_level or set_mario_gas_level
+		bool water_level_from_volume = false;
+		bool gas_level_from_volume = false;
+	};
+
+	struct SurfaceObject {
+		godot::Vector3 position;
+		godot::Quaternion rotation;
+		// Compared exactly by surface_object_move_batch to skip objects that didn't move
+		godot::Basis basis;
+		// ID inside libsm64, -1 while the object is parked
+		int64_t sm64_object_id = -1;
+		// Exact position in libsm64 units without the world origin offset, used instead of position by static surface groups
+		bool has_sm64_position = false;
+		int32_t sm64_position[3] = { 0, 0, 0 };
+		// Kept to create the object again when it's activated, shared with every object created from the same array
+		godot::Ref<LibSM64SurfaceArray> surfaces;
+		// Bounding sphere in the object's space
+		godot::Vector3 bounds_center;
+		godot::real_t bounds_radius = 0.0;
+		// Built over the surfaces in the object's space by the first query reaching it, shared by the objects with the same surfaces
+		std::shared_ptr<SM64SurfaceBVH> bvh;
+	};
+
+	void load_static_surfaces();
+	void release_surface_object_slot(uint32_t p_object_id);
+	int add_surface_object(const godot::Vector3 &p_position, const godot::Quaternion &p_rotation, const godot::Ref<LibSM64SurfaceArray> &p_surfaces, const int32_t *p_sm64_position);
+	bool move_surface_object(SurfaceObject &r_object, const godot::Transform3D &p_transform);
+	void get_surface_object_sm64_position(const SurfaceObject &p_object, float *r_position) const;
+	void sm64_move_surface_object(const SurfaceObject &p_object);
+	void activate_surface_object(SurfaceObject &r_object);
+	void park_surface_object(SurfaceObject &r_object);
+	bool is_surface_object_near(const SurfaceObject &p_object, const std::vector<godot::Vector3> &p_positions, godot::real_t p_distance) const;
+	std::vector<godot::Vector3> get_mario_positions() const;
+	size_t get_surface_object_capacity_limit() const;
+
+	struct SurfaceHit {
+		godot::real_t height = 0.0;
+		godot::Vector3 normal;
+		int surface_type = -1;
+		int terrain_type = -1;
+	};
+
+	bool find_floor(const godot::Vector3 &p_position, SurfaceHit &r_hit) const;
+	bool find_ceil(const godot::Vector3 &p_position, SurfaceHit &r_hit) const;
+	godot::Dictionary find_surfaces_batch(const godot::PackedVector3Array &p_positions, bool p_ceil) const;
+
+	struct SurfaceQueryHit {
+		godot::Vector3 position;
+		godot::Vector3 normal;
+		godot::real_t fraction = 1.0;
+		godot::real_t distance = 0.0;
+		int surface_type = -1;
+		int terrain_type = -1;
+		int object_id = -1;
+	};
+
+	struct SurfaceQueryBatch {
+		const LibSM64 *libsm64;
+		const godot::Vector3 *from;
+		const godot::Vector3 *to;
+		godot::real_t radius;
+		bool closest_point;
+		std::vector<SurfaceQueryHit> hits;
+		std::vector<uint8_t> found;
+	};
+
+	void prepare_surface_queries();
+	const std::vector<struct SM64Surface> &get_loaded_static_surfaces() const;
+	bool cast_surfaces(const godot::Vector3 &p_from, const godot::Vector3 &p_to, godot::real_t p_radius, SurfaceQueryHit &r_hit) const;
+	bool find_closest_surface_point(const godot::Vector3 &p_position, godot::real_t p_max_distance, SurfaceQueryHit &r_hit) const;
+	void set_surface_query_hit(const SM64SurfaceHit &p_hit, const std::vector<struct SM64Surface> &p_surfaces, int p_object_id, const godot::Transform3D &p_transform, SurfaceQueryHit &r_hit) const;
+	godot::Dictionary run_surface_query_batch(SurfaceQueryBatch &r_batch, int64_t p_count);
+	static void surface_query_task(void *p_userdata, uint32_t p_index);
+	static godot::Dictionary surface_query_hit_to_dictionary(const SurfaceQueryHit &p_hit);
+
+	struct LevelVolume {
+		LevelVolumeType type;
+		godot::AABB bounds;
+		// Outward facing, empty for plain AABB volumes
+		std::vector<godot::Plane> planes;
+	};
+
+	int add_level_volume(LevelVolume &&p_volume);
+	bool get_level_volume_cells(const godot::AABB &p_bounds, int64_t *r_min_cell, int64_t *r_max_cell) const;
+	void insert_level_volume_cells(uint32_t p_volume_id, const LevelVolume &p_volume);
+	void erase_level_volume_cells(uint32_t p_volume_id, const LevelVolume &p_volume);
+	bool find_level_volume_level(LevelVolumeType p_type, const godot::Vector3 &p_position, godot::real_t &r_level) const;
+	void update_mario_level_volumes(int32_t p_mario_id);
+	void clear_mario_volume_levels(LevelVolumeType p_type);
+
 	godot::real_t scale_factor;
 
+	bool initialized = false;
+	uint64_t init_generation = 0;
+
+	// World origin, snapped so its offset is a whole number of libsm64 units
+	godot::Vector3 world_origin;
+	int32_t world_origin_offset[3] = { 0, 0, 0 };
+	godot::real_t world_origin_threshold = 0.0;
+	size_t mario_ticks_since_rebase = 0;
+
+	// Everything rebased when the world origin moves. Static surfaces are kept untranslated.
+	std::vector<struct SM64Surface> static_surfaces;
+	// Static surfaces load_static_surfaces could place around the world origin, without its offset.
+	// Only filled when some are left out, static_surfaces is used directly otherwise.
+	std::vector<struct SM64Surface> loaded_static_surfaces;
+	bool all_static_surfaces_loaded = true;
+	// Over the loaded static surfaces in SM64 units without the world origin offset, rebuilt by the first query after they change
+	SM64SurfaceBVH static_surfaces_bvh;
+	bool static_surfaces_bvh_dirty = true;
+	std::unordered_map<int32_t, MarioOriginState> mario_origin_states;
+	// Surface object IDs hold a slot in the low bits and the slot's version above it,
+	// so the IDs of deleted objects don't reach the objects reusing their slot
+	static constexpr uint32_t SURFACE_OBJECT_SLOT_BITS = 20;
+	static constexpr uint32_t SURFACE_OBJECT_SLOT_MASK = (1u << SURFACE_OBJECT_SLOT_BITS) - 1;
+	static constexpr uint32_t SURFACE_OBJECT_VERSION_MASK = (1u << (31 - SURFACE_OBJECT_SLOT_BITS)) - 1;
+	std::unordered_map<uint32_t, SurfaceObject> surface_objects;
+	// Current version of every slot handed out so far, kept across global_terminate
+	std::vector<uint32_t> surface_object_slot_versions;
+	// Slots of deleted surface objects, reused before new slots are handed out
+	std::vector<uint32_t> free_surface_object_slots;
+	size_t surface_object_peak_count = 0;
+	// Maximum number of live surface objects, 0 only limits them to the ID range
+	int surface_object_capacity = 0;
+
+	// Surface objects farther than this from every Mario are parked outside of libsm64, 0 disables it
+	godot::real_t surface_object_activation_distance = 0.0;
+	size_t mario_ticks_since_activation = 0;
+
+	// Latest transforms queued by surface_object_queue_move, applied before the next mario_tick
+	std::unordered_map<uint32_t, godot::Transform3D> queued_surface_object_moves;
+
+	// Surface objects created by static_surfaces_add
+	std::unordered_set<uint32_t> static_surface_groups;
+
+	// BVHs of the surface arrays used by surface objects. Objects keep their array alive while they hold its BVH,
+	// so a live entry's array can't be freed and its address reused.
+	std::unordered_map<const LibSM64SurfaceArray *, std::weak_ptr<SM64SurfaceBVH>> surface_array_bvhs;
+
+	// Last geometry produced by mario_tick for each Mario, reused while the geometry is unchanged
+	std::unordered_map<int32_t, MarioGeometryCache> mario_geometry_caches;
+
+	// Water and gas volumes, with their IDs bucketed in a grid of cells on the XZ plane
+	std::unordered_map<uint32_t, LevelVolume> level_volumes;
+	uint32_t next_level_volume_id = 0;
+	int level_volume_counts[2] = { 0, 0 };
+	godot::real_t level_volume_cell_size = 16.0;
+	std::unordered_map<int64_t, std::vector<uint32_t>> level_volume_cells;
+	// Volumes spanning too many cells, checked for every Mario
+	std::vector<uint32_t> large_level_volumes;
+
 	godot::Callable debug_print_function;
 	godot::Callable play_sound_function;
 };
@@ -1518,4 +1745,6 @@ VARIANT_ENUM_CAST(LibSM64::SeqId);
 VARIANT_ENUM_CAST(LibSM64::SoundTerrain)
 VARIANT_BITFIELD_CAST(LibSM64::SoundBits);
 
+VARIANT_ENUM_CAST(LibSM64::LevelVolumeType);
+
 #endif // LIBSM64GD_LIBSM64_H
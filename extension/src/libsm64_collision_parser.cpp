@@ -0,0 +1,213 @@
+#include <libsm64_collision_parser.hpp>
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#include <godot_cpp/classes/class_db_singleton.hpp>
+#include <godot_cpp/classes/file_access.hpp>
+
+#include <libsm64_surface_properties.hpp>
+
+struct CollisionMacro {
+	std::string name;
+	std::vector<std::string> args;
+};
+
+static void skip_whitespace_and_comments(const char *p_source, size_t p_length, size_t &r_pos) {
+	while (r_pos < p_length) {
+		if (isspace(static_cast<unsigned char>(p_source[r_pos]))) {
+			r_pos++;
+		} else if (p_source[r_pos] == '/' && r_pos + 1 < p_length && p_source[r_pos + 1] == '/') {
+			while (r_pos < p_length && p_source[r_pos] != '\n') {
+				r_pos++;
+			}
+		} else if (p_source[r_pos] == '/' && r_pos + 1 < p_length && p_source[r_pos + 1] == '*') {
+			const char *end = strstr(p_source + r_pos + 2, "*/");
+			r_pos = end != nullptr ? static_cast<size_t>(end - p_source) + 2 : p_length;
+		} else {
+			return;
+		}
+	}
+}
+
+static std::string trim(const std::string &p_string) {
+	size_t begin = 0;
+	size_t end = p_string.size();
+	while (begin < end && isspace(static_cast<unsigned char>(p_string[begin]))) {
+		begin++;
+	}
+	while (end > begin && isspace(static_cast<unsigned char>(p_string[end - 1]))) {
+		end--;
+	}
+	return p_string.substr(begin, end - begin);
+}
+
+// Collects every IDENTIFIER(args...) invocation, ignoring everything else
+static std::vector<CollisionMacro> tokenize_macros(const char *p_source, size_t p_length) {
+	std::vector<CollisionMacro> ret;
+	size_t pos = 0;
+	while (true) {
+		skip_whitespace_and_comments(p_source, p_length, pos);
+		if (pos >= p_length) {
+			break;
+		}
+
+		if (!isalpha(static_cast<unsigned char>(p_source[pos])) && p_source[pos] != '_') {
+			pos++;
+			continue;
+		}
+
+		const size_t name_begin = pos;
+		while (pos < p_length && (isalnum(static_cast<unsigned char>(p_source[pos])) || p_source[pos] == '_')) {
+			pos++;
+		}
+		CollisionMacro macro;
+		macro.name.assign(p_source + name_begin, pos - name_begin);
+
+		skip_whitespace_and_comments(p_source, p_length, pos);
+		if (pos >= p_length || p_source[pos] != '(') {
+			continue;
+		}
+		pos++;
+
+		int depth = 1;
+		std::string arg;
+		while (pos < p_length && depth > 0) {
+			const char c = p_source[pos++];
+			if (c == '(') {
+				depth++;
+			} else if (c == ')' && --depth == 0) {
+				break;
+			}
+			if (c == ',' && depth == 1) {
+				macro.args.push_back(trim(arg));
+				arg.clear();
+			} else {
+				arg.push_back(c);
+			}
+		}
+		arg = trim(arg);
+		if (!arg.empty() || !macro.args.empty()) {
+			macro.args.push_back(arg);
+		}
+
+		ret.push_back(std::move(macro));
+	}
+	return ret;
+}
+
+void LibSM64CollisionParser::set_terrain_type(LibSM64::TerrainType p_value) {
+	terrain_type = p_value;
+}
+
+LibSM64::TerrainType LibSM64CollisionParser::get_terrain_type() const {
+	return terrain_type;
+}
+
+godot::Ref<LibSM64SurfaceArray> LibSM64CollisionParser::parse(const godot::String &p_source) const {
+	const auto utf8 = p_source.utf8();
+	const std::vector<CollisionMacro> macros = tokenize_macros(utf8.get_data(), utf8.length());
+
+	std::vector<int32_t> vertices;
+	// Each collision block indexes its own vertices, starting at its first one
+	int64_t vertex_base = 0;
+	int64_t surface_type = LibSM64::SurfaceType::SURFACE_DEFAULT;
+	bool found_collision = false;
+
+	godot::Ref<LibSM64SurfaceArray> ret;
+	ret.instantiate();
+	auto &sm64_surfaces = ret->sm64_surfaces;
+
+	for (const CollisionMacro &macro : macros) {
+		if (macro.name == "COL_INIT") {
+			vertex_base = static_cast<int64_t>(vertices.size() / 3);
+		} else if (macro.name == "COL_VERTEX_INIT") {
+			// Blocks written without COL_INIT still start their own vertex list
+			vertex_base = static_cast<int64_t>(vertices.size() / 3);
+			int64_t count = 0;
+			if (macro.args.size() == 1 && parse_value(macro.args[0], count) && count > 0) {
+				vertices.reserve(vertices.size() + count * 3);
+			}
+		} else if (macro.name == "COL_VERTEX") {
+			ERR_FAIL_COND_V_MSG(macro.args.size() != 3, godot::Ref<LibSM64SurfaceArray>(), "[libsm64-godot] COL_VERTEX expects 3 arguments.");
+			for (const std::string &arg : macro.args) {
+				int64_t value = 0;
+				ERR_FAIL_COND_V_MSG(!parse_value(arg, value), godot::Ref<LibSM64SurfaceArray>(), godot::String("[libsm64-godot] Invalid COL_VERTEX value: ") + arg.c_str());
+				vertices.push_back(static_cast<int32_t>(value));
+			}
+			found_collision = true;
+		} else if (macro.name == "COL_TRI_INIT") {
+			ERR_FAIL_COND_V_MSG(macro.args.size() != 2, godot::Ref<LibSM64SurfaceArray>(), "[libsm64-godot] COL_TRI_INIT expects 2 arguments.");
+			ERR_FAIL_COND_V_MSG(!parse_value(macro.args[0], surface_type), godot::Ref<LibSM64SurfaceArray>(), godot::String("[libsm64-godot] Unknown surface type: ") + macro.args[0].c_str());
+			int64_t count = 0;
+			if (parse_value(macro.args[1], count) && count > 0) {
+				sm64_surfaces.reserve(sm64_surfaces.size() + count);
+			}
+		} else if (macro.name == "COL_TRI" || macro.name == "COL_TRI_SPECIAL") {
+			const bool special = macro.name == "COL_TRI_SPECIAL";
+			ERR_FAIL_COND_V_MSG(macro.args.size() != (special ? 4u : 3u), godot::Ref<LibSM64SurfaceArray>(), godot::String("[libsm64-godot] Wrong argument count for ") + macro.name.c_str() + ".");
+
+			int64_t indices[3];
+			for (int i = 0; i < 3; i++) {
+				ERR_FAIL_COND_V_MSG(!parse_value(macro.args[i], indices[i]), godot::Ref<LibSM64SurfaceArray>(), godot::String("[libsm64-godot] Invalid vertex index: ") + macro.args[i].c_str());
+				ERR_FAIL_INDEX_V_MSG(indices[i], static_cast<int64_t>(vertices.size() / 3) - vertex_base, godot::Ref<LibSM64SurfaceArray>(), "[libsm64-godot] Triangle references a vertex that is not defined.");
+				indices[i] += vertex_base;
+			}
+			int64_t force = 0;
+			if (special) {
+				ERR_FAIL_COND_V_MSG(!parse_value(macro.args[3], force), godot::Ref<LibSM64SurfaceArray>(), godot::String("[libsm64-godot] Invalid surface parameter: ") + macro.args[3].c_str());
+			}
+
+			// Decomp data is already in libsm64's space and winding, so it's stored as is
+			struct SM64Surface surface = {};
+			surface.type = static_cast<int16_t>(surface_type);
+			surface.force = static_cast<int16_t>(force);
+			surface.terrain = static_cast<uint16_t>(terrain_type);
+			for (int i = 0; i < 3; i++) {
+				memcpy(surface.vertices[i], &vertices[indices[i] * 3], sizeof(surface.vertices[i]));
+			}
+			sm64_surfaces.push_back(surface);
+		}
+	}
+
+	ERR_FAIL_COND_V_MSG(!found_collision, godot::Ref<LibSM64SurfaceArray>(), "[libsm64-godot] No collision data found.");
+
+	return ret;
+}
+
+godot::Ref<LibSM64SurfaceArray> LibSM64CollisionParser::parse_file(const godot::String &p_path) const {
+	godot::Ref<godot::FileAccess> file = godot::FileAccess::open(p_path, godot::FileAccess::READ);
+	ERR_FAIL_NULL_V_MSG(file, godot::Ref<LibSM64SurfaceArray>(), "[libsm64-godot] Cannot open file '" + p_path + "'.");
+	return parse(file->get_as_text());
+}
+
+bool LibSM64CollisionParser::parse_value(const std::string &p_token, int64_t &r_value) {
+	if (p_token.empty()) {
+		return false;
+	}
+
+	// Integer literals, decimal or hexadecimal
+	if (isdigit(static_cast<unsigned char>(p_token[0])) || p_token[0] == '-' || p_token[0] == '+') {
+		char *end = nullptr;
+		r_value = strtoll(p_token.c_str(), &end, 0);
+		return end != nullptr && *end == '\0';
+	}
+
+	// Named constants such as SURFACE_DEFAULT, as bound on LibSM64
+	godot::ClassDBSingleton *class_db = godot::ClassDBSingleton::get_singleton();
+	const godot::StringName name = p_token.c_str();
+	if (!class_db->class_has_integer_constant("LibSM64", name)) {
+		return false;
+	}
+	r_value = class_db->class_get_integer_constant("LibSM64", name);
+	return true;
+}
+
+void LibSM64CollisionParser::_bind_methods() {
+	godot::ClassDB::bind_method(godot::D_METHOD("set_terrain_type", "value"), &LibSM64CollisionParser::set_terrain_type);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_terrain_type"), &LibSM64CollisionParser::get_terrain_type);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::INT, "terrain_type", godot::PROPERTY_HINT_ENUM, TERRAIN_TYPE_HINT_STRING), "set_terrain_type", "get_terrain_type");
+	godot::ClassDB::bind_method(godot::D_METHOD("parse", "source"), &LibSM64CollisionParser::parse);
+	godot::ClassDB::bind_method(godot::D_METHOD("parse_file", "path"), &LibSM64CollisionParser::parse_file);
+}
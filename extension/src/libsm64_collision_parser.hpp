@@ -0,0 +1,33 @@
+#ifndef LIBSM64GD_LIBSM64COLLISIONPARSER_H
+#define LIBSM64GD_LIBSM64COLLISIONPARSER_H
+
+#include <string>
+#include <vector>
+
+#include <godot_cpp/classes/ref.hpp>
+
+#include <libsm64.hpp>
+#include <libsm64_surface_array.hpp>
+
+class LibSM64CollisionParser : public godot::RefCounted {
+	GDCLASS(LibSM64CollisionParser, godot::RefCounted);
+
+public:
+	LibSM64CollisionParser() = default;
+
+	void set_terrain_type(LibSM64::TerrainType p_value);
+	LibSM64::TerrainType get_terrain_type() const;
+
+	godot::Ref<LibSM64SurfaceArray> parse(const godot::String &p_source) const;
+	godot::Ref<LibSM64SurfaceArray> parse_file(const godot::String &p_path) const;
+
+protected:
+	static void _bind_methods();
+
+private:
+	static bool parse_value(const std::string &p_token, int64_t &r_value);
+
+	LibSM64::TerrainType terrain_type = LibSM64::TerrainType::TERRAIN_GRASS;
+};
+
+#endif // LIBSM64GD_LIBSM64COLLISIONPARSER_H
@@ -0,0 +1,787 @@
+#include <libsm64_face_extractor.hpp>
+
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <godot_cpp/classes/box_shape3d.hpp>
+#include <godot_cpp/classes/capsule_shape3d.hpp>
+#include <godot_cpp/classes/collision_object3d.hpp>
+#include <godot_cpp/classes/collision_shape3d.hpp>
+#include <godot_cpp/classes/concave_polygon_shape3d.hpp>
+#include <godot_cpp/classes/convex_polygon_shape3d.hpp>
+#include <godot_cpp/classes/csg_shape3d.hpp>
+#include <godot_cpp/classes/cylinder_shape3d.hpp>
+#include <godot_cpp/classes/grid_map.hpp>
+#include <godot_cpp/classes/height_map_shape3d.hpp>
+#include <godot_cpp/classes/mesh.hpp>
+#include <godot_cpp/classes/mesh_instance3d.hpp>
+#include <godot_cpp/classes/mesh_library.hpp>
+#include <godot_cpp/classes/multi_mesh.hpp>
+#include <godot_cpp/classes/multi_mesh_instance3d.hpp>
+#include <godot_cpp/classes/separation_ray_shape3d.hpp>
+#include <godot_cpp/classes/sphere_shape3d.hpp>
+#include <godot_cpp/classes/world_boundary_shape3d.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
+
+// Godot's front faces are clockwise, i.e. cross(b - a, c - a) points into the solid
+static void append_oriented_triangle(std::vector<godot::Vector3> &r_faces, const godot::Vector3 &p_a, const godot::Vector3 &p_b, const godot::Vector3 &p_c, const godot::Vector3 &p_outward) {
+	r_faces.push_back(p_a);
+	if ((p_b - p_a).cross(p_c - p_a).dot(p_outward) > 0) {
+		r_faces.push_back(p_c);
+		r_faces.push_back(p_b);
+	} else {
+		r_faces.push_back(p_b);
+		r_faces.push_back(p_c);
+	}
+}
+
+// For convex solids containing p_center, every face points away from it
+static void append_convex_triangle(std::vector<godot::Vector3> &r_faces, const godot::Vector3 &p_a, const godot::Vector3 &p_b, const godot::Vector3 &p_c, const godot::Vector3 &p_center) {
+	append_oriented_triangle(r_faces, p_a, p_b, p_c, (p_a + p_b + p_c) / 3.0 - p_center);
+}
+
+static void append_faces(std::vector<godot::Vector3> &r_faces, const godot::PackedVector3Array &p_faces, const godot::Transform3D &p_transform) {
+	const godot::Vector3 *faces = p_faces.ptr();
+	const int64_t size = p_faces.size();
+	r_faces.reserve(r_faces.size() + size);
+	for (int64_t i = 0; i < size; i++) {
+		r_faces.push_back(p_transform.xform(faces[i]));
+	}
+}
+
+static godot::PackedVector3Array to_packed_vector3_array(const std::vector<godot::Vector3> &p_faces) {
+	godot::PackedVector3Array ret;
+	ret.resize(p_faces.size());
+	if (!p_faces.empty()) {
+		memcpy(ret.ptrw(), p_faces.data(), p_faces.size() * sizeof(godot::Vector3));
+	}
+	return ret;
+}
+
+// Plane and hash grid cell of a GridMap triangle, see cull_internal_faces
+struct InternalFaceKey {
+	int64_t plane[4];
+	int64_t cell[3];
+
+	bool operator==(const InternalFaceKey &p_other) const {
+		return memcmp(this, &p_other, sizeof(InternalFaceKey)) == 0;
+	}
+};
+
+struct InternalFaceKeyHash {
+	size_t operator()(const InternalFaceKey &p_key) const {
+		uint64_t hash = 14695981039346656037ULL;
+		for (int64_t value : p_key.plane) {
+			hash = (hash ^ static_cast<uint64_t>(value)) * 1099511628211ULL;
+		}
+		for (int64_t value : p_key.cell) {
+			hash = (hash ^ static_cast<uint64_t>(value)) * 1099511628211ULL;
+		}
+		return static_cast<size_t>(hash);
+	}
+};
+
+static bool is_point_in_triangle(const godot::Vector3 &p_point, const godot::Vector3 *p_triangle, const godot::Vector3 &p_normal, godot::real_t p_epsilon) {
+	if (godot::Math::abs(p_normal.dot(p_point - p_triangle[0])) > p_epsilon) {
+		return false;
+	}
+	for (int i = 0; i < 3; i++) {
+		const godot::Vector3 edge = p_triangle[(i + 1) % 3] - p_triangle[i];
+		if (edge.cross(p_point - p_triangle[i]).dot(p_normal) < -p_epsilon * edge.length()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Two solid cells next to each other both have a face on their shared side, facing each other.
+// A triangle is culled when its vertices, edge midpoints and centroid all lie on coplanar triangles of
+// other cells facing the opposite way. Triangles are bucketed by plane and by the hash grid cells
+// their bounds overlap, so each one is only tested against the triangles around it.
+static void cull_internal_faces(std::vector<godot::Vector3> &r_faces, const std::vector<uint32_t> &p_triangle_cells, const godot::Vector3 &p_cell_size) {
+	static constexpr godot::real_t NORMAL_STEPS = 1024;
+	// Triangles bigger than this many hash grid cells don't hide others, which keeps huge items cheap
+	static constexpr int64_t MAX_TRIANGLE_HASH_CELLS = 4096;
+
+	const size_t triangle_count = r_faces.size() / 3;
+	const godot::real_t hash_cell_size = godot::MAX(godot::MAX(p_cell_size.x, p_cell_size.y), p_cell_size.z);
+	const godot::real_t epsilon = godot::MIN(godot::MIN(p_cell_size.x, p_cell_size.y), p_cell_size.z) * 1e-3f;
+	ERR_FAIL_COND(hash_cell_size <= 0 || epsilon <= 0);
+
+	std::vector<godot::Vector3> normals(triangle_count);
+	std::vector<InternalFaceKey> keys(triangle_count);
+	std::unordered_map<InternalFaceKey, std::vector<uint32_t>, InternalFaceKeyHash> buckets;
+
+	for (size_t t = 0; t < triangle_count; t++) {
+		const godot::Vector3 *triangle = &r_faces[t * 3];
+		const godot::Vector3 normal = (triangle[1] - triangle[0]).cross(triangle[2] - triangle[0]);
+		const godot::real_t length = normal.length();
+		if (length <= epsilon * epsilon) {
+			continue;
+		}
+		normals[t] = normal / length;
+
+		InternalFaceKey &key = keys[t];
+		key.plane[0] = static_cast<int64_t>(godot::Math::round(normals[t].x * NORMAL_STEPS));
+		key.plane[1] = static_cast<int64_t>(godot::Math::round(normals[t].y * NORMAL_STEPS));
+		key.plane[2] = static_cast<int64_t>(godot::Math::round(normals[t].z * NORMAL_STEPS));
+		key.plane[3] = static_cast<int64_t>(godot::Math::round(normals[t].dot(triangle[0]) / epsilon));
+
+		int64_t cell_min[3];
+		int64_t cell_max[3];
+		int64_t hash_cell_count = 1;
+		for (int axis = 0; axis < 3; axis++) {
+			const godot::real_t min = godot::MIN(godot::MIN(triangle[0][axis], triangle[1][axis]), triangle[2][axis]);
+			const godot::real_t max = godot::MAX(godot::MAX(triangle[0][axis], triangle[1][axis]), triangle[2][axis]);
+			cell_min[axis] = static_cast<int64_t>(godot::Math::floor((min - epsilon) / hash_cell_size));
+			cell_max[axis] = static_cast<int64_t>(godot::Math::floor((max + epsilon) / hash_cell_size));
+			hash_cell_count *= cell_max[axis] - cell_min[axis] + 1;
+		}
+		if (hash_cell_count > MAX_TRIANGLE_HASH_CELLS) {
+			continue;
+		}
+
+		InternalFaceKey bucket_key = key;
+		for (int64_t x = cell_min[0]; x <= cell_max[0]; x++) {
+			for (int64_t y = cell_min[1]; y <= cell_max[1]; y++) {
+				for (int64_t z = cell_min[2]; z <= cell_max[2]; z++) {
+					bucket_key.cell[0] = x;
+					bucket_key.cell[1] = y;
+					bucket_key.cell[2] = z;
+					buckets[bucket_key].push_back(static_cast<uint32_t>(t));
+				}
+			}
+		}
+	}
+
+	std::vector<bool> culled(triangle_count, false);
+	size_t culled_count = 0;
+	for (size_t t = 0; t < triangle_count; t++) {
+		if (normals[t] == godot::Vector3()) {
+			continue;
+		}
+
+		const godot::Vector3 *triangle = &r_faces[t * 3];
+		const godot::Vector3 test_points[7] = {
+			triangle[0],
+			triangle[1],
+			triangle[2],
+			(triangle[0] + triangle[1]) * 0.5f,
+			(triangle[1] + triangle[2]) * 0.5f,
+			(triangle[2] + triangle[0]) * 0.5f,
+			(triangle[0] + triangle[1] + triangle[2]) / 3.0f,
+		};
+
+		InternalFaceKey opposite_key;
+		for (int i = 0; i < 4; i++) {
+			opposite_key.plane[i] = -keys[t].plane[i];
+		}
+
+		bool covered = true;
+		for (const godot::Vector3 &point : test_points) {
+			opposite_key.cell[0] = static_cast<int64_t>(godot::Math::floor(point.x / hash_cell_size));
+			opposite_key.cell[1] = static_cast<int64_t>(godot::Math::floor(point.y / hash_cell_size));
+			opposite_key.cell[2] = static_cast<int64_t>(godot::Math::floor(point.z / hash_cell_size));
+			const auto bucket = buckets.find(opposite_key);
+			if (bucket == buckets.end()) {
+				covered = false;
+				break;
+			}
+
+			bool point_covered = false;
+			for (uint32_t other : bucket->second) {
+				if (p_triangle_cells[other] != p_triangle_cells[t] && is_point_in_triangle(point, &r_faces[other * 3], normals[other], epsilon)) {
+					point_covered = true;
+					break;
+				}
+			}
+			if (!point_covered) {
+				covered = false;
+				break;
+			}
+		}
+
+		if (covered) {
+			culled[t] = true;
+			culled_count++;
+		}
+	}
+
+	if (culled_count == 0) {
+		return;
+	}
+
+	size_t write = 0;
+	for (size_t t = 0; t < triangle_count; t++) {
+		if (culled[t]) {
+			continue;
+		}
+		if (write != t) {
+			memcpy(&r_faces[write * 3], &r_faces[t * 3], 3 * sizeof(godot::Vector3));
+		}
+		write++;
+	}
+	r_faces.resize(write * 3);
+}
+
+void LibSM64FaceExtractor::set_use_threads(bool p_value) {
+	use_threads = p_value;
+}
+
+bool LibSM64FaceExtractor::get_use_threads() const {
+	return use_threads;
+}
+
+void LibSM64FaceExtractor::set_radial_segments(int p_value) {
+	ERR_FAIL_COND(p_value < 3);
+	radial_segments = p_value;
+}
+
+int LibSM64FaceExtractor::get_radial_segments() const {
+	return radial_segments;
+}
+
+void LibSM64FaceExtractor::set_rings(int p_value) {
+	ERR_FAIL_COND(p_value < 2);
+	rings = p_value;
+}
+
+int LibSM64FaceExtractor::get_rings() const {
+	return rings;
+}
+
+void LibSM64FaceExtractor::set_world_boundary_bounds(const godot::AABB &p_value) {
+	world_boundary_bounds = p_value;
+}
+
+godot::AABB LibSM64FaceExtractor::get_world_boundary_bounds() const {
+	return world_boundary_bounds;
+}
+
+void LibSM64FaceExtractor::set_grid_map_cull_internal_faces(bool p_value) {
+	grid_map_cull_internal_faces = p_value;
+}
+
+bool LibSM64FaceExtractor::get_grid_map_cull_internal_faces() const {
+	return grid_map_cull_internal_faces;
+}
+
+godot::PackedVector3Array LibSM64FaceExtractor::get_shape_faces(const godot::Ref<godot::Shape3D> &p_shape) const {
+	std::vector<godot::Vector3> faces;
+	append_shape_faces(faces, p_shape, godot::Transform3D());
+	return to_packed_vector3_array(faces);
+}
+
+godot::PackedVector3Array LibSM64FaceExtractor::get_node_faces(godot::Node3D *p_node) const {
+	std::vector<godot::Vector3> faces;
+	append_node_faces(faces, p_node);
+	return to_packed_vector3_array(faces);
+}
+
+void LibSM64FaceExtractor::add_shape_faces(const godot::Ref<LibSM64SurfaceArray> &p_surface_array, const godot::Ref<godot::Shape3D> &p_shape, const godot::Transform3D &p_transform, const godot::Ref<LibSM64SurfaceProperties> &p_properties) const {
+	ERR_FAIL_NULL(p_surface_array);
+	p_surface_array->add_faces(get_shape_faces(p_shape), p_transform, p_properties);
+}
+
+void LibSM64FaceExtractor::add_node_faces(const godot::Ref<LibSM64SurfaceArray> &p_surface_array, godot::Node3D *p_node, const godot::Transform3D &p_transform, const godot::Ref<LibSM64SurfaceProperties> &p_properties) const {
+	ERR_FAIL_NULL(p_surface_array);
+	p_surface_array->add_faces(get_node_faces(p_node), p_transform, p_properties);
+}
+
+godot::Ref<LibSM64SurfaceArray> LibSM64FaceExtractor::build_surface_array(const godot::Array &p_nodes, const godot::Array &p_properties) {
+	godot::Ref<LibSM64SurfaceArray> ret;
+	ret.instantiate();
+	ERR_FAIL_COND_V_MSG(!p_properties.is_empty() && p_properties.size() != p_nodes.size(), ret, "[libsm64-godot] Properties array size must match the nodes array size.");
+
+	// Scene tree access stays on the calling thread
+	task_snapshots.clear();
+	task_snapshots.reserve(p_nodes.size());
+	for (int64_t i = 0; i < p_nodes.size(); i++) {
+		godot::Node3D *node = godot::Object::cast_to<godot::Node3D>(static_cast<godot::Object *>(p_nodes[i]));
+		if (node == nullptr) {
+			ERR_PRINT("[libsm64-godot] Non Node3D element at index " + godot::String::num_int64(i) + ", skipping it.");
+			continue;
+		}
+
+		NodeSnapshot &snapshot = task_snapshots.emplace_back();
+		snapshot.node = node;
+		snapshot.transform = node->get_global_transform();
+		if (!p_properties.is_empty()) {
+			snapshot.properties = p_properties[i];
+		}
+		snapshot.surface_array.instantiate();
+		snapshot_node(snapshot);
+	}
+
+	if (use_threads && task_snapshots.size() > 1) {
+		godot::WorkerThreadPool *worker_thread_pool = godot::WorkerThreadPool::get_singleton();
+		const int64_t group_id = worker_thread_pool->add_native_group_task(&LibSM64FaceExtractor::build_snapshot_task, this, static_cast<int>(task_snapshots.size()), -1, true, "LibSM64FaceExtractor");
+		worker_thread_pool->wait_for_group_task_completion(group_id);
+	} else {
+		for (auto &snapshot : task_snapshots) {
+			build_snapshot(snapshot);
+		}
+	}
+
+	// Merging in input order keeps the result independent of scheduling
+	for (const auto &snapshot : task_snapshots) {
+		if (snapshot.faces.empty()) {
+			ERR_PRINT("[libsm64-godot] Faces array empty, skipping node " + snapshot.node->get_name() + ".");
+			continue;
+		}
+		ret->append_surfaces(snapshot.surface_array);
+	}
+	task_snapshots.clear();
+
+	return ret;
+}
+
+void LibSM64FaceExtractor::snapshot_node(NodeSnapshot &r_snapshot) const {
+	godot::Node3D *node = r_snapshot.node;
+
+	if (auto *collision_object = godot::Object::cast_to<godot::CollisionObject3D>(node)) {
+		for (int64_t i = 0; i < collision_object->get_child_count(); i++) {
+			auto *collision_shape = godot::Object::cast_to<godot::CollisionShape3D>(collision_object->get_child(i));
+			if (collision_shape == nullptr || collision_shape->is_disabled() || collision_shape->get_shape().is_null()) {
+				continue;
+			}
+			r_snapshot.shapes.emplace_back(collision_shape->get_shape(), collision_shape->get_transform());
+		}
+	} else if (auto *collision_shape = godot::Object::cast_to<godot::CollisionShape3D>(node)) {
+		if (!collision_shape->is_disabled() && collision_shape->get_shape().is_valid()) {
+			r_snapshot.shapes.emplace_back(collision_shape->get_shape(), godot::Transform3D());
+		}
+	} else {
+		append_node_faces(r_snapshot.faces, node);
+	}
+}
+
+void LibSM64FaceExtractor::build_snapshot(NodeSnapshot &r_snapshot) const {
+	for (const auto &shape : r_snapshot.shapes) {
+		append_shape_faces(r_snapshot.faces, shape.first, shape.second);
+	}
+	r_snapshot.surface_array->add_faces(to_packed_vector3_array(r_snapshot.faces), r_snapshot.transform, r_snapshot.properties);
+}
+
+void LibSM64FaceExtractor::build_snapshot_task(void *p_userdata, uint32_t p_index) {
+	auto *face_extractor = static_cast<LibSM64FaceExtractor *>(p_userdata);
+	face_extractor->build_snapshot(face_extractor->task_snapshots[p_index]);
+}
+
+void LibSM64FaceExtractor::append_shape_faces(std::vector<godot::Vector3> &r_faces, const godot::Ref<godot::Shape3D> &p_shape, const godot::Transform3D &p_transform) const {
+	ERR_FAIL_NULL(p_shape);
+
+	const size_t first_vertex = r_faces.size();
+
+	if (auto *box = godot::Object::cast_to<godot::BoxShape3D>(p_shape.ptr())) {
+		append_box_faces(r_faces, box->get_size());
+	} else if (auto *sphere = godot::Object::cast_to<godot::SphereShape3D>(p_shape.ptr())) {
+		const godot::real_t radius = sphere->get_radius();
+		std::vector<ProfilePoint> profile;
+		for (int i = 0; i <= rings; i++) {
+			const godot::real_t phi = Math_PI * (static_cast<godot::real_t>(i) / rings - 0.5);
+			profile.push_back({ radius * godot::Math::sin(phi), (i == 0 || i == rings) ? 0 : radius * godot::Math::cos(phi) });
+		}
+		append_lathe_faces(r_faces, profile);
+	} else if (auto *capsule = godot::Object::cast_to<godot::CapsuleShape3D>(p_shape.ptr())) {
+		// The height includes both hemispheres
+		const godot::real_t radius = capsule->get_radius();
+		const godot::real_t half_height = godot::MAX(capsule->get_height() * 0.5f - radius, static_cast<godot::real_t>(0));
+		const int hemisphere_rings = godot::MAX(rings / 2, 1);
+		std::vector<ProfilePoint> profile;
+		for (int i = 0; i <= hemisphere_rings; i++) {
+			const godot::real_t phi = Math_PI * 0.5 * (static_cast<godot::real_t>(i) / hemisphere_rings - 1.0);
+			profile.push_back({ -half_height + radius * godot::Math::sin(phi), i == 0 ? 0 : radius * godot::Math::cos(phi) });
+		}
+		for (int i = 0; i <= hemisphere_rings; i++) {
+			const godot::real_t phi = Math_PI * 0.5 * static_cast<godot::real_t>(i) / hemisphere_rings;
+			profile.push_back({ half_height + radius * godot::Math::sin(phi), i == hemisphere_rings ? 0 : radius * godot::Math::cos(phi) });
+		}
+		append_lathe_faces(r_faces, profile);
+	} else if (auto *cylinder = godot::Object::cast_to<godot::CylinderShape3D>(p_shape.ptr())) {
+		const godot::real_t radius = cylinder->get_radius();
+		const godot::real_t half_height = cylinder->get_height() * 0.5f;
+		append_lathe_faces(r_faces, { { -half_height, 0 }, { -half_height, radius }, { half_height, radius }, { half_height, 0 } });
+	} else if (auto *convex_polygon = godot::Object::cast_to<godot::ConvexPolygonShape3D>(p_shape.ptr())) {
+		append_convex_hull_faces(r_faces, convex_polygon->get_points());
+	} else if (auto *concave_polygon = godot::Object::cast_to<godot::ConcavePolygonShape3D>(p_shape.ptr())) {
+		append_faces(r_faces, concave_polygon->get_faces(), godot::Transform3D());
+	} else if (auto *height_map = godot::Object::cast_to<godot::HeightMapShape3D>(p_shape.ptr())) {
+		append_height_map_faces(r_faces, height_map->get_map_width(), height_map->get_map_depth(), height_map->get_map_data());
+	} else if (auto *world_boundary = godot::Object::cast_to<godot::WorldBoundaryShape3D>(p_shape.ptr())) {
+		append_world_boundary_faces(r_faces, world_boundary->get_plane());
+	} else if (godot::Object::cast_to<godot::SeparationRayShape3D>(p_shape.ptr())) {
+		// Rays have no surface to collide with
+	} else {
+		ERR_FAIL_MSG("[libsm64-godot] Unsupported shape type: " + p_shape->get_class());
+	}
+
+	if (p_transform != godot::Transform3D()) {
+		for (size_t i = first_vertex; i < r_faces.size(); i++) {
+			r_faces[i] = p_transform.xform(r_faces[i]);
+		}
+	}
+}
+
+void LibSM64FaceExtractor::append_node_faces(std::vector<godot::Vector3> &r_faces, godot::Node3D *p_node) const {
+	ERR_FAIL_NULL(p_node);
+
+	if (auto *collision_object = godot::Object::cast_to<godot::CollisionObject3D>(p_node)) {
+		// Child shapes are placed relative to their parent
+		for (int64_t i = 0; i < collision_object->get_child_count(); i++) {
+			auto *collision_shape = godot::Object::cast_to<godot::CollisionShape3D>(collision_object->get_child(i));
+			if (collision_shape == nullptr || collision_shape->is_disabled() || collision_shape->get_shape().is_null()) {
+				continue;
+			}
+			append_shape_faces(r_faces, collision_shape->get_shape(), collision_shape->get_transform());
+		}
+	} else if (auto *collision_shape = godot::Object::cast_to<godot::CollisionShape3D>(p_node)) {
+		if (!collision_shape->is_disabled()) {
+			append_shape_faces(r_faces, collision_shape->get_shape(), godot::Transform3D());
+		}
+	} else if (auto *mesh_instance = godot::Object::cast_to<godot::MeshInstance3D>(p_node)) {
+		const godot::Ref<godot::Mesh> mesh = mesh_instance->get_mesh();
+		ERR_FAIL_NULL_MSG(mesh, "[libsm64-godot] MeshInstance3D has no mesh.");
+		append_faces(r_faces, mesh->get_faces(), godot::Transform3D());
+	} else if (auto *multi_mesh_instance = godot::Object::cast_to<godot::MultiMeshInstance3D>(p_node)) {
+		const godot::Ref<godot::MultiMesh> multi_mesh = multi_mesh_instance->get_multimesh();
+		ERR_FAIL_NULL_MSG(multi_mesh, "[libsm64-godot] MultiMeshInstance3D has no multimesh.");
+		const godot::Ref<godot::Mesh> mesh = multi_mesh->get_mesh();
+		ERR_FAIL_NULL_MSG(mesh, "[libsm64-godot] MultiMesh has no mesh.");
+
+		const godot::PackedVector3Array mesh_faces = mesh->get_faces();
+		const int32_t visible_instance_count = multi_mesh->get_visible_instance_count();
+		const int32_t instance_count = visible_instance_count < 0 ? multi_mesh->get_instance_count() : visible_instance_count;
+		r_faces.reserve(r_faces.size() + mesh_faces.size() * instance_count);
+		for (int32_t i = 0; i < instance_count; i++) {
+			append_faces(r_faces, mesh_faces, multi_mesh->get_instance_transform(i));
+		}
+	} else if (auto *csg_shape = godot::Object::cast_to<godot::CSGShape3D>(p_node)) {
+		// Only the root of a CSG tree holds the combined result
+		ERR_FAIL_COND_MSG(!csg_shape->is_root_shape(), "[libsm64-godot] Only root CSGShape3D nodes are supported.");
+		const godot::Array meshes = csg_shape->get_meshes();
+		ERR_FAIL_COND(meshes.size() < 2);
+		const godot::Transform3D mesh_transform = meshes[0];
+		const godot::Ref<godot::Mesh> mesh = meshes[1];
+		ERR_FAIL_NULL(mesh);
+		append_faces(r_faces, mesh->get_faces(), mesh_transform);
+	} else if (auto *grid_map = godot::Object::cast_to<godot::GridMap>(p_node)) {
+		append_grid_map_faces(r_faces, grid_map);
+	} else {
+		ERR_FAIL_MSG("[libsm64-godot] Unsupported node type: " + p_node->get_class());
+	}
+}
+
+void LibSM64FaceExtractor::append_grid_map_faces(std::vector<godot::Vector3> &r_faces, godot::GridMap *p_grid_map) const {
+	const godot::Ref<godot::MeshLibrary> mesh_library = p_grid_map->get_mesh_library();
+	ERR_FAIL_NULL_MSG(mesh_library, "[libsm64-godot] GridMap has no mesh library.");
+
+	const godot::TypedArray<godot::Vector3i> used_cells = p_grid_map->get_used_cells();
+	const godot::real_t cell_scale = p_grid_map->get_cell_scale();
+
+	// Each item is converted once and stamped into every cell using it
+	std::unordered_map<int32_t, std::vector<godot::Vector3>> item_faces;
+	std::vector<godot::Vector3> grid_faces;
+	std::vector<uint32_t> triangle_cells;
+
+	for (int64_t i = 0; i < used_cells.size(); i++) {
+		const godot::Vector3i cell = used_cells[i];
+		const int32_t item = p_grid_map->get_cell_item(cell);
+		auto faces = item_faces.find(item);
+		if (faces == item_faces.end()) {
+			faces = item_faces.emplace(item, std::vector<godot::Vector3>()).first;
+			append_mesh_library_item_faces(faces->second, mesh_library, item);
+		}
+		if (faces->second.empty()) {
+			continue;
+		}
+
+		// Same placement GridMap uses for its own meshes and collision
+		const godot::Transform3D cell_transform(p_grid_map->get_cell_item_basis(cell).scaled(godot::Vector3(cell_scale, cell_scale, cell_scale)), p_grid_map->map_to_local(cell));
+		grid_faces.reserve(grid_faces.size() + faces->second.size());
+		for (const godot::Vector3 &vertex : faces->second) {
+			grid_faces.push_back(cell_transform.xform(vertex));
+		}
+		triangle_cells.insert(triangle_cells.end(), faces->second.size() / 3, static_cast<uint32_t>(i));
+	}
+
+	if (grid_map_cull_internal_faces) {
+		cull_internal_faces(grid_faces, triangle_cells, p_grid_map->get_cell_size() * cell_scale);
+	}
+	r_faces.insert(r_faces.end(), grid_faces.begin(), grid_faces.end());
+}
+
+void LibSM64FaceExtractor::append_mesh_library_item_faces(std::vector<godot::Vector3> &r_faces, const godot::Ref<godot::MeshLibrary> &p_mesh_library, int32_t p_item) const {
+	// Collision shapes are what GridMap collides with, the mesh is only used for items without any
+	const godot::Array shapes = p_mesh_library->get_item_shapes(p_item);
+	for (int64_t i = 0; i + 1 < shapes.size(); i += 2) {
+		const godot::Ref<godot::Shape3D> shape = shapes[i];
+		if (shape.is_valid()) {
+			append_shape_faces(r_faces, shape, shapes[i + 1]);
+		}
+	}
+	if (!r_faces.empty()) {
+		return;
+	}
+
+	const godot::Ref<godot::Mesh> mesh = p_mesh_library->get_item_mesh(p_item);
+	if (mesh.is_valid()) {
+		append_faces(r_faces, mesh->get_faces(), p_mesh_library->get_item_mesh_transform(p_item));
+	}
+}
+
+void LibSM64FaceExtractor::append_box_faces(std::vector<godot::Vector3> &r_faces, const godot::Vector3 &p_size) const {
+	// Corner i has its x, y and z signs in bits 0, 1 and 2
+	static constexpr int BOX_QUADS[6][4] = {
+		{ 0, 2, 6, 4 },
+		{ 1, 3, 7, 5 },
+		{ 0, 1, 5, 4 },
+		{ 2, 3, 7, 6 },
+		{ 0, 1, 3, 2 },
+		{ 4, 5, 7, 6 },
+	};
+
+	const godot::Vector3 half_size = p_size * 0.5f;
+	godot::Vector3 corners[8];
+	for (int i = 0; i < 8; i++) {
+		corners[i] = godot::Vector3(i & 1 ? half_size.x : -half_size.x, i & 2 ? half_size.y : -half_size.y, i & 4 ? half_size.z : -half_size.z);
+	}
+
+	r_faces.reserve(r_faces.size() + 36);
+	for (const auto &quad : BOX_QUADS) {
+		append_convex_triangle(r_faces, corners[quad[0]], corners[quad[1]], corners[quad[2]], godot::Vector3());
+		append_convex_triangle(r_faces, corners[quad[0]], corners[quad[2]], corners[quad[3]], godot::Vector3());
+	}
+}
+
+void LibSM64FaceExtractor::append_lathe_faces(std::vector<godot::Vector3> &r_faces, const std::vector<ProfilePoint> &p_profile) const {
+	// Revolves the (y, radius) profile around the Y axis, the solid is convex and contains the origin
+	std::vector<godot::Vector2> directions(radial_segments + 1);
+	for (int j = 0; j <= radial_segments; j++) {
+		const godot::real_t angle = Math_TAU * (j % radial_segments) / radial_segments;
+		directions[j] = godot::Vector2(godot::Math::cos(angle), godot::Math::sin(angle));
+	}
+
+	for (size_t i = 0; i + 1 < p_profile.size(); i++) {
+		const ProfilePoint &bottom = p_profile[i];
+		const ProfilePoint &top = p_profile[i + 1];
+		if ((bottom.radius == 0 && top.radius == 0) || (bottom.y == top.y && bottom.radius == top.radius)) {
+			continue;
+		}
+
+		for (int j = 0; j < radial_segments; j++) {
+			const godot::Vector3 bottom_0(directions[j].x * bottom.radius, bottom.y, directions[j].y * bottom.radius);
+			const godot::Vector3 bottom_1(directions[j + 1].x * bottom.radius, bottom.y, directions[j + 1].y * bottom.radius);
+			const godot::Vector3 top_0(directions[j].x * top.radius, top.y, directions[j].y * top.radius);
+			const godot::Vector3 top_1(directions[j + 1].x * top.radius, top.y, directions[j + 1].y * top.radius);
+
+			if (bottom.radius != 0) {
+				append_convex_triangle(r_faces, bottom_0, bottom_1, top_0, godot::Vector3());
+			}
+			if (top.radius != 0) {
+				append_convex_triangle(r_faces, top_0, bottom_1, top_1, godot::Vector3());
+			}
+		}
+	}
+}
+
+void LibSM64FaceExtractor::append_convex_hull_faces(std::vector<godot::Vector3> &r_faces, const godot::PackedVector3Array &p_points) const {
+	struct HullFace {
+		int a, b, c;
+		godot::Vector3 normal;
+	};
+
+	const godot::Vector3 *points = p_points.ptr();
+	const int point_count = static_cast<int>(p_points.size());
+	ERR_FAIL_COND_MSG(point_count < 4, "[libsm64-godot] ConvexPolygonShape3D needs at least 4 points.");
+
+	godot::AABB bounds(points[0], godot::Vector3());
+	for (int i = 1; i < point_count; i++) {
+		bounds.expand_to(points[i]);
+	}
+	const godot::real_t epsilon = godot::MAX(bounds.size.x, godot::MAX(bounds.size.y, bounds.size.z)) * 1e-5f;
+
+	// Initial tetrahedron from extreme points
+	int i0 = 0, i1 = 0, i2 = 0, i3 = 0;
+	godot::real_t best = 0;
+	for (int i = 1; i < point_count; i++) {
+		const godot::real_t distance = points[i].distance_squared_to(points[i0]);
+		if (distance > best) {
+			best = distance;
+			i1 = i;
+		}
+	}
+	best = 0;
+	for (int i = 0; i < point_count; i++) {
+		const godot::real_t distance = (points[i] - points[i0]).cross(points[i1] - points[i0]).length_squared();
+		if (distance > best) {
+			best = distance;
+			i2 = i;
+		}
+	}
+	const godot::Vector3 base_normal = (points[i1] - points[i0]).cross(points[i2] - points[i0]).normalized();
+	best = 0;
+	for (int i = 0; i < point_count; i++) {
+		const godot::real_t distance = godot::Math::abs(base_normal.dot(points[i] - points[i0]));
+		if (distance > best) {
+			best = distance;
+			i3 = i;
+		}
+	}
+	ERR_FAIL_COND_MSG(i1 == i0 || i2 == i0 || best <= epsilon, "[libsm64-godot] ConvexPolygonShape3D points are coplanar.");
+
+	const godot::Vector3 interior = (points[i0] + points[i1] + points[i2] + points[i3]) / 4.0;
+	std::vector<HullFace> faces;
+	const auto add_face = [&](int p_a, int p_b, int p_c) {
+		godot::Vector3 normal = (points[p_b] - points[p_a]).cross(points[p_c] - points[p_a]).normalized();
+		if (normal.dot(interior - points[p_a]) > 0) {
+			std::swap(p_b, p_c);
+			normal = -normal;
+		}
+		faces.push_back({ p_a, p_b, p_c, normal });
+	};
+	add_face(i0, i1, i2);
+	add_face(i0, i1, i3);
+	add_face(i0, i2, i3);
+	add_face(i1, i2, i3);
+
+	// Incremental hull: replace the faces visible from each outside point with a fan to the horizon
+	const auto edge_key = [](int p_from, int p_to) { return (static_cast<uint64_t>(p_from) << 32) | static_cast<uint32_t>(p_to); };
+	std::unordered_set<uint64_t> visible_edges;
+	std::vector<HullFace> kept_faces;
+	for (int i = 0; i < point_count; i++) {
+		if (i == i0 || i == i1 || i == i2 || i == i3) {
+			continue;
+		}
+
+		visible_edges.clear();
+		kept_faces.clear();
+		std::vector<HullFace> visible_faces;
+		for (const HullFace &face : faces) {
+			if (face.normal.dot(points[i] - points[face.a]) > epsilon) {
+				visible_faces.push_back(face);
+				visible_edges.insert(edge_key(face.a, face.b));
+				visible_edges.insert(edge_key(face.b, face.c));
+				visible_edges.insert(edge_key(face.c, face.a));
+			} else {
+				kept_faces.push_back(face);
+			}
+		}
+		if (visible_faces.empty()) {
+			continue;
+		}
+
+		faces.swap(kept_faces);
+		for (const HullFace &face : visible_faces) {
+			const int edges[3][2] = { { face.a, face.b }, { face.b, face.c }, { face.c, face.a } };
+			for (const auto &edge : edges) {
+				if (visible_edges.count(edge_key(edge[1], edge[0])) == 0) {
+					add_face(edge[0], edge[1], i);
+				}
+			}
+		}
+	}
+
+	r_faces.reserve(r_faces.size() + 3 * faces.size());
+	for (const HullFace &face : faces) {
+		append_oriented_triangle(r_faces, points[face.a], points[face.b], points[face.c], face.normal);
+	}
+}
+
+void LibSM64FaceExtractor::append_height_map_faces(std::vector<godot::Vector3> &r_faces, int p_width, int p_depth, const godot::PackedFloat32Array &p_data) const {
+	ERR_FAIL_COND(p_width < 2 || p_depth < 2);
+	ERR_FAIL_COND(p_data.size() < static_cast<int64_t>(p_width) * p_depth);
+
+	// Height maps are centered on the shape's origin with one unit between samples
+	const float *data = p_data.ptr();
+	const godot::real_t start_x = -(p_width - 1) * 0.5f;
+	const godot::real_t start_z = -(p_depth - 1) * 0.5f;
+	const auto vertex = [&](int p_x, int p_z) {
+		return godot::Vector3(start_x + p_x, data[p_z * p_width + p_x], start_z + p_z);
+	};
+
+	r_faces.reserve(r_faces.size() + 6 * static_cast<size_t>(p_width - 1) * (p_depth - 1));
+	for (int z = 0; z < p_depth - 1; z++) {
+		for (int x = 0; x < p_width - 1; x++) {
+			const godot::Vector3 v00 = vertex(x, z);
+			const godot::Vector3 v10 = vertex(x + 1, z);
+			const godot::Vector3 v01 = vertex(x, z + 1);
+			const godot::Vector3 v11 = vertex(x + 1, z + 1);
+			append_oriented_triangle(r_faces, v00, v10, v01, godot::Vector3(0, 1, 0));
+			append_oriented_triangle(r_faces, v10, v11, v01, godot::Vector3(0, 1, 0));
+		}
+	}
+}
+
+void LibSM64FaceExtractor::append_world_boundary_faces(std::vector<godot::Vector3> &r_faces, const godot::Plane &p_plane) const {
+	// Start from a quad on the plane larger than the bounds, then clip it to the bounds (Sutherland-Hodgman)
+	const godot::Vector3 normal = p_plane.normal.normalized();
+	ERR_FAIL_COND(normal == godot::Vector3());
+	const godot::Vector3 tangent = (godot::Math::abs(normal.y) < 0.9f ? godot::Vector3(0, 1, 0) : godot::Vector3(1, 0, 0)).cross(normal).normalized();
+	const godot::Vector3 bitangent = normal.cross(tangent);
+	const godot::Vector3 center = godot::Plane(normal, p_plane.d / p_plane.normal.length()).project(world_boundary_bounds.get_center());
+	const godot::real_t extent = world_boundary_bounds.size.length() + 1;
+
+	std::vector<godot::Vector3> polygon = {
+		center - tangent * extent - bitangent * extent,
+		center + tangent * extent - bitangent * extent,
+		center + tangent * extent + bitangent * extent,
+		center - tangent * extent + bitangent * extent,
+	};
+
+	const godot::Vector3 bounds_end = world_boundary_bounds.get_end();
+	std::vector<godot::Vector3> clipped;
+	for (int axis = 0; axis < 3; axis++) {
+		for (int side = 0; side < 2; side++) {
+			const godot::real_t limit = side == 0 ? world_boundary_bounds.position[axis] : bounds_end[axis];
+			const godot::real_t sign = side == 0 ? 1 : -1;
+			const auto distance = [&](const godot::Vector3 &p_point) { return (p_point[axis] - limit) * sign; };
+
+			clipped.clear();
+			for (size_t i = 0; i < polygon.size(); i++) {
+				const godot::Vector3 &from = polygon[i];
+				const godot::Vector3 &to = polygon[(i + 1) % polygon.size()];
+				const godot::real_t from_distance = distance(from);
+				const godot::real_t to_distance = distance(to);
+				if (from_distance >= 0) {
+					clipped.push_back(from);
+				}
+				if ((from_distance >= 0) != (to_distance >= 0)) {
+					clipped.push_back(from.lerp(to, from_distance / (from_distance - to_distance)));
+				}
+			}
+			polygon.swap(clipped);
+			if (polygon.size() < 3) {
+				return;
+			}
+		}
+	}
+
+	for (size_t i = 1; i + 1 < polygon.size(); i++) {
+		append_oriented_triangle(r_faces, polygon[0], polygon[i], polygon[i + 1], normal);
+	}
+}
+
+void LibSM64FaceExtractor::_bind_methods() {
+	godot::ClassDB::bind_method(godot::D_METHOD("set_use_threads", "value"), &LibSM64FaceExtractor::set_use_threads);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_use_threads"), &LibSM64FaceExtractor::get_use_threads);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::BOOL, "use_threads"), "set_use_threads", "get_use_threads");
+	godot::ClassDB::bind_method(godot::D_METHOD("set_radial_segments", "value"), &LibSM64FaceExtractor::set_radial_segments);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_radial_segments"), &LibSM64FaceExtractor::get_radial_segments);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::INT, "radial_segments"), "set_radial_segments", "get_radial_segments");
+	godot::ClassDB::bind_method(godot::D_METHOD("set_rings", "value"), &LibSM64FaceExtractor::set_rings);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_rings"), &LibSM64FaceExtractor::get_rings);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::INT, "rings"), "set_rings", "get_rings");
+	godot::ClassDB::bind_method(godot::D_METHOD("set_world_boundary_bounds", "value"), &LibSM64FaceExtractor::set_world_boundary_bounds);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_world_boundary_bounds"), &LibSM64FaceExtractor::get_world_boundary_bounds);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::AABB, "world_boundary_bounds"), "set_world_boundary_bounds", "get_world_boundary_bounds");
+	godot::ClassDB::bind_method(godot::D_METHOD("set_grid_map_cull_internal_faces", "value"), &LibSM64FaceExtractor::set_grid_map_cull_internal_faces);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_grid_map_cull_internal_faces"), &LibSM64FaceExtractor::get_grid_map_cull_internal_faces);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::BOOL, "grid_map_cull_internal_faces"), "set_grid_map_cull_internal_faces", "get_grid_map_cull_internal_faces");
+	godot::ClassDB::bind_method(godot::D_METHOD("get_shape_faces", "shape"), &LibSM64FaceExtractor::get_shape_faces);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_node_faces", "node"), &LibSM64FaceExtractor::get_node_faces);
+	godot::ClassDB::bind_method(godot::D_METHOD("add_shape_faces", "surface_array", "shape", "transform", "properties"), &LibSM64FaceExtractor::add_shape_faces, DEFVAL(godot::Transform3D()), DEFVAL(godot::Variant()));
+	godot::ClassDB::bind_method(godot::D_METHOD("add_node_faces", "surface_array", "node", "transform", "properties"), &LibSM64FaceExtractor::add_node_faces, DEFVAL(godot::Transform3D()), DEFVAL(godot::Variant()));
+	godot::ClassDB::bind_method(godot::D_METHOD("build_surface_array", "nodes", "properties"), &LibSM64FaceExtractor::build_surface_array, DEFVAL(godot::Array()));
+}
@@ -0,0 +1,91 @@
+#ifndef LIBSM64GD_LIBSM64FACEEXTRACTOR_H
+#define LIBSM64GD_LIBSM64FACEEXTRACTOR_H
+
+#include <utility>
+#include <vector>
+
+#include <godot_cpp/classes/grid_map.hpp>
+#include <godot_cpp/classes/mesh_library.hpp>
+#include <godot_cpp/classes/node3d.hpp>
+#include <godot_cpp/classes/ref.hpp>
+#include <godot_cpp/classes/shape3d.hpp>
+
+#include <libsm64_surface_array.hpp>
+#include <libsm64_surface_properties.hpp>
+
+class LibSM64FaceExtractor : public godot::RefCounted {
+	GDCLASS(LibSM64FaceExtractor, godot::RefCounted);
+
+	friend class LibSM64SurfaceObjectQueue;
+
+public:
+	LibSM64FaceExtractor() = default;
+
+	void set_use_threads(bool p_value);
+	bool get_use_threads() const;
+
+	void set_radial_segments(int p_value);
+	int get_radial_segments() const;
+
+	void set_rings(int p_value);
+	int get_rings() const;
+
+	void set_world_boundary_bounds(const godot::AABB &p_value);
+	godot::AABB get_world_boundary_bounds() const;
+
+	void set_grid_map_cull_internal_faces(bool p_value);
+	bool get_grid_map_cull_internal_faces() const;
+
+	godot::PackedVector3Array get_shape_faces(const godot::Ref<godot::Shape3D> &p_shape) const;
+	godot::PackedVector3Array get_node_faces(godot::Node3D *p_node) const;
+
+	void add_shape_faces(const godot::Ref<LibSM64SurfaceArray> &p_surface_array, const godot::Ref<godot::Shape3D> &p_shape, const godot::Transform3D &p_transform = godot::Transform3D(), const godot::Ref<LibSM64SurfaceProperties> &p_properties = godot::Ref<LibSM64SurfaceProperties>()) const;
+	void add_node_faces(const godot::Ref<LibSM64SurfaceArray> &p_surface_array, godot::Node3D *p_node, const godot::Transform3D &p_transform = godot::Transform3D(), const godot::Ref<LibSM64SurfaceProperties> &p_properties = godot::Ref<LibSM64SurfaceProperties>()) const;
+
+	godot::Ref<LibSM64SurfaceArray> build_surface_array(const godot::Array &p_nodes, const godot::Array &p_properties = godot::Array());
+
+protected:
+	static void _bind_methods();
+
+private:
+	struct ProfilePoint {
+		godot::real_t y;
+		godot::real_t radius;
+	};
+
+	// Everything needed to convert a node off the main thread. Mesh faces are read on the
+	// main thread since meshes may need the RenderingServer, shapes are tessellated later.
+	struct NodeSnapshot {
+		godot::Node3D *node = nullptr;
+		godot::Transform3D transform;
+		godot::Ref<LibSM64SurfaceProperties> properties;
+		std::vector<godot::Vector3> faces;
+		std::vector<std::pair<godot::Ref<godot::Shape3D>, godot::Transform3D>> shapes;
+		godot::Ref<LibSM64SurfaceArray> surface_array;
+	};
+
+	void append_shape_faces(std::vector<godot::Vector3> &r_faces, const godot::Ref<godot::Shape3D> &p_shape, const godot::Transform3D &p_transform) const;
+	void append_node_faces(std::vector<godot::Vector3> &r_faces, godot::Node3D *p_node) const;
+	void append_grid_map_faces(std::vector<godot::Vector3> &r_faces, godot::GridMap *p_grid_map) const;
+	void append_mesh_library_item_faces(std::vector<godot::Vector3> &r_faces, const godot::Ref<godot::MeshLibrary> &p_mesh_library, int32_t p_item) const;
+
+	void snapshot_node(NodeSnapshot &r_snapshot) const;
+	void build_snapshot(NodeSnapshot &r_snapshot) const;
+	static void build_snapshot_task(void *p_userdata, uint32_t p_index);
+
+	void append_box_faces(std::vector<godot::Vector3> &r_faces, const godot::Vector3 &p_size) const;
+	void append_lathe_faces(std::vector<godot::Vector3> &r_faces, const std::vector<ProfilePoint> &p_profile) const;
+	void append_convex_hull_faces(std::vector<godot::Vector3> &r_faces, const godot::PackedVector3Array &p_points) const;
+	void append_height_map_faces(std::vector<godot::Vector3> &r_faces, int p_width, int p_depth, const godot::PackedFloat32Array &p_data) const;
+	void append_world_boundary_faces(std::vector<godot::Vector3> &r_faces, const godot::Plane &p_plane) const;
+
+	int radial_segments = 16;
+	int rings = 8;
+	godot::AABB world_boundary_bounds = godot::AABB(godot::Vector3(-100, -100, -100), godot::Vector3(200, 200, 200));
+	bool use_threads = true;
+	bool grid_map_cull_internal_faces = true;
+
+	std::vector<NodeSnapshot> task_snapshots;
+};
+
+#endif // LIBSM64GD_LIBSM64FACEEXTRACTOR_H
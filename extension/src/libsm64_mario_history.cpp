@@ -0,0 +1,315 @@
+#include <libsm64_mario_history.hpp>
+
+#include <cstring>
+
+#include <godot_cpp/classes/array_mesh.hpp>
+#include <godot_cpp/core/class_db.hpp>
+
+#include <libsm64_mario_interpolator.hpp>
+
+// Largest int16 magnitude written by quantize()
+static constexpr float QUANTIZATION_RANGE = 32767.0f;
+// Steps over the keyframe's largest coordinate, half the int16 range so the mesh can grow until the next keyframe
+static constexpr float POSITION_QUANTIZATION_STEPS = 16384.0f;
+// Normals are unit vectors, 12 bits per component are plenty for shading
+static constexpr float NORMAL_QUANTIZATION = 4095.0f;
+
+static int16_t quantize(float p_value, float p_step) {
+	return static_cast<int16_t>(godot::CLAMP(godot::Math::round(p_value / p_step), -QUANTIZATION_RANGE, QUANTIZATION_RANGE));
+}
+
+static void write_varint(std::vector<uint8_t> &r_buffer, int32_t p_value) {
+	// Zigzag encoding maps small negative values to small unsigned values
+	uint32_t value = (static_cast<uint32_t>(p_value) << 1) ^ static_cast<uint32_t>(p_value >> 31);
+	while (value >= 0x80) {
+		r_buffer.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	r_buffer.push_back(static_cast<uint8_t>(value));
+}
+
+static int32_t read_varint(const uint8_t *&r_ptr) {
+	uint32_t value = 0;
+	int shift = 0;
+	uint8_t byte;
+	do {
+		byte = *r_ptr++;
+		value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+	return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+void LibSM64MarioHistory::set_capacity(int p_value) {
+	ERR_FAIL_COND(p_value < 1);
+	capacity = p_value;
+	clear();
+}
+
+int LibSM64MarioHistory::get_capacity() const {
+	return capacity;
+}
+
+void LibSM64MarioHistory::set_keyframe_interval(int p_value) {
+	ERR_FAIL_COND(p_value < 1);
+	keyframe_interval = p_value;
+}
+
+int LibSM64MarioHistory::get_keyframe_interval() const {
+	return keyframe_interval;
+}
+
+void LibSM64MarioHistory::push(const godot::Ref<LibSM64MarioState> &p_mario_state, const godot::Array &p_array_mesh_triangles) {
+	ERR_FAIL_NULL(p_mario_state);
+	ERR_FAIL_COND(p_array_mesh_triangles.size() != godot::ArrayMesh::ARRAY_MAX);
+
+	if (static_cast<int>(frames.size()) != capacity) {
+		frames.resize(capacity);
+	}
+	if (size == capacity) {
+		evict_oldest();
+	}
+
+	const godot::PackedVector3Array vertices = p_array_mesh_triangles[godot::ArrayMesh::ARRAY_VERTEX];
+	const godot::PackedVector3Array normals = p_array_mesh_triangles[godot::ArrayMesh::ARRAY_NORMAL];
+	const Frame *newest = size > 0 ? &frame_at(0) : nullptr;
+
+	Frame frame;
+	frame.state.position = p_mario_state->get_position();
+	frame.state.velocity = p_mario_state->get_velocity();
+	frame.state.face_angle = p_mario_state->get_face_angle();
+	frame.state.health = p_mario_state->get_health();
+	frame.state.action = p_mario_state->get_action();
+	frame.state.flags = p_mario_state->get_flags();
+	frame.state.particle_flags = p_mario_state->get_particle_flags();
+	frame.state.invincibility_time = p_mario_state->get_invincibility_time();
+	frame.vertex_count = vertices.size();
+
+	const godot::Vector3 *vertices_ptr = vertices.ptr();
+	const godot::Vector3 *normals_ptr = normals.ptr();
+	const int64_t normal_count = godot::MIN(normals.size(), frame.vertex_count);
+
+	float extent = CMP_EPSILON;
+	for (int64_t i = 0; i < frame.vertex_count; i++) {
+		const godot::Vector3 relative = vertices_ptr[i] - frame.state.position;
+		extent = godot::MAX(extent, static_cast<float>(godot::MAX(godot::Math::abs(relative.x), godot::MAX(godot::Math::abs(relative.y), godot::Math::abs(relative.z)))));
+	}
+
+	// Delta frames reuse the keyframe's step, a new keyframe is started rather than clamping a mesh that outgrew it
+	frame.keyframe = newest == nullptr || frames_since_keyframe + 1 >= keyframe_interval || newest->vertex_count != frame.vertex_count || extent > newest->position_step * QUANTIZATION_RANGE;
+	frame.position_step = frame.keyframe ? extent / POSITION_QUANTIZATION_STEPS : newest->position_step;
+
+	std::vector<int16_t> quantized(6 * frame.vertex_count, 0);
+	for (int64_t i = 0; i < frame.vertex_count; i++) {
+		const godot::Vector3 relative = vertices_ptr[i] - frame.state.position;
+		for (int j = 0; j < 3; j++) {
+			quantized[3 * i + j] = quantize(relative[j], frame.position_step);
+		}
+	}
+	int16_t *quantized_normals = quantized.data() + 3 * frame.vertex_count;
+	for (int64_t i = 0; i < normal_count; i++) {
+		for (int j = 0; j < 3; j++) {
+			quantized_normals[3 * i + j] = quantize(normals_ptr[i][j], 1.0f / NORMAL_QUANTIZATION);
+		}
+	}
+
+	if (frame.keyframe) {
+		frame.geometry.resize(quantized.size() * sizeof(int16_t));
+		if (!quantized.empty()) {
+			memcpy(frame.geometry.data(), quantized.data(), frame.geometry.size());
+		}
+		frames_since_keyframe = 0;
+	} else {
+		frame.geometry.reserve(quantized.size());
+		for (size_t i = 0; i < quantized.size(); i++) {
+			write_varint(frame.geometry, static_cast<int32_t>(quantized[i]) - newest_quantized[i]);
+		}
+		frame.geometry.shrink_to_fit();
+		frames_since_keyframe++;
+	}
+
+	// Colors and UVs rarely change between ticks, share the previous frame's buffers when they match
+	const godot::PackedColorArray colors = p_array_mesh_triangles[godot::ArrayMesh::ARRAY_COLOR];
+	const godot::PackedVector2Array uvs = p_array_mesh_triangles[godot::ArrayMesh::ARRAY_TEX_UV];
+	frame.colors_shared = newest != nullptr && newest->colors == colors;
+	frame.colors = frame.colors_shared ? newest->colors : colors;
+	frame.uvs_shared = newest != nullptr && newest->uvs == uvs;
+	frame.uvs = frame.uvs_shared ? newest->uvs : uvs;
+
+	newest_quantized = std::move(quantized);
+	frames[(head + size) % capacity] = std::move(frame);
+	size++;
+}
+
+void LibSM64MarioHistory::clear() {
+	frames.clear();
+	newest_quantized.clear();
+	head = 0;
+	size = 0;
+	frames_since_keyframe = 0;
+}
+
+int LibSM64MarioHistory::get_tick_count() const {
+	return size;
+}
+
+godot::Ref<LibSM64MarioState> LibSM64MarioHistory::get_mario_state(int p_ticks_ago) const {
+	ERR_FAIL_INDEX_V(p_ticks_ago, size, nullptr);
+	return make_mario_state(frame_at(p_ticks_ago).state);
+}
+
+godot::Array LibSM64MarioHistory::get_array_mesh_triangles(int p_ticks_ago) const {
+	ERR_FAIL_INDEX_V(p_ticks_ago, size, godot::Array());
+
+	std::vector<int16_t> quantized;
+	decode_quantized(p_ticks_ago, quantized);
+	return make_array_mesh_triangles(frame_at(p_ticks_ago), quantized);
+}
+
+godot::Ref<LibSM64MarioState> LibSM64MarioHistory::interpolate_mario_state(double p_ticks_ago) const {
+	ERR_FAIL_COND_V(size == 0, nullptr);
+
+	const double ticks_ago = godot::CLAMP(p_ticks_ago, 0.0, static_cast<double>(size - 1));
+	const int newer = static_cast<int>(godot::Math::floor(ticks_ago));
+	const int older = godot::MIN(newer + 1, size - 1);
+
+	godot::Ref<LibSM64MarioInterpolator> interpolator = memnew(LibSM64MarioInterpolator);
+	interpolator->set_mario_state_previous(get_mario_state(older));
+	interpolator->set_mario_state_current(get_mario_state(newer));
+	return interpolator->interpolate_mario_state(1.0 - (ticks_ago - newer));
+}
+
+godot::Array LibSM64MarioHistory::interpolate_array_mesh_triangles(double p_ticks_ago) const {
+	ERR_FAIL_COND_V(size == 0, godot::Array());
+
+	const double ticks_ago = godot::CLAMP(p_ticks_ago, 0.0, static_cast<double>(size - 1));
+	const int newer = static_cast<int>(godot::Math::floor(ticks_ago));
+	const int older = godot::MIN(newer + 1, size - 1);
+
+	godot::Ref<LibSM64MarioInterpolator> interpolator = memnew(LibSM64MarioInterpolator);
+	interpolator->set_array_mesh_triangles_previous(get_array_mesh_triangles(older));
+	interpolator->set_array_mesh_triangles_current(get_array_mesh_triangles(newer));
+	return interpolator->interpolate_array_mesh_triangles(1.0 - (ticks_ago - newer));
+}
+
+int64_t LibSM64MarioHistory::get_memory_usage() const {
+	int64_t ret = sizeof(LibSM64MarioHistory) + frames.capacity() * sizeof(Frame) + newest_quantized.capacity() * sizeof(int16_t);
+	for (int i = 0; i < size; i++) {
+		const Frame &frame = frame_at(i);
+		ret += frame.geometry.capacity();
+		if (!frame.colors_shared) {
+			ret += frame.colors.size() * sizeof(godot::Color);
+		}
+		if (!frame.uvs_shared) {
+			ret += frame.uvs.size() * sizeof(godot::Vector2);
+		}
+	}
+	return ret;
+}
+
+const LibSM64MarioHistory::Frame &LibSM64MarioHistory::frame_at(int p_ticks_ago) const {
+	return frames[(head + size - 1 - p_ticks_ago) % capacity];
+}
+
+void LibSM64MarioHistory::decode_quantized(int p_ticks_ago, std::vector<int16_t> &r_quantized) const {
+	int keyframe_ticks_ago = p_ticks_ago;
+	while (!frame_at(keyframe_ticks_ago).keyframe) {
+		keyframe_ticks_ago++;
+	}
+
+	const Frame &keyframe = frame_at(keyframe_ticks_ago);
+	r_quantized.resize(keyframe.geometry.size() / sizeof(int16_t));
+	if (!r_quantized.empty()) {
+		memcpy(r_quantized.data(), keyframe.geometry.data(), keyframe.geometry.size());
+	}
+
+	for (int i = keyframe_ticks_ago - 1; i >= p_ticks_ago; i--) {
+		const uint8_t *ptr = frame_at(i).geometry.data();
+		for (int16_t &value : r_quantized) {
+			value = static_cast<int16_t>(value + read_varint(ptr));
+		}
+	}
+}
+
+godot::Array LibSM64MarioHistory::make_array_mesh_triangles(const Frame &p_frame, const std::vector<int16_t> &p_quantized) const {
+	godot::PackedVector3Array vertices;
+	vertices.resize(p_frame.vertex_count);
+	godot::PackedVector3Array normals;
+	normals.resize(p_frame.vertex_count);
+
+	godot::Vector3 *vertices_ptrw = vertices.ptrw();
+	godot::Vector3 *normals_ptrw = normals.ptrw();
+	const int16_t *quantized_normals = p_quantized.data() + 3 * p_frame.vertex_count;
+	for (int64_t i = 0; i < p_frame.vertex_count; i++) {
+		vertices_ptrw[i] = p_frame.state.position + godot::Vector3(p_quantized[3 * i], p_quantized[3 * i + 1], p_quantized[3 * i + 2]) * p_frame.position_step;
+		normals_ptrw[i] = godot::Vector3(quantized_normals[3 * i], quantized_normals[3 * i + 1], quantized_normals[3 * i + 2]) / NORMAL_QUANTIZATION;
+	}
+
+	auto ret = godot::Array();
+	ret.resize(godot::ArrayMesh::ARRAY_MAX);
+
+	ret[godot::ArrayMesh::ARRAY_VERTEX] = vertices;
+	ret[godot::ArrayMesh::ARRAY_NORMAL] = normals;
+	ret[godot::ArrayMesh::ARRAY_COLOR] = p_frame.colors;
+	ret[godot::ArrayMesh::ARRAY_TEX_UV] = p_frame.uvs;
+
+	return ret;
+}
+
+godot::Ref<LibSM64MarioState> LibSM64MarioHistory::make_mario_state(const State &p_state) const {
+	godot::Ref<LibSM64MarioState> ret = memnew(LibSM64MarioState);
+
+	ret->set_position(p_state.position);
+	ret->set_velocity(p_state.velocity);
+	ret->set_face_angle(p_state.face_angle);
+	ret->set_health(p_state.health);
+	ret->set_action(p_state.action);
+	ret->set_flags(p_state.flags);
+	ret->set_particle_flags(p_state.particle_flags);
+	ret->set_invincibility_time(p_state.invincibility_time);
+
+	return ret;
+}
+
+void LibSM64MarioHistory::evict_oldest() {
+	// The second oldest frame becomes the oldest, so it must be decodable on its own
+	if (size > 1 && !frame_at(size - 2).keyframe) {
+		std::vector<int16_t> quantized;
+		decode_quantized(size - 2, quantized);
+
+		Frame &frame = frames[(head + 1) % capacity];
+		frame.keyframe = true;
+		frame.geometry.resize(quantized.size() * sizeof(int16_t));
+		frame.geometry.shrink_to_fit();
+		if (!quantized.empty()) {
+			memcpy(frame.geometry.data(), quantized.data(), frame.geometry.size());
+		}
+	}
+
+	if (size > 1) {
+		Frame &frame = frames[(head + 1) % capacity];
+		frame.colors_shared = false;
+		frame.uvs_shared = false;
+	}
+
+	frames[head] = Frame();
+	head = (head + 1) % capacity;
+	size--;
+}
+
+void LibSM64MarioHistory::_bind_methods() {
+	godot::ClassDB::bind_method(godot::D_METHOD("set_capacity", "value"), &LibSM64MarioHistory::set_capacity);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_capacity"), &LibSM64MarioHistory::get_capacity);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::INT, "capacity"), "set_capacity", "get_capacity");
+	godot::ClassDB::bind_method(godot::D_METHOD("set_keyframe_interval", "value"), &LibSM64MarioHistory::set_keyframe_interval);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_keyframe_interval"), &LibSM64MarioHistory::get_keyframe_interval);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::INT, "keyframe_interval"), "set_keyframe_interval", "get_keyframe_interval");
+	godot::ClassDB::bind_method(godot::D_METHOD("push", "mario_state", "array_mesh_triangles"), &LibSM64MarioHistory::push);
+	godot::ClassDB::bind_method(godot::D_METHOD("clear"), &LibSM64MarioHistory::clear);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_tick_count"), &LibSM64MarioHistory::get_tick_count);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_mario_state", "ticks_ago"), &LibSM64MarioHistory::get_mario_state);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_array_mesh_triangles", "ticks_ago"), &LibSM64MarioHistory::get_array_mesh_triangles);
+	godot::ClassDB::bind_method(godot::D_METHOD("interpolate_mario_state", "ticks_ago"), &LibSM64MarioHistory::interpolate_mario_state);
+	godot::ClassDB::bind_method(godot::D_METHOD("interpolate_array_mesh_triangles", "ticks_ago"), &LibSM64MarioHistory::interpolate_array_mesh_triangles);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_memory_usage"), &LibSM64MarioHistory::get_memory_usage);
+}
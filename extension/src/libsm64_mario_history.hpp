@@ -0,0 +1,81 @@
+#ifndef LIBSM64GD_LIBSM64MARIOHISTORY_H
+#define LIBSM64GD_LIBSM64MARIOHISTORY_H
+
+#include <cstdint>
+#include <vector>
+
+#include <godot_cpp/classes/ref.hpp>
+
+#include <libsm64_mario_state.hpp>
+
+class LibSM64MarioHistory : public godot::RefCounted {
+	GDCLASS(LibSM64MarioHistory, godot::RefCounted);
+
+public:
+	LibSM64MarioHistory() = default;
+
+	void set_capacity(int p_value);
+	int get_capacity() const;
+
+	void set_keyframe_interval(int p_value);
+	int get_keyframe_interval() const;
+
+	void push(const godot::Ref<LibSM64MarioState> &p_mario_state, const godot::Array &p_array_mesh_triangles);
+	void clear();
+	int get_tick_count() const;
+
+	godot::Ref<LibSM64MarioState> get_mario_state(int p_ticks_ago) const;
+	godot::Array get_array_mesh_triangles(int p_ticks_ago) const;
+
+	godot::Ref<LibSM64MarioState> interpolate_mario_state(double p_ticks_ago) const;
+	godot::Array interpolate_array_mesh_triangles(double p_ticks_ago) const;
+
+	int64_t get_memory_usage() const;
+
+protected:
+	static void _bind_methods();
+
+private:
+	struct State {
+		godot::Vector3 position;
+		godot::Vector3 velocity;
+		float face_angle = 0.0f;
+		int health = 0;
+		int64_t action = 0;
+		int64_t flags = 0;
+		int64_t particle_flags = 0;
+		double invincibility_time = 0.0;
+	};
+
+	// Vertex positions are stored relative to Mario's position and normals as unit vectors,
+	// both quantized to int16. Delta frames store zigzag varint differences to the previous frame.
+	struct Frame {
+		State state;
+		bool keyframe = true;
+		float position_step = 0.0f;
+		int64_t vertex_count = 0;
+		std::vector<uint8_t> geometry;
+		godot::PackedColorArray colors;
+		godot::PackedVector2Array uvs;
+		bool colors_shared = false;
+		bool uvs_shared = false;
+	};
+
+	const Frame &frame_at(int p_ticks_ago) const;
+	void decode_quantized(int p_ticks_ago, std::vector<int16_t> &r_quantized) const;
+	godot::Array make_array_mesh_triangles(const Frame &p_frame, const std::vector<int16_t> &p_quantized) const;
+	godot::Ref<LibSM64MarioState> make_mario_state(const State &p_state) const;
+	void evict_oldest();
+
+	std::vector<Frame> frames;
+	int head = 0;
+	int size = 0;
+	int capacity = 300;
+	int keyframe_interval = 30;
+	int frames_since_keyframe = 0;
+
+	// Quantized geometry of the newest frame, the reference for the next delta frame
+	std::vector<int16_t> newest_quantized;
+};
+
+#endif // LIBSM64GD_LIBSM64MARIOHISTORY_H
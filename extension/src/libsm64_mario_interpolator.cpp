@@ -2,20 +2,45 @@
 
 #include <godot_cpp/classes/array_mesh.hpp>
 
-static godot::PackedVector3Array lerp(const godot::Vector3 *a, const godot::Vector3 *b, int64_t vertex_count, godot::real_t t) {
-	auto ret = godot::PackedVector3Array();
-	ret.resize(vertex_count);
+#include <libsm64_vector_math.hpp>
 
-	auto *ret_ptrw = ret.ptrw();
-	for (int i = 0; i < vertex_count; i++) {
-		ret_ptrw[i] = a[i].lerp(b[i], t);
+// Shortest signed angle from p_from to p_to, in radians
+static float angle_difference(float p_from, float p_to) {
+	const float difference = godot::Math::fmod(p_to - p_from, static_cast<float>(Math_TAU));
+	return godot::Math::fmod(2.0f * difference, static_cast<float>(Math_TAU)) - difference;
+}
+
+void LibSM64MarioInterpolator::MeshBuffers::unpack(const godot::Array &p_array_mesh_triangles) {
+	if (p_array_mesh_triangles.size() != godot::ArrayMesh::ARRAY_MAX) {
+		*this = MeshBuffers();
+		return;
 	}
 
-	return ret;
+	vertices = p_array_mesh_triangles[godot::ArrayMesh::ARRAY_VERTEX];
+	normals = p_array_mesh_triangles[godot::ArrayMesh::ARRAY_NORMAL];
+	colors = p_array_mesh_triangles[godot::ArrayMesh::ARRAY_COLOR];
+	uvs = p_array_mesh_triangles[godot::ArrayMesh::ARRAY_TEX_UV];
+}
+
+template <typename T>
+static bool packed_arrays_equal(const T &p_a, const T &p_b) {
+	return (p_a.size() == p_b.size() && p_a.ptr() == p_b.ptr()) || p_a == p_b;
+}
+
+void LibSM64MarioInterpolator::update_mesh_unchanged() {
+	mesh_unchanged = packed_arrays_equal(mesh_buffers_previous.vertices, mesh_buffers_current.vertices) &&
+			packed_arrays_equal(mesh_buffers_previous.normals, mesh_buffers_current.normals);
+}
+
+void LibSM64MarioInterpolator::invalidate_cached_array_mesh_triangles() {
+	cached_array_mesh_triangles = godot::Array();
 }
 
 void LibSM64MarioInterpolator::set_array_mesh_triangles_current(const godot::Array &p_value) {
 	array_mesh_triangles_current = p_value;
+	mesh_buffers_current.unpack(p_value);
+	update_mesh_unchanged();
+	invalidate_cached_array_mesh_triangles();
 }
 
 godot::Array LibSM64MarioInterpolator::get_array_mesh_triangles_current() const {
@@ -24,6 +49,9 @@ godot::Array LibSM64MarioInterpolator::get_array_mesh_triangles_current() const
 
 void LibSM64MarioInterpolator::set_array_mesh_triangles_previous(const godot::Array &p_value) {
 	array_mesh_triangles_previous = p_value;
+	mesh_buffers_previous.unpack(p_value);
+	update_mesh_unchanged();
+	invalidate_cached_array_mesh_triangles();
 }
 
 godot::Array LibSM64MarioInterpolator::get_array_mesh_triangles_previous() const {
@@ -31,6 +59,11 @@ godot::Array LibSM64MarioInterpolator::get_array_mesh_triangles_previous() const
 }
 
 void LibSM64MarioInterpolator::set_mario_state_current(const godot::Ref<LibSM64MarioState> &p_value) {
+	// The new tick starts from its own pose, remember how far off the last prediction was to blend it out
+	if (mode == MODE_EXTRAPOLATE && has_last_extrapolated_pose && p_value.is_valid()) {
+		correction_position_offset = last_extrapolated_position - p_value->position;
+		correction_face_angle_offset = angle_difference(p_value->face_angle, last_extrapolated_face_angle);
+	}
 	mario_state_current = p_value;
 }
 
@@ -40,34 +73,103 @@ godot::Ref<LibSM64MarioState> LibSM64MarioInterpolator::get_mario_state_current(
 
 void LibSM64MarioInterpolator::set_mario_state_previous(const godot::Ref<LibSM64MarioState> &p_value) {
 	mario_state_previous = p_value;
+	// Resetting the interpolation (e.g. on teleport) must not blend from the stale prediction
+	if (mario_state_previous == mario_state_current) {
+		correction_position_offset = godot::Vector3();
+		correction_face_angle_offset = 0.0f;
+	}
 }
 
 godot::Ref<LibSM64MarioState> LibSM64MarioInterpolator::get_mario_state_previous() const {
 	return mario_state_previous;
 }
 
+void LibSM64MarioInterpolator::set_normalize_normals(bool p_value) {
+	normalize_normals = p_value;
+	invalidate_cached_array_mesh_triangles();
+}
+
+bool LibSM64MarioInterpolator::get_normalize_normals() const {
+	return normalize_normals;
+}
+
+void LibSM64MarioInterpolator::set_mode(Mode p_value) {
+	mode = p_value;
+	correction_position_offset = godot::Vector3();
+	correction_face_angle_offset = 0.0f;
+	has_last_extrapolated_pose = false;
+}
+
+LibSM64MarioInterpolator::Mode LibSM64MarioInterpolator::get_mode() const {
+	return mode;
+}
+
+void LibSM64MarioInterpolator::set_extrapolation_horizon(double p_value) {
+	extrapolation_horizon = godot::MAX(0.0, p_value);
+}
+
+double LibSM64MarioInterpolator::get_extrapolation_horizon() const {
+	return extrapolation_horizon;
+}
+
+void LibSM64MarioInterpolator::set_extrapolation_correction_ticks(double p_value) {
+	extrapolation_correction_ticks = godot::MAX(0.0, p_value);
+}
+
+double LibSM64MarioInterpolator::get_extrapolation_correction_ticks() const {
+	return extrapolation_correction_ticks;
+}
+
+void LibSM64MarioInterpolator::set_extrapolate_mesh(bool p_value) {
+	extrapolate_mesh = p_value;
+}
+
+bool LibSM64MarioInterpolator::get_extrapolate_mesh() const {
+	return extrapolate_mesh;
+}
+
 godot::Array LibSM64MarioInterpolator::interpolate_array_mesh_triangles(double p_t) const {
 	ERR_FAIL_COND_V(array_mesh_triangles_current.size() != godot::ArrayMesh::ARRAY_MAX, godot::Array());
 	ERR_FAIL_COND_V(array_mesh_triangles_previous.size() != godot::ArrayMesh::ARRAY_MAX, godot::Array());
 
-	auto ret = godot::Array();
-	ret.resize(godot::ArrayMesh::ARRAY_MAX);
+	if (mode == MODE_EXTRAPOLATE) {
+		return extrapolate_array_mesh_triangles(p_t);
+	}
+
+	// Returning the same arrays lets callers skip re-uploading the mesh
+	if (mesh_unchanged) {
+		return array_mesh_triangles_current;
+	}
+	if (!cached_array_mesh_triangles.is_empty() && cached_array_mesh_triangles_t == p_t) {
+		return cached_array_mesh_triangles;
+	}
 
-	const godot::PackedVector3Array &vertices_current = array_mesh_triangles_current[godot::ArrayMesh::ARRAY_VERTEX];
-	const godot::PackedVector3Array &vertices_previous = array_mesh_triangles_previous[godot::ArrayMesh::ARRAY_VERTEX];
-	const godot::PackedVector3Array &normals_current = array_mesh_triangles_current[godot::ArrayMesh::ARRAY_NORMAL];
-	const godot::PackedVector3Array &normals_previous = array_mesh_triangles_previous[godot::ArrayMesh::ARRAY_NORMAL];
+	const auto vertex_count = godot::MIN(mesh_buffers_current.vertices.size(), mesh_buffers_previous.vertices.size());
+	const auto normal_count = godot::MIN(vertex_count, godot::MIN(mesh_buffers_current.normals.size(), mesh_buffers_previous.normals.size()));
+	const auto t = static_cast<godot::real_t>(p_t);
 
-	const auto vertex_count = godot::MIN(vertices_current.size(), vertices_previous.size());
+	godot::PackedVector3Array vertices;
+	vertices.resize(vertex_count);
+	lerp_vector3_array(mesh_buffers_previous.vertices.ptr(), mesh_buffers_current.vertices.ptr(), vertices.ptrw(), vertex_count, t);
 
-	ret[godot::ArrayMesh::ARRAY_VERTEX] = lerp(vertices_previous.ptr(), vertices_current.ptr(), vertex_count, static_cast<godot::real_t>(p_t));
-	ret[godot::ArrayMesh::ARRAY_NORMAL] = lerp(normals_previous.ptr(), normals_current.ptr(), vertex_count, static_cast<godot::real_t>(p_t));
+	godot::PackedVector3Array normals;
+	normals.resize(normal_count);
+	if (normalize_normals) {
+		nlerp_vector3_array(mesh_buffers_previous.normals.ptr(), mesh_buffers_current.normals.ptr(), normals.ptrw(), normal_count, t);
+	} else {
+		lerp_vector3_array(mesh_buffers_previous.normals.ptr(), mesh_buffers_current.normals.ptr(), normals.ptrw(), normal_count, t);
+	}
 
-	const godot::PackedColorArray &colors_current = array_mesh_triangles_current[godot::ArrayMesh::ARRAY_COLOR];
-	const godot::PackedVector2Array &uvs_current = array_mesh_triangles_current[godot::ArrayMesh::ARRAY_TEX_UV];
+	auto ret = godot::Array();
+	ret.resize(godot::ArrayMesh::ARRAY_MAX);
 
-	ret[godot::ArrayMesh::ARRAY_COLOR] = colors_current.slice(0, vertex_count);
-	ret[godot::ArrayMesh::ARRAY_TEX_UV] = uvs_current.slice(0, vertex_count);
+	ret[godot::ArrayMesh::ARRAY_VERTEX] = vertices;
+	ret[godot::ArrayMesh::ARRAY_NORMAL] = normals;
+	ret[godot::ArrayMesh::ARRAY_COLOR] = mesh_buffers_current.colors.slice(0, vertex_count);
+	ret[godot::ArrayMesh::ARRAY_TEX_UV] = mesh_buffers_current.uvs.slice(0, vertex_count);
+
+	cached_array_mesh_triangles = ret;
+	cached_array_mesh_triangles_t = p_t;
 
 	return ret;
 }
@@ -76,6 +178,10 @@ godot::Ref<LibSM64MarioState> LibSM64MarioInterpolator::interpolate_mario_state(
 	ERR_FAIL_NULL_V(mario_state_current, nullptr);
 	ERR_FAIL_NULL_V(mario_state_previous, nullptr);
 
+	if (mode == MODE_EXTRAPOLATE) {
+		return extrapolate_mario_state(p_t);
+	}
+
 	godot::Ref<LibSM64MarioState> ret = memnew(LibSM64MarioState);
 
 	ret->position = mario_state_previous->position.lerp(mario_state_current->position, p_t);
@@ -92,7 +198,102 @@ godot::Ref<LibSM64MarioState> LibSM64MarioInterpolator::interpolate_mario_state(
 	return ret;
 }
 
+void LibSM64MarioInterpolator::compute_extrapolated_pose(double p_t, godot::Vector3 &r_position, float &r_face_angle) const {
+	// p_t is measured in ticks past the current state, velocity is per second
+	const double t = godot::CLAMP(p_t, 0.0, extrapolation_horizon);
+	const float face_angle_rate = angle_difference(mario_state_previous->face_angle, mario_state_current->face_angle);
+
+	r_position = mario_state_current->position + mario_state_current->velocity * static_cast<godot::real_t>(t * LibSM64::tick_delta_time);
+	r_face_angle = mario_state_current->face_angle + face_angle_rate * static_cast<float>(t);
+
+	const double correction = extrapolation_correction_ticks > 0.0 ? godot::MAX(0.0, 1.0 - p_t / extrapolation_correction_ticks) : 0.0;
+	r_position += correction_position_offset * static_cast<godot::real_t>(correction);
+	r_face_angle += correction_face_angle_offset * static_cast<float>(correction);
+}
+
+godot::Ref<LibSM64MarioState> LibSM64MarioInterpolator::extrapolate_mario_state(double p_t) const {
+	godot::Ref<LibSM64MarioState> ret = memnew(LibSM64MarioState);
+
+	compute_extrapolated_pose(p_t, ret->position, ret->face_angle);
+	ret->velocity = mario_state_current->velocity;
+
+	ret->health = mario_state_current->health;
+	ret->action = mario_state_current->action;
+	ret->flags = mario_state_current->flags;
+	ret->particle_flags = mario_state_current->particle_flags;
+
+	ret->invincibility_time = godot::MAX(0.0, mario_state_current->invincibility_time - godot::CLAMP(p_t, 0.0, extrapolation_horizon) * LibSM64::tick_delta_time);
+
+	last_extrapolated_position = ret->position;
+	last_extrapolated_face_angle = ret->face_angle;
+	has_last_extrapolated_pose = true;
+
+	return ret;
+}
+
+godot::Array LibSM64MarioInterpolator::extrapolate_array_mesh_triangles(double p_t) const {
+	if (!extrapolate_mesh || mario_state_current.is_null() || mario_state_previous.is_null()) {
+		return array_mesh_triangles_current;
+	}
+
+	godot::Vector3 position;
+	float face_angle;
+	compute_extrapolated_pose(p_t, position, face_angle);
+	if (position == mario_state_current->position && face_angle == mario_state_current->face_angle) {
+		return array_mesh_triangles_current;
+	}
+
+	// Move the current mesh rigidly from the current pose to the extrapolated pose
+	const godot::Basis rotation(godot::Vector3(0, 1, 0), face_angle - mario_state_current->face_angle);
+	const godot::Vector3 origin = mario_state_current->position;
+
+	const auto vertex_count = mesh_buffers_current.vertices.size();
+	const auto normal_count = godot::MIN(vertex_count, mesh_buffers_current.normals.size());
+
+	godot::PackedVector3Array vertices;
+	vertices.resize(vertex_count);
+	const godot::Vector3 *vertices_current = mesh_buffers_current.vertices.ptr();
+	godot::Vector3 *vertices_ptrw = vertices.ptrw();
+	for (int64_t i = 0; i < vertex_count; i++) {
+		vertices_ptrw[i] = rotation.xform(vertices_current[i] - origin) + position;
+	}
+
+	godot::PackedVector3Array normals;
+	normals.resize(normal_count);
+	const godot::Vector3 *normals_current = mesh_buffers_current.normals.ptr();
+	godot::Vector3 *normals_ptrw = normals.ptrw();
+	for (int64_t i = 0; i < normal_count; i++) {
+		normals_ptrw[i] = rotation.xform(normals_current[i]);
+	}
+
+	auto ret = godot::Array();
+	ret.resize(godot::ArrayMesh::ARRAY_MAX);
+
+	ret[godot::ArrayMesh::ARRAY_VERTEX] = vertices;
+	ret[godot::ArrayMesh::ARRAY_NORMAL] = normals;
+	ret[godot::ArrayMesh::ARRAY_COLOR] = mesh_buffers_current.colors.slice(0, vertex_count);
+	ret[godot::ArrayMesh::ARRAY_TEX_UV] = mesh_buffers_current.uvs.slice(0, vertex_count);
+
+	return ret;
+}
+
+void LibSM64MarioInterpolator::interpolate(double p_t) {
+	interpolated_mario_state = interpolate_mario_state(p_t);
+	interpolated_array_mesh_triangles = interpolate_array_mesh_triangles(p_t);
+}
+
+godot::Array LibSM64MarioInterpolator::get_interpolated_array_mesh_triangles() const {
+	return interpolated_array_mesh_triangles;
+}
+
+godot::Ref<LibSM64MarioState> LibSM64MarioInterpolator::get_interpolated_mario_state() const {
+	return interpolated_mario_state;
+}
+
 void LibSM64MarioInterpolator::_bind_methods() {
+	BIND_ENUM_CONSTANT(MODE_INTERPOLATE);
+	BIND_ENUM_CONSTANT(MODE_EXTRAPOLATE);
+
 	godot::ClassDB::bind_method(godot::D_METHOD("set_array_mesh_triangles_current", "value"), &LibSM64MarioInterpolator::set_array_mesh_triangles_current);
 	godot::ClassDB::bind_method(godot::D_METHOD("get_array_mesh_triangles_current"), &LibSM64MarioInterpolator::get_array_mesh_triangles_current);
 	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::ARRAY, "array_mesh_triangles_current"), "set_array_mesh_triangles_current", "get_array_mesh_triangles_current");
@@ -105,6 +306,24 @@ void LibSM64MarioInterpolator::_bind_methods() {
 	godot::ClassDB::bind_method(godot::D_METHOD("set_mario_state_previous", "value"), &LibSM64MarioInterpolator::set_mario_state_previous);
 	godot::ClassDB::bind_method(godot::D_METHOD("get_mario_state_previous"), &LibSM64MarioInterpolator::get_mario_state_previous);
 	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::OBJECT, "mario_state_previous"), "set_mario_state_previous", "get_mario_state_previous");
+	godot::ClassDB::bind_method(godot::D_METHOD("set_normalize_normals", "value"), &LibSM64MarioInterpolator::set_normalize_normals);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_normalize_normals"), &LibSM64MarioInterpolator::get_normalize_normals);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::BOOL, "normalize_normals"), "set_normalize_normals", "get_normalize_normals");
+	godot::ClassDB::bind_method(godot::D_METHOD("set_mode", "value"), &LibSM64MarioInterpolator::set_mode);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_mode"), &LibSM64MarioInterpolator::get_mode);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::INT, "mode", godot::PROPERTY_HINT_ENUM, "Interpolate,Extrapolate"), "set_mode", "get_mode");
+	godot::ClassDB::bind_method(godot::D_METHOD("set_extrapolation_horizon", "value"), &LibSM64MarioInterpolator::set_extrapolation_horizon);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_extrapolation_horizon"), &LibSM64MarioInterpolator::get_extrapolation_horizon);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::FLOAT, "extrapolation_horizon"), "set_extrapolation_horizon", "get_extrapolation_horizon");
+	godot::ClassDB::bind_method(godot::D_METHOD("set_extrapolation_correction_ticks", "value"), &LibSM64MarioInterpolator::set_extrapolation_correction_ticks);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_extrapolation_correction_ticks"), &LibSM64MarioInterpolator::get_extrapolation_correction_ticks);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::FLOAT, "extrapolation_correction_ticks"), "set_extrapolation_correction_ticks", "get_extrapolation_correction_ticks");
+	godot::ClassDB::bind_method(godot::D_METHOD("set_extrapolate_mesh", "value"), &LibSM64MarioInterpolator::set_extrapolate_mesh);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_extrapolate_mesh"), &LibSM64MarioInterpolator::get_extrapolate_mesh);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::BOOL, "extrapolate_mesh"), "set_extrapolate_mesh", "get_extrapolate_mesh");
 	godot::ClassDB::bind_method(godot::D_METHOD("interpolate_array_mesh_triangles", "t"), &LibSM64MarioInterpolator::interpolate_array_mesh_triangles);
 	godot::ClassDB::bind_method(godot::D_METHOD("interpolate_mario_state", "t"), &LibSM64MarioInterpolator::interpolate_mario_state);
+	godot::ClassDB::bind_method(godot::D_METHOD("interpolate", "t"), &LibSM64MarioInterpolator::interpolate);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_interpolated_array_mesh_triangles"), &LibSM64MarioInterpolator::get_interpolated_array_mesh_triangles);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_interpolated_mario_state"), &LibSM64MarioInterpolator::get_interpolated_mario_state);
 }
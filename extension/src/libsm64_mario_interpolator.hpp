@@ -9,6 +9,11 @@ class LibSM64MarioInterpolator : public godot::RefCounted {
 	GDCLASS(LibSM64MarioInterpolator, godot::RefCounted);
 
 public:
+	enum Mode {
+		MODE_INTERPOLATE,
+		MODE_EXTRAPOLATE,
+	};
+
 	LibSM64MarioInterpolator() = default;
 
 	void set_array_mesh_triangles_current(const godot::Array &p_value);
@@ -23,17 +28,77 @@ public:
 	void set_mario_state_previous(const godot::Ref<LibSM64MarioState> &p_value);
 	godot::Ref<LibSM64MarioState> get_mario_state_previous() const;
 
+	void set_normalize_normals(bool p_value);
+	bool get_normalize_normals() const;
+
+	void set_mode(Mode p_value);
+	Mode get_mode() const;
+
+	void set_extrapolation_horizon(double p_value);
+	double get_extrapolation_horizon() const;
+
+	void set_extrapolation_correction_ticks(double p_value);
+	double get_extrapolation_correction_ticks() const;
+
+	void set_extrapolate_mesh(bool p_value);
+	bool get_extrapolate_mesh() const;
+
 	godot::Array interpolate_array_mesh_triangles(double p_t) const;
 	godot::Ref<LibSM64MarioState> interpolate_mario_state(double p_t) const;
 
+	void interpolate(double p_t);
+	godot::Array get_interpolated_array_mesh_triangles() const;
+	godot::Ref<LibSM64MarioState> get_interpolated_mario_state() const;
+
 protected:
 	static void _bind_methods();
 
 private:
+	// Typed views of the ArrayMesh arrays, extracted once per tick instead of once per interpolation
+	struct MeshBuffers {
+		godot::PackedVector3Array vertices;
+		godot::PackedVector3Array normals;
+		godot::PackedColorArray colors;
+		godot::PackedVector2Array uvs;
+
+		void unpack(const godot::Array &p_array_mesh_triangles);
+	};
+
+	void update_mesh_unchanged();
+	void invalidate_cached_array_mesh_triangles();
+
+	void compute_extrapolated_pose(double p_t, godot::Vector3 &r_position, float &r_face_angle) const;
+	godot::Ref<LibSM64MarioState> extrapolate_mario_state(double p_t) const;
+	godot::Array extrapolate_array_mesh_triangles(double p_t) const;
+
 	godot::Array array_mesh_triangles_current;
 	godot::Array array_mesh_triangles_previous;
 	godot::Ref<LibSM64MarioState> mario_state_current;
 	godot::Ref<LibSM64MarioState> mario_state_previous;
+	MeshBuffers mesh_buffers_current;
+	MeshBuffers mesh_buffers_previous;
+	// Previous and current geometry are identical, interpolating would return the current arrays
+	bool mesh_unchanged = false;
+	mutable godot::Array cached_array_mesh_triangles;
+	mutable double cached_array_mesh_triangles_t = 0.0;
+	bool normalize_normals = false;
+
+	Mode mode = MODE_INTERPOLATE;
+	double extrapolation_horizon = 1.0;
+	double extrapolation_correction_ticks = 1.0;
+	bool extrapolate_mesh = false;
+
+	// Error between the last extrapolated pose and the tick that replaced it, blended out over extrapolation_correction_ticks
+	godot::Vector3 correction_position_offset;
+	float correction_face_angle_offset = 0.0f;
+	mutable godot::Vector3 last_extrapolated_position;
+	mutable float last_extrapolated_face_angle = 0.0f;
+	mutable bool has_last_extrapolated_pose = false;
+
+	godot::Array interpolated_array_mesh_triangles;
+	godot::Ref<LibSM64MarioState> interpolated_mario_state;
 };
 
+VARIANT_ENUM_CAST(LibSM64MarioInterpolator::Mode);
+
 #endif // LIBSM64GD_LIBSM64MARIOINTERPOLATOR_H
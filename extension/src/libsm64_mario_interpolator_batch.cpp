@@ -0,0 +1,75 @@
+#include <libsm64_mario_interpolator_batch.hpp>
+
+#include <algorithm>
+
+#include <godot_cpp/classes/worker_thread_pool.hpp>
+
+void LibSM64MarioInterpolatorBatch::set_use_threads(bool p_value) {
+	use_threads = p_value;
+}
+
+bool LibSM64MarioInterpolatorBatch::get_use_threads() const {
+	return use_threads;
+}
+
+void LibSM64MarioInterpolatorBatch::add_interpolator(const godot::Ref<LibSM64MarioInterpolator> &p_interpolator) {
+	ERR_FAIL_NULL(p_interpolator);
+	ERR_FAIL_COND_MSG(has_interpolator(p_interpolator), "Interpolator already added to the batch.");
+
+	interpolators.push_back(p_interpolator);
+}
+
+void LibSM64MarioInterpolatorBatch::remove_interpolator(const godot::Ref<LibSM64MarioInterpolator> &p_interpolator) {
+	auto it = std::find(interpolators.begin(), interpolators.end(), p_interpolator);
+	ERR_FAIL_COND(it == interpolators.end());
+
+	interpolators.erase(it);
+}
+
+bool LibSM64MarioInterpolatorBatch::has_interpolator(const godot::Ref<LibSM64MarioInterpolator> &p_interpolator) const {
+	return std::find(interpolators.begin(), interpolators.end(), p_interpolator) != interpolators.end();
+}
+
+int LibSM64MarioInterpolatorBatch::get_interpolator_count() const {
+	return static_cast<int>(interpolators.size());
+}
+
+void LibSM64MarioInterpolatorBatch::clear() {
+	interpolators.clear();
+}
+
+void LibSM64MarioInterpolatorBatch::interpolate(double p_t) {
+	if (interpolators.empty()) {
+		return;
+	}
+
+	if (!use_threads || interpolators.size() == 1) {
+		for (auto &interpolator : interpolators) {
+			interpolator->interpolate(p_t);
+		}
+		return;
+	}
+
+	// Each interpolator only touches its own buffers, so they can be processed independently
+	task_t = p_t;
+	godot::WorkerThreadPool *worker_thread_pool = godot::WorkerThreadPool::get_singleton();
+	const int64_t group_id = worker_thread_pool->add_native_group_task(&LibSM64MarioInterpolatorBatch::interpolate_task, this, static_cast<int>(interpolators.size()), -1, true, "LibSM64MarioInterpolatorBatch");
+	worker_thread_pool->wait_for_group_task_completion(group_id);
+}
+
+void LibSM64MarioInterpolatorBatch::interpolate_task(void *p_userdata, uint32_t p_index) {
+	auto *batch = static_cast<LibSM64MarioInterpolatorBatch *>(p_userdata);
+	batch->interpolators[p_index]->interpolate(batch->task_t);
+}
+
+void LibSM64MarioInterpolatorBatch::_bind_methods() {
+	godot::ClassDB::bind_method(godot::D_METHOD("set_use_threads", "value"), &LibSM64MarioInterpolatorBatch::set_use_threads);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_use_threads"), &LibSM64MarioInterpolatorBatch::get_use_threads);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::BOOL, "use_threads"), "set_use_threads", "get_use_threads");
+	godot::ClassDB::bind_method(godot::D_METHOD("add_interpolator", "interpolator"), &LibSM64MarioInterpolatorBatch::add_interpolator);
+	godot::ClassDB::bind_method(godot::D_METHOD("remove_interpolator", "interpolator"), &LibSM64MarioInterpolatorBatch::remove_interpolator);
+	godot::ClassDB::bind_method(godot::D_METHOD("has_interpolator", "interpolator"), &LibSM64MarioInterpolatorBatch::has_interpolator);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_interpolator_count"), &LibSM64MarioInterpolatorBatch::get_interpolator_count);
+	godot::ClassDB::bind_method(godot::D_METHOD("clear"), &LibSM64MarioInterpolatorBatch::clear);
+	godot::ClassDB::bind_method(godot::D_METHOD("interpolate", "t"), &LibSM64MarioInterpolatorBatch::interpolate);
+}
@@ -0,0 +1,38 @@
+#ifndef LIBSM64GD_LIBSM64MARIOINTERPOLATORBATCH_H
+#define LIBSM64GD_LIBSM64MARIOINTERPOLATORBATCH_H
+
+#include <vector>
+
+#include <godot_cpp/classes/ref.hpp>
+
+#include <libsm64_mario_interpolator.hpp>
+
+class LibSM64MarioInterpolatorBatch : public godot::RefCounted {
+	GDCLASS(LibSM64MarioInterpolatorBatch, godot::RefCounted);
+
+public:
+	LibSM64MarioInterpolatorBatch() = default;
+
+	void set_use_threads(bool p_value);
+	bool get_use_threads() const;
+
+	void add_interpolator(const godot::Ref<LibSM64MarioInterpolator> &p_interpolator);
+	void remove_interpolator(const godot::Ref<LibSM64MarioInterpolator> &p_interpolator);
+	bool has_interpolator(const godot::Ref<LibSM64MarioInterpolator> &p_interpolator) const;
+	int get_interpolator_count() const;
+	void clear();
+
+	void interpolate(double p_t);
+
+protected:
+	static void _bind_methods();
+
+private:
+	static void interpolate_task(void *p_userdata, uint32_t p_index);
+
+	std::vector<godot::Ref<LibSM64MarioInterpolator>> interpolators;
+	double task_t = 0.0;
+	bool use_threads = true;
+};
+
+#endif // LIBSM64GD_LIBSM64MARIOINTERPOLATORBATCH_H
@@ -1,34 +1,119 @@
 #include <libsm64_surface_array.hpp>
 
-void LibSM64SurfaceArray::append_surfaces(const godot::Ref<LibSM64SurfaceArray> &p_surfaces) {
+#include <cstddef>
+#include <cstring>
+
+#include <godot_cpp/classes/file_access.hpp>
+
+#include <libsm64_surface_optimizer.hpp>
+
+// Binary format, little endian:
+//   0  char[8]  magic "SM64SURF"
+//   8  uint32   format version
+//   12 uint32   flags
+//   16 uint32   size of a SM64Surface record
+//   20 uint64   surface count
+//   28 uint64   payload size in bytes
+//   36 double   scale factor the surfaces were converted with
+//   44          payload, raw SM64Surface records, zstd compressed if flagged
+static constexpr char BINARY_MAGIC[8] = { 'S', 'M', '6', '4', 'S', 'U', 'R', 'F' };
+static constexpr uint32_t BINARY_VERSION = 1;
+static constexpr uint32_t BINARY_FLAG_COMPRESSED = 1 << 0;
+static constexpr int64_t BINARY_HEADER_SIZE = 44;
+
+static void rescale_surfaces(struct SM64Surface *p_surfaces, size_t p_count, double p_ratio) {
+	for (size_t i = 0; i < p_count; i++) {
+		for (auto &vertex : p_surfaces[i].vertices) {
+			for (auto &coordinate : vertex) {
+				coordinate = static_cast<int32_t>(godot::Math::round(coordinate * p_ratio));
+			}
+		}
+	}
+}
+
+void LibSM64SurfaceArray::append_surfaces(const godot::Ref<LibSM64SurfaceArray> &p_surfaces, const godot::Transform3D &p_transform) {
 	ERR_FAIL_NULL(p_surfaces);
 
 	const auto &sm64_surfaces_other = p_surfaces->sm64_surfaces;
+	if (sm64_surfaces_other.empty()) {
+		return;
+	}
+	if (sm64_surfaces.empty()) {
+		scale_factor = p_surfaces->scale_factor;
+	}
+	ERR_FAIL_COND_MSG((scale_factor == 0) != (p_surfaces->scale_factor == 0), "[libsm64-godot] Can't mix native SM64 surfaces with surfaces converted from Godot units.");
+
+	// Native surfaces are placed in Godot space using the current LibSM64.scale_factor
+	godot::real_t from_scale = p_surfaces->scale_factor;
+	godot::real_t to_scale = scale_factor;
+	if (p_transform != godot::Transform3D() && from_scale == 0) {
+		LibSM64 *libsm64 = LibSM64::get_singleton();
+		ERR_FAIL_NULL(libsm64);
+		from_scale = libsm64->get_scale_factor();
+		to_scale = from_scale;
+	}
+
+	const size_t first_surface = sm64_surfaces.size();
 	sm64_surfaces.reserve(sm64_surfaces.size() + sm64_surfaces_other.size());
 	sm64_surfaces.insert(sm64_surfaces.end(), sm64_surfaces_other.begin(), sm64_surfaces_other.end());
+
+	if (p_transform != godot::Transform3D()) {
+		// Convert back to Godot space, transform, and convert to this array's scale
+		for (size_t i = first_surface; i < sm64_surfaces.size(); i++) {
+			for (auto &vertex : sm64_surfaces[i].vertices) {
+				const godot::Vector3 position = p_transform.xform(godot::Vector3(-vertex[2], vertex[1], vertex[0]) / from_scale);
+				vertex[0] = static_cast<int32_t>(godot::Math::round(position.z * to_scale));
+				vertex[1] = static_cast<int32_t>(godot::Math::round(position.y * to_scale));
+				vertex[2] = static_cast<int32_t>(godot::Math::round(-position.x * to_scale));
+			}
+		}
+	} else if (from_scale != to_scale) {
+		rescale_surfaces(sm64_surfaces.data() + first_surface, sm64_surfaces_other.size(), to_scale / from_scale);
+	}
+}
+
+bool LibSM64SurfaceArray::match_scale_factor(godot::real_t p_scale_factor) {
+	if (sm64_surfaces.empty()) {
+		scale_factor = p_scale_factor;
+		return true;
+	}
+	ERR_FAIL_COND_V_MSG(scale_factor == 0, false, "[libsm64-godot] Can't add triangles to an array holding native SM64 surfaces.");
+
+	// Surfaces converted with an older scale factor are converted to the current one
+	if (scale_factor != p_scale_factor) {
+		rescale_surfaces(sm64_surfaces.data(), sm64_surfaces.size(), p_scale_factor / scale_factor);
+		scale_factor = p_scale_factor;
+	}
+	return true;
+}
+
+static _FORCE_INLINE_ struct SM64Surface make_sm64_surface(const godot::Vector3 &p_vertex_1, const godot::Vector3 &p_vertex_2, const godot::Vector3 &p_vertex_3, int16_t p_surface_type, uint16_t p_terrain_type, int16_t p_force, godot::real_t p_scale_factor) {
+	return {
+		p_surface_type,
+		p_force,
+		p_terrain_type,
+		{
+				{ static_cast<int32_t>(p_vertex_2.z * p_scale_factor),
+						static_cast<int32_t>(p_vertex_2.y * p_scale_factor),
+						static_cast<int32_t>(-p_vertex_2.x * p_scale_factor) },
+				{ static_cast<int32_t>(p_vertex_1.z * p_scale_factor),
+						static_cast<int32_t>(p_vertex_1.y * p_scale_factor),
+						static_cast<int32_t>(-p_vertex_1.x * p_scale_factor) },
+				{ static_cast<int32_t>(p_vertex_3.z * p_scale_factor),
+						static_cast<int32_t>(p_vertex_3.y * p_scale_factor),
+						static_cast<int32_t>(-p_vertex_3.x * p_scale_factor) },
+		},
+	};
 }
 
 void LibSM64SurfaceArray::add_triangle(const godot::Vector3 &p_vertex_1, const godot::Vector3 &p_vertex_2, const godot::Vector3 &p_vertex_3, LibSM64::SurfaceType p_surface_type, LibSM64::TerrainType p_terrain_type, int p_force) {
 	LibSM64 *libsm64 = LibSM64::get_singleton();
 	ERR_FAIL_NULL(libsm64);
-	const auto scale_factor = libsm64->get_scale_factor();
-
-	sm64_surfaces.push_back({
-			static_cast<int16_t>(p_surface_type),
-			static_cast<int16_t>(p_force),
-			static_cast<uint16_t>(p_terrain_type),
-			{
-					{ static_cast<int32_t>(p_vertex_2.z * scale_factor),
-							static_cast<int32_t>(p_vertex_2.y * scale_factor),
-							static_cast<int32_t>(-p_vertex_2.x * scale_factor) },
-					{ static_cast<int32_t>(p_vertex_1.z * scale_factor),
-							static_cast<int32_t>(p_vertex_1.y * scale_factor),
-							static_cast<int32_t>(-p_vertex_1.x * scale_factor) },
-					{ static_cast<int32_t>(p_vertex_3.z * scale_factor),
-							static_cast<int32_t>(p_vertex_3.y * scale_factor),
-							static_cast<int32_t>(-p_vertex_3.x * scale_factor) },
-			},
-	});
+	if (!match_scale_factor(libsm64->get_scale_factor())) {
+		return;
+	}
+
+	sm64_surfaces.push_back(make_sm64_surface(p_vertex_1, p_vertex_2, p_vertex_3, static_cast<int16_t>(p_surface_type), static_cast<uint16_t>(p_terrain_type), static_cast<int16_t>(p_force), scale_factor));
 }
 
 void LibSM64SurfaceArray::add_triangle_with_properties(const godot::Vector3 &p_vertex_1, const godot::Vector3 &p_vertex_2, const godot::Vector3 &p_vertex_3, const godot::Ref<LibSM64SurfaceProperties> &p_properties) {
@@ -36,8 +121,164 @@ void LibSM64SurfaceArray::add_triangle_with_properties(const godot::Vector3 &p_v
 	add_triangle(p_vertex_1, p_vertex_2, p_vertex_3, p_properties->get_surface_type(), p_properties->get_terrain_type(), p_properties->get_force());
 }
 
+void LibSM64SurfaceArray::add_faces(const godot::PackedVector3Array &p_faces, const godot::Transform3D &p_transform, const godot::Ref<LibSM64SurfaceProperties> &p_properties) {
+	ERR_FAIL_COND_MSG(p_faces.size() % 3 != 0, "Faces array size must be a multiple of 3.");
+	LibSM64 *libsm64 = LibSM64::get_singleton();
+	ERR_FAIL_NULL(libsm64);
+	if (!match_scale_factor(libsm64->get_scale_factor())) {
+		return;
+	}
+
+	int16_t surface_type = static_cast<int16_t>(LibSM64::SurfaceType::SURFACE_DEFAULT);
+	uint16_t terrain_type = static_cast<uint16_t>(LibSM64::TerrainType::TERRAIN_GRASS);
+	int16_t force = 0;
+	if (p_properties.is_valid()) {
+		surface_type = static_cast<int16_t>(p_properties->get_surface_type());
+		terrain_type = static_cast<uint16_t>(p_properties->get_terrain_type());
+		force = static_cast<int16_t>(p_properties->get_force());
+	}
+
+	const int64_t triangle_count = p_faces.size() / 3;
+	sm64_surfaces.reserve(sm64_surfaces.size() + triangle_count);
+
+	const godot::Vector3 *faces = p_faces.ptr();
+	if (p_transform == godot::Transform3D()) {
+		for (int64_t i = 0; i < triangle_count; i++) {
+			sm64_surfaces.push_back(make_sm64_surface(faces[3 * i + 0], faces[3 * i + 1], faces[3 * i + 2], surface_type, terrain_type, force, scale_factor));
+		}
+	} else {
+		for (int64_t i = 0; i < triangle_count; i++) {
+			sm64_surfaces.push_back(make_sm64_surface(p_transform.xform(faces[3 * i + 0]), p_transform.xform(faces[3 * i + 1]), p_transform.xform(faces[3 * i + 2]), surface_type, terrain_type, force, scale_factor));
+		}
+	}
+}
+
+int64_t LibSM64SurfaceArray::get_surface_count() const {
+	return static_cast<int64_t>(sm64_surfaces.size());
+}
+
+godot::real_t LibSM64SurfaceArray::get_scale_factor() const {
+	return scale_factor;
+}
+
+void LibSM64SurfaceArray::clear() {
+	sm64_surfaces.clear();
+	scale_factor = 0;
+}
+
+godot::Dictionary LibSM64SurfaceArray::optimize(godot::real_t p_weld_distance, godot::real_t p_tolerance) {
+	ERR_FAIL_COND_V(p_weld_distance < 0 || p_tolerance < 0, godot::Dictionary());
+
+	// Native SM64 data is already in SM64 units
+	const godot::real_t units = scale_factor != 0 ? scale_factor : 1;
+	SM64SurfaceOptimizeStats stats;
+	optimize_sm64_surfaces(sm64_surfaces, static_cast<int32_t>(godot::Math::round(p_weld_distance * units)), p_tolerance * units, stats);
+
+	godot::Dictionary ret;
+	ret["surfaces_before"] = stats.surfaces_before;
+	ret["surfaces_after"] = stats.surfaces_after;
+	ret["vertices_welded"] = stats.vertices_welded;
+	ret["degenerate_removed"] = stats.degenerate_removed;
+	ret["duplicates_removed"] = stats.duplicates_removed;
+	ret["merged_removed"] = stats.merged_removed;
+	return ret;
+}
+
+godot::PackedByteArray LibSM64SurfaceArray::encode_binary(bool p_compress) const {
+	godot::PackedByteArray payload;
+	payload.resize(sm64_surfaces.size() * sizeof(struct SM64Surface));
+	if (!sm64_surfaces.empty()) {
+		uint8_t *records = payload.ptrw();
+		memcpy(records, sm64_surfaces.data(), payload.size());
+
+		// Clear the padding so identical surfaces always give identical files
+		constexpr size_t padding_begin = offsetof(struct SM64Surface, terrain) + sizeof(SM64Surface::terrain);
+		constexpr size_t padding_end = offsetof(struct SM64Surface, vertices);
+		if constexpr (padding_end > padding_begin) {
+			for (size_t i = 0; i < sm64_surfaces.size(); i++) {
+				memset(records + i * sizeof(struct SM64Surface) + padding_begin, 0, padding_end - padding_begin);
+			}
+		}
+	}
+	if (p_compress) {
+		payload = payload.compress(godot::FileAccess::COMPRESSION_ZSTD);
+	}
+
+	godot::PackedByteArray ret;
+	ret.resize(BINARY_HEADER_SIZE + payload.size());
+	memcpy(ret.ptrw(), BINARY_MAGIC, sizeof(BINARY_MAGIC));
+	ret.encode_u32(8, BINARY_VERSION);
+	ret.encode_u32(12, p_compress ? BINARY_FLAG_COMPRESSED : 0);
+	ret.encode_u32(16, sizeof(struct SM64Surface));
+	ret.encode_u64(20, sm64_surfaces.size());
+	ret.encode_u64(28, payload.size());
+	ret.encode_double(36, scale_factor);
+	if (!payload.is_empty()) {
+		memcpy(ret.ptrw() + BINARY_HEADER_SIZE, payload.ptr(), payload.size());
+	}
+
+	return ret;
+}
+
+godot::Error LibSM64SurfaceArray::decode_binary(const godot::PackedByteArray &p_data) {
+	ERR_FAIL_COND_V_MSG(p_data.size() < BINARY_HEADER_SIZE, godot::ERR_FILE_CORRUPT, "[libsm64-godot] Surface array data is too small.");
+	ERR_FAIL_COND_V_MSG(memcmp(p_data.ptr(), BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0, godot::ERR_FILE_UNRECOGNIZED, "[libsm64-godot] Not a surface array.");
+	ERR_FAIL_COND_V_MSG(p_data.decode_u32(8) != BINARY_VERSION, godot::ERR_FILE_UNRECOGNIZED, "[libsm64-godot] Unsupported surface array format version.");
+	ERR_FAIL_COND_V_MSG(p_data.decode_u32(16) != sizeof(struct SM64Surface), godot::ERR_FILE_CORRUPT, "[libsm64-godot] Surface array record size mismatch.");
+
+	const uint32_t flags = p_data.decode_u32(12);
+	const uint64_t surface_count = p_data.decode_u64(20);
+	const uint64_t payload_size = p_data.decode_u64(28);
+	const double file_scale_factor = p_data.decode_double(36);
+	ERR_FAIL_COND_V_MSG(payload_size != static_cast<uint64_t>(p_data.size() - BINARY_HEADER_SIZE), godot::ERR_FILE_CORRUPT, "[libsm64-godot] Surface array payload size mismatch.");
+	ERR_FAIL_COND_V_MSG(surface_count > static_cast<uint64_t>(INT32_MAX) / sizeof(struct SM64Surface), godot::ERR_FILE_CORRUPT, "[libsm64-godot] Surface array is too large.");
+	const int64_t records_size = static_cast<int64_t>(surface_count * sizeof(struct SM64Surface));
+
+	std::vector<struct SM64Surface> surfaces(surface_count);
+	if (flags & BINARY_FLAG_COMPRESSED) {
+		const godot::PackedByteArray records = p_data.slice(BINARY_HEADER_SIZE).decompress(records_size, godot::FileAccess::COMPRESSION_ZSTD);
+		ERR_FAIL_COND_V_MSG(records.size() != records_size, godot::ERR_FILE_CORRUPT, "[libsm64-godot] Surface array decompression failed.");
+		if (records_size > 0) {
+			memcpy(surfaces.data(), records.ptr(), records_size);
+		}
+	} else {
+		ERR_FAIL_COND_V_MSG(static_cast<int64_t>(payload_size) != records_size, godot::ERR_FILE_CORRUPT, "[libsm64-godot] Surface array payload size mismatch.");
+		if (records_size > 0) {
+			memcpy(surfaces.data(), p_data.ptr() + BINARY_HEADER_SIZE, records_size);
+		}
+	}
+
+	sm64_surfaces.swap(surfaces);
+	scale_factor = static_cast<godot::real_t>(file_scale_factor);
+
+	// Keep the surfaces consistent with the current world scale
+	LibSM64 *libsm64 = LibSM64::get_singleton();
+	if (libsm64 != nullptr && file_scale_factor != 0 && libsm64->get_scale_factor() != scale_factor) {
+		rescale_surfaces(sm64_surfaces.data(), sm64_surfaces.size(), libsm64->get_scale_factor() / file_scale_factor);
+		scale_factor = libsm64->get_scale_factor();
+	}
+
+	return godot::OK;
+}
+
+void LibSM64SurfaceArray::_set_data(const godot::PackedByteArray &p_data) {
+	decode_binary(p_data);
+}
+
+godot::PackedByteArray LibSM64SurfaceArray::_get_data() const {
+	return encode_binary(false);
+}
+
 void LibSM64SurfaceArray::_bind_methods() {
-	godot::ClassDB::bind_method(godot::D_METHOD("append_surfaces", "surfaces"), &LibSM64SurfaceArray::append_surfaces);
+	godot::ClassDB::bind_method(godot::D_METHOD("append_surfaces", "surfaces", "transform"), &LibSM64SurfaceArray::append_surfaces, DEFVAL(godot::Transform3D()));
 	godot::ClassDB::bind_method(godot::D_METHOD("add_triangle", "vertex_1", "vertex_2", "vertex_3", "surface_type", "terrain_type", "force"), &LibSM64SurfaceArray::add_triangle, DEFVAL(LibSM64::SurfaceType::SURFACE_DEFAULT), DEFVAL(LibSM64::TerrainType::TERRAIN_GRASS), DEFVAL(0));
 	godot::ClassDB::bind_method(godot::D_METHOD("add_triangle_with_properties", "vertex_1", "vertex_2", "vertex_3", "properties"), &LibSM64SurfaceArray::add_triangle_with_properties);
+	godot::ClassDB::bind_method(godot::D_METHOD("add_faces", "faces", "transform", "properties"), &LibSM64SurfaceArray::add_faces, DEFVAL(godot::Transform3D()), DEFVAL(godot::Variant()));
+	godot::ClassDB::bind_method(godot::D_METHOD("get_surface_count"), &LibSM64SurfaceArray::get_surface_count);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_scale_factor"), &LibSM64SurfaceArray::get_scale_factor);
+	godot::ClassDB::bind_method(godot::D_METHOD("clear"), &LibSM64SurfaceArray::clear);
+	godot::ClassDB::bind_method(godot::D_METHOD("optimize", "weld_distance", "tolerance"), &LibSM64SurfaceArray::optimize, DEFVAL(0.0), DEFVAL(0.0));
+	godot::ClassDB::bind_method(godot::D_METHOD("_set_data", "data"), &LibSM64SurfaceArray::_set_data);
+	godot::ClassDB::bind_method(godot::D_METHOD("_get_data"), &LibSM64SurfaceArray::_get_data);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::PACKED_BYTE_ARRAY, "_data", godot::PROPERTY_HINT_NONE, "", godot::PROPERTY_USAGE_STORAGE), "_set_data", "_get_data");
 }
@@ -4,27 +4,49 @@
 #include <vector>
 
 #include <godot_cpp/classes/ref.hpp>
+#include <godot_cpp/classes/resource.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
 
 #include <libsm64_surface_properties.hpp>
 
-class LibSM64SurfaceArray : public godot::RefCounted {
-	GDCLASS(LibSM64SurfaceArray, godot::RefCounted);
+class LibSM64SurfaceArray : public godot::Resource {
+	GDCLASS(LibSM64SurfaceArray, godot::Resource);
 
 	friend class LibSM64;
+	friend class LibSM64CollisionParser;
+	friend class LibSM64SurfaceStreamer;
 
 public:
 	LibSM64SurfaceArray() = default;
 
-	void append_surfaces(const godot::Ref<LibSM64SurfaceArray> &p_surfaces);
+	void append_surfaces(const godot::Ref<LibSM64SurfaceArray> &p_surfaces, const godot::Transform3D &p_transform = godot::Transform3D());
 
 	void add_triangle(const godot::Vector3 &p_vertex_1, const godot::Vector3 &p_vertex_2, const godot::Vector3 &p_vertex_3, LibSM64::SurfaceType p_surface_type = LibSM64::SurfaceType::SURFACE_DEFAULT, LibSM64::TerrainType p_terrain_type = LibSM64::TerrainType::TERRAIN_GRASS, int p_force = 0);
 	void add_triangle_with_properties(const godot::Vector3 &p_vertex_1, const godot::Vector3 &p_vertex_2, const godot::Vector3 &p_vertex_3, const godot::Ref<LibSM64SurfaceProperties> &p_properties);
+	void add_faces(const godot::PackedVector3Array &p_faces, const godot::Transform3D &p_transform = godot::Transform3D(), const godot::Ref<LibSM64SurfaceProperties> &p_properties = godot::Ref<LibSM64SurfaceProperties>());
+
+	int64_t get_surface_count() const;
+	godot::real_t get_scale_factor() const;
+	void clear();
+
+	godot::Dictionary optimize(godot::real_t p_weld_distance = 0.0, godot::real_t p_tolerance = 0.0);
+
+	// Binary format used by the .sm64surf loader and saver, and by the _data storage property
+	godot::PackedByteArray encode_binary(bool p_compress) const;
+	godot::Error decode_binary(const godot::PackedByteArray &p_data);
 
 protected:
 	static void _bind_methods();
 
 private:
+	bool match_scale_factor(godot::real_t p_scale_factor);
+
+	void _set_data(const godot::PackedByteArray &p_data);
+	godot::PackedByteArray _get_data() const;
+
 	std::vector<struct SM64Surface> sm64_surfaces;
+	// LibSM64.scale_factor the surfaces were converted with, 0 for native SM64 data that is never rescaled
+	godot::real_t scale_factor = 0;
 };
 
 #endif // LIBSM64GD_LIBSM64SURFACEARRAY_H
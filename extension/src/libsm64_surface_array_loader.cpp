@@ -0,0 +1,36 @@
+#include <libsm64_surface_array_loader.hpp>
+
+#include <godot_cpp/classes/file_access.hpp>
+
+#include <libsm64_surface_array.hpp>
+
+godot::PackedStringArray LibSM64SurfaceArrayLoader::_get_recognized_extensions() const {
+	godot::PackedStringArray ret;
+	ret.push_back("sm64surf");
+	return ret;
+}
+
+bool LibSM64SurfaceArrayLoader::_handles_type(const godot::StringName &p_type) const {
+	return p_type == godot::StringName("LibSM64SurfaceArray");
+}
+
+godot::String LibSM64SurfaceArrayLoader::_get_resource_type(const godot::String &p_path) const {
+	return p_path.get_extension().to_lower() == "sm64surf" ? "LibSM64SurfaceArray" : "";
+}
+
+godot::Variant LibSM64SurfaceArrayLoader::_load(const godot::String &p_path, const godot::String &p_original_path, bool p_use_sub_threads, int32_t p_cache_mode) const {
+	// A single bulk read, the records are copied straight into the surface vector
+	const godot::PackedByteArray data = godot::FileAccess::get_file_as_bytes(p_path);
+	if (data.is_empty()) {
+		return godot::FileAccess::get_open_error() != godot::OK ? godot::FileAccess::get_open_error() : godot::ERR_FILE_CORRUPT;
+	}
+
+	godot::Ref<LibSM64SurfaceArray> surface_array;
+	surface_array.instantiate();
+	const godot::Error error = surface_array->decode_binary(data);
+	if (error != godot::OK) {
+		return error;
+	}
+
+	return surface_array;
+}
@@ -0,0 +1,21 @@
+#ifndef LIBSM64GD_LIBSM64SURFACEARRAYLOADER_H
+#define LIBSM64GD_LIBSM64SURFACEARRAYLOADER_H
+
+#include <godot_cpp/classes/resource_format_loader.hpp>
+
+class LibSM64SurfaceArrayLoader : public godot::ResourceFormatLoader {
+	GDCLASS(LibSM64SurfaceArrayLoader, godot::ResourceFormatLoader);
+
+public:
+	LibSM64SurfaceArrayLoader() = default;
+
+	godot::PackedStringArray _get_recognized_extensions() const override;
+	bool _handles_type(const godot::StringName &p_type) const override;
+	godot::String _get_resource_type(const godot::String &p_path) const override;
+	godot::Variant _load(const godot::String &p_path, const godot::String &p_original_path, bool p_use_sub_threads, int32_t p_cache_mode) const override;
+
+protected:
+	static void _bind_methods() {}
+};
+
+#endif // LIBSM64GD_LIBSM64SURFACEARRAYLOADER_H
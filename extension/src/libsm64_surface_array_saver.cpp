@@ -0,0 +1,31 @@
+#include <libsm64_surface_array_saver.hpp>
+
+#include <godot_cpp/classes/file_access.hpp>
+#include <godot_cpp/classes/resource_saver.hpp>
+
+#include <libsm64_surface_array.hpp>
+
+godot::Error LibSM64SurfaceArraySaver::_save(const godot::Ref<godot::Resource> &p_resource, const godot::String &p_path, uint32_t p_flags) {
+	const godot::Ref<LibSM64SurfaceArray> surface_array = p_resource;
+	ERR_FAIL_NULL_V(surface_array, godot::ERR_INVALID_PARAMETER);
+
+	const godot::PackedByteArray data = surface_array->encode_binary(p_flags & godot::ResourceSaver::FLAG_COMPRESS);
+
+	godot::Ref<godot::FileAccess> file = godot::FileAccess::open(p_path, godot::FileAccess::WRITE);
+	ERR_FAIL_NULL_V_MSG(file, godot::FileAccess::get_open_error(), "[libsm64-godot] Cannot open file '" + p_path + "' for writing.");
+	file->store_buffer(data);
+
+	return file->get_error();
+}
+
+bool LibSM64SurfaceArraySaver::_recognize(const godot::Ref<godot::Resource> &p_resource) const {
+	return godot::Object::cast_to<LibSM64SurfaceArray>(p_resource.ptr()) != nullptr;
+}
+
+godot::PackedStringArray LibSM64SurfaceArraySaver::_get_recognized_extensions(const godot::Ref<godot::Resource> &p_resource) const {
+	godot::PackedStringArray ret;
+	if (_recognize(p_resource)) {
+		ret.push_back("sm64surf");
+	}
+	return ret;
+}
@@ -0,0 +1,20 @@
+#ifndef LIBSM64GD_LIBSM64SURFACEARRAYSAVER_H
+#define LIBSM64GD_LIBSM64SURFACEARRAYSAVER_H
+
+#include <godot_cpp/classes/resource_format_saver.hpp>
+
+class LibSM64SurfaceArraySaver : public godot::ResourceFormatSaver {
+	GDCLASS(LibSM64SurfaceArraySaver, godot::ResourceFormatSaver);
+
+public:
+	LibSM64SurfaceArraySaver() = default;
+
+	godot::Error _save(const godot::Ref<godot::Resource> &p_resource, const godot::String &p_path, uint32_t p_flags) override;
+	bool _recognize(const godot::Ref<godot::Resource> &p_resource) const override;
+	godot::PackedStringArray _get_recognized_extensions(const godot::Ref<godot::Resource> &p_resource) const override;
+
+protected:
+	static void _bind_methods() {}
+};
+
+#endif // LIBSM64GD_LIBSM64SURFACEARRAYSAVER_H
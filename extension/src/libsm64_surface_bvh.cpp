@@ -0,0 +1,540 @@
+#include <libsm64_surface_bvh.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Traversal stacks are fixed size, which median splits of up to 2^32 triangles stay far below
+static constexpr int TRAVERSAL_STACK_SIZE = 256;
+
+namespace {
+
+struct Vec3 {
+	float x, y, z;
+
+	Vec3() :
+			x(0.0f), y(0.0f), z(0.0f) {}
+	Vec3(float p_x, float p_y, float p_z) :
+			x(p_x), y(p_y), z(p_z) {}
+	explicit Vec3(const float *p_arr) :
+			x(p_arr[0]), y(p_arr[1]), z(p_arr[2]) {}
+
+	Vec3 operator+(const Vec3 &p_other) const { return Vec3(x + p_other.x, y + p_other.y, z + p_other.z); }
+	Vec3 operator-(const Vec3 &p_other) const { return Vec3(x - p_other.x, y - p_other.y, z - p_other.z); }
+	Vec3 operator*(float p_scalar) const { return Vec3(x * p_scalar, y * p_scalar, z * p_scalar); }
+	float operator[](int p_axis) const { return p_axis == 0 ? x : (p_axis == 1 ? y : z); }
+
+	void store(float *r_arr) const {
+		r_arr[0] = x;
+		r_arr[1] = y;
+		r_arr[2] = z;
+	}
+};
+
+inline float dot(const Vec3 &p_a, const Vec3 &p_b) {
+	return p_a.x * p_b.x + p_a.y * p_b.y + p_a.z * p_b.z;
+}
+
+inline Vec3 cross(const Vec3 &p_a, const Vec3 &p_b) {
+	return Vec3(p_a.y * p_b.z - p_a.z * p_b.y, p_a.z * p_b.x - p_a.x * p_b.z, p_a.x * p_b.y - p_a.y * p_b.x);
+}
+
+// Closest point of triangle (a, b, c) to p (Real-Time Collision Detection, 5.1.5)
+Vec3 closest_point_on_triangle(const Vec3 &p_point, const Vec3 &p_a, const Vec3 &p_b, const Vec3 &p_c) {
+	const Vec3 ab = p_b - p_a;
+	const Vec3 ac = p_c - p_a;
+	const Vec3 ap = p_point - p_a;
+	const float d1 = dot(ab, ap);
+	const float d2 = dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) {
+		return p_a;
+	}
+
+	const Vec3 bp = p_point - p_b;
+	const float d3 = dot(ab, bp);
+	const float d4 = dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) {
+		return p_b;
+	}
+
+	const float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+		return p_a + ab * (d1 / (d1 - d3));
+	}
+
+	const Vec3 cp = p_point - p_c;
+	const float d5 = dot(ab, cp);
+	const float d6 = dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) {
+		return p_c;
+	}
+
+	const float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+		return p_a + ac * (d2 / (d2 - d6));
+	}
+
+	const float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+		return p_b + (p_c - p_b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	}
+
+	const float denominator = 1.0f / (va + vb + vc);
+	return p_a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+// Earliest fraction in [0, p_max_fraction] at which a sphere moving from p_origin along p_direction touches p_center
+bool sweep_sphere_point(const Vec3 &p_origin, const Vec3 &p_direction, const Vec3 &p_center, float p_radius, float p_max_fraction, float &r_fraction) {
+	const Vec3 m = p_origin - p_center;
+	const float a = dot(p_direction, p_direction);
+	const float b = dot(m, p_direction);
+	const float c = dot(m, m) - p_radius * p_radius;
+	const float discriminant = b * b - a * c;
+	if (a <= 0.0f || discriminant < 0.0f) {
+		return false;
+	}
+
+	const float fraction = (-b - std::sqrt(discriminant)) / a;
+	if (fraction < 0.0f || fraction > p_max_fraction) {
+		return false;
+	}
+	r_fraction = fraction;
+	return true;
+}
+
+// Same as sweep_sphere_point against the segment (p_a, p_b), ignoring its end points
+bool sweep_sphere_segment(const Vec3 &p_origin, const Vec3 &p_direction, const Vec3 &p_a, const Vec3 &p_b, float p_radius, float p_max_fraction, float &r_fraction) {
+	const Vec3 axis = p_b - p_a;
+	const float axis_length_squared = dot(axis, axis);
+	if (axis_length_squared <= 0.0f) {
+		return false;
+	}
+
+	// Distance to the infinite line through the segment, then clamped to the segment
+	const Vec3 m = p_origin - p_a;
+	const Vec3 direction_perpendicular = p_direction - axis * (dot(p_direction, axis) / axis_length_squared);
+	const Vec3 m_perpendicular = m - axis * (dot(m, axis) / axis_length_squared);
+	const float a = dot(direction_perpendicular, direction_perpendicular);
+	const float b = dot(m_perpendicular, direction_perpendicular);
+	const float c = dot(m_perpendicular, m_perpendicular) - p_radius * p_radius;
+	const float discriminant = b * b - a * c;
+	if (a <= 0.0f || discriminant < 0.0f) {
+		return false;
+	}
+
+	const float fraction = (-b - std::sqrt(discriminant)) / a;
+	if (fraction < 0.0f || fraction > p_max_fraction) {
+		return false;
+	}
+	const float segment_t = dot(m + p_direction * fraction, axis) / axis_length_squared;
+	if (segment_t < 0.0f || segment_t > 1.0f) {
+		return false;
+	}
+	r_fraction = fraction;
+	return true;
+}
+
+// Insertion sort of up to 4 lane indices by descending key
+void sort_lanes_descending(int *r_lanes, int p_count, const float *p_keys) {
+	for (int i = 1; i < p_count; i++) {
+		const int lane = r_lanes[i];
+		int j = i - 1;
+		while (j >= 0 && p_keys[r_lanes[j]] < p_keys[lane]) {
+			r_lanes[j + 1] = r_lanes[j];
+			j--;
+		}
+		r_lanes[j + 1] = lane;
+	}
+}
+
+} // namespace
+
+void SM64SurfaceBVH::build(const std::vector<struct SM64Surface> &p_surfaces) {
+	nodes.clear();
+	triangles.clear();
+
+	std::vector<BuildItem> items;
+	items.reserve(p_surfaces.size());
+	for (uint32_t i = 0; i < p_surfaces.size(); i++) {
+		const auto &vertices = p_surfaces[i].vertices;
+		const Vec3 a(static_cast<float>(vertices[0][0]), static_cast<float>(vertices[0][1]), static_cast<float>(vertices[0][2]));
+		const Vec3 b(static_cast<float>(vertices[1][0]), static_cast<float>(vertices[1][1]), static_cast<float>(vertices[1][2]));
+		const Vec3 c(static_cast<float>(vertices[2][0]), static_cast<float>(vertices[2][1]), static_cast<float>(vertices[2][2]));
+		// Degenerate triangles can't be hit and have no normal
+		const Vec3 normal = cross(b - a, c - a);
+		if (dot(normal, normal) <= 0.0f) {
+			continue;
+		}
+
+		BuildItem item; // NOLINT(cppcoreguidelines-pro-type-member-init)
+		for (int axis = 0; axis < 3; axis++) {
+			item.bounds_min[axis] = std::min({ a[axis], b[axis], c[axis] });
+			item.bounds_max[axis] = std::max({ a[axis], b[axis], c[axis] });
+			item.centroid[axis] = (a[axis] + b[axis] + c[axis]) / 3.0f;
+		}
+		item.surface_index = i;
+		items.push_back(item);
+	}
+
+	if (items.empty()) {
+		return;
+	}
+
+	triangles.reserve(items.size());
+	build_node(items, 0, items.size(), p_surfaces);
+}
+
+bool SM64SurfaceBVH::is_empty() const {
+	return nodes.empty();
+}
+
+int32_t SM64SurfaceBVH::build_node(std::vector<BuildItem> &r_items, size_t p_begin, size_t p_end, const std::vector<struct SM64Surface> &p_surfaces) {
+	const int32_t node_index = static_cast<int32_t>(nodes.size());
+	nodes.emplace_back();
+
+	// Split the range in two at the centroid median of its longest axis, then split the halves again
+	size_t ranges[4][2] = { { p_begin, p_end } };
+	int range_count = 1;
+	while (range_count < 4) {
+		int largest = -1;
+		for (int i = 0; i < range_count; i++) {
+			const size_t size = ranges[i][1] - ranges[i][0];
+			if (size > LEAF_SIZE && (largest < 0 || size > ranges[largest][1] - ranges[largest][0])) {
+				largest = i;
+			}
+		}
+		if (largest < 0) {
+			break;
+		}
+
+		const size_t begin = ranges[largest][0];
+		const size_t end = ranges[largest][1];
+		float centroid_min[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+		float centroid_max[3] = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+		for (size_t i = begin; i < end; i++) {
+			for (int axis = 0; axis < 3; axis++) {
+				centroid_min[axis] = std::min(centroid_min[axis], r_items[i].centroid[axis]);
+				centroid_max[axis] = std::max(centroid_max[axis], r_items[i].centroid[axis]);
+			}
+		}
+		int split_axis = 0;
+		for (int axis = 1; axis < 3; axis++) {
+			if (centroid_max[axis] - centroid_min[axis] > centroid_max[split_axis] - centroid_min[split_axis]) {
+				split_axis = axis;
+			}
+		}
+
+		const size_t middle = begin + (end - begin) / 2;
+		std::nth_element(r_items.begin() + begin, r_items.begin() + middle, r_items.begin() + end, [split_axis](const BuildItem &p_a, const BuildItem &p_b) {
+			return p_a.centroid[split_axis] < p_b.centroid[split_axis];
+		});
+
+		ranges[largest][1] = middle;
+		ranges[range_count][0] = middle;
+		ranges[range_count][1] = end;
+		range_count++;
+	}
+
+	for (int child = 0; child < 4; child++) {
+		if (child < range_count) {
+			set_child(node_index, child, r_items, ranges[child][0], ranges[child][1], p_surfaces);
+		} else {
+			// Empty slots get inverted bounds so they never pass the box tests
+			Node &node = nodes[node_index];
+			for (int axis = 0; axis < 3; axis++) {
+				node.bounds_min[axis][child] = std::numeric_limits<float>::max();
+				node.bounds_max[axis][child] = std::numeric_limits<float>::lowest();
+			}
+			node.children[child] = -1;
+			node.counts[child] = 0;
+		}
+	}
+
+	return node_index;
+}
+
+void SM64SurfaceBVH::set_child(int32_t p_node, int p_child, std::vector<BuildItem> &r_items, size_t p_begin, size_t p_end, const std::vector<struct SM64Surface> &p_surfaces) {
+	float bounds_min[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+	float bounds_max[3] = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+	for (size_t i = p_begin; i < p_end; i++) {
+		for (int axis = 0; axis < 3; axis++) {
+			bounds_min[axis] = std::min(bounds_min[axis], r_items[i].bounds_min[axis]);
+			bounds_max[axis] = std::max(bounds_max[axis], r_items[i].bounds_max[axis]);
+		}
+	}
+
+	int32_t child_index;
+	uint8_t count = 0;
+	if (p_end - p_begin <= LEAF_SIZE) {
+		child_index = static_cast<int32_t>(triangles.size());
+		count = static_cast<uint8_t>(p_end - p_begin);
+		for (size_t i = p_begin; i < p_end; i++) {
+			const auto &vertices = p_surfaces[r_items[i].surface_index].vertices;
+			const Vec3 a(static_cast<float>(vertices[0][0]), static_cast<float>(vertices[0][1]), static_cast<float>(vertices[0][2]));
+			const Vec3 b(static_cast<float>(vertices[1][0]), static_cast<float>(vertices[1][1]), static_cast<float>(vertices[1][2]));
+			const Vec3 c(static_cast<float>(vertices[2][0]), static_cast<float>(vertices[2][1]), static_cast<float>(vertices[2][2]));
+			const Vec3 normal = cross(b - a, c - a);
+
+			Triangle triangle; // NOLINT(cppcoreguidelines-pro-type-member-init)
+			a.store(triangle.vertex);
+			(b - a).store(triangle.edge_1);
+			(c - a).store(triangle.edge_2);
+			(normal * (1.0f / std::sqrt(dot(normal, normal)))).store(triangle.normal);
+			triangle.surface_index = r_items[i].surface_index;
+			triangles.push_back(triangle);
+		}
+	} else {
+		// nodes may grow while building the child, so the parent is only looked up afterwards
+		child_index = build_node(r_items, p_begin, p_end, p_surfaces);
+	}
+
+	Node &node = nodes[p_node];
+	for (int axis = 0; axis < 3; axis++) {
+		node.bounds_min[axis][p_child] = bounds_min[axis];
+		node.bounds_max[axis][p_child] = bounds_max[axis];
+	}
+	node.children[p_child] = child_index;
+	node.counts[p_child] = count;
+}
+
+bool SM64SurfaceBVH::cast(const float *p_from, const float *p_to, float p_radius, SM64SurfaceHit &r_hit) const {
+	if (nodes.empty()) {
+		return false;
+	}
+
+	const Vec3 origin(p_from);
+	const Vec3 direction = Vec3(p_to) - origin;
+	float inverse_direction[3];
+	for (int axis = 0; axis < 3; axis++) {
+		const float component = direction[axis];
+		inverse_direction[axis] = std::fabs(component) > 1e-12f ? 1.0f / component : std::copysign(1e30f, component);
+	}
+	const float origin_arr[3] = { origin.x, origin.y, origin.z };
+
+	float best_fraction = r_hit.fraction;
+	const Triangle *best_triangle = nullptr;
+	Vec3 best_position;
+
+	struct StackEntry {
+		int32_t node;
+		float fraction;
+	};
+	StackEntry stack[TRAVERSAL_STACK_SIZE]; // NOLINT(cppcoreguidelines-pro-type-member-init)
+	int stack_size = 0;
+	stack[stack_size++] = { 0, 0.0f };
+
+	while (stack_size > 0) {
+		const StackEntry entry = stack[--stack_size];
+		if (entry.fraction > best_fraction) {
+			continue;
+		}
+		const Node &node = nodes[entry.node];
+
+		// Slab test of the 4 children at once, with the boxes grown by the sphere radius
+		float near[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float far[4] = { best_fraction, best_fraction, best_fraction, best_fraction };
+		for (int axis = 0; axis < 3; axis++) {
+			for (int lane = 0; lane < 4; lane++) {
+				const float t1 = (node.bounds_min[axis][lane] - p_radius - origin_arr[axis]) * inverse_direction[axis];
+				const float t2 = (node.bounds_max[axis][lane] + p_radius - origin_arr[axis]) * inverse_direction[axis];
+				near[lane] = std::max(near[lane], std::min(t1, t2));
+				far[lane] = std::min(far[lane], std::max(t1, t2));
+			}
+		}
+
+		// Inner children are pushed farthest first, so the nearest is visited next
+		int order[4];
+		int order_count = 0;
+		for (int lane = 0; lane < 4; lane++) {
+			if (node.children[lane] >= 0 && near[lane] <= far[lane]) {
+				order[order_count++] = lane;
+			}
+		}
+		sort_lanes_descending(order, order_count, near);
+
+		for (int i = 0; i < order_count; i++) {
+			const int lane = order[i];
+			if (node.counts[lane] == 0) {
+				if (stack_size < TRAVERSAL_STACK_SIZE) {
+					stack[stack_size++] = { node.children[lane], near[lane] };
+				}
+				continue;
+			}
+
+			for (int j = 0; j < node.counts[lane]; j++) {
+				const Triangle &triangle = triangles[node.children[lane] + j];
+				const Vec3 vertex(triangle.vertex);
+				const Vec3 edge_1(triangle.edge_1);
+				const Vec3 edge_2(triangle.edge_2);
+
+				if (p_radius <= 0.0f) {
+					// Möller-Trumbore, both faces are hit
+					const Vec3 p = cross(direction, edge_2);
+					const float determinant = dot(edge_1, p);
+					if (std::fabs(determinant) < 1e-12f) {
+						continue;
+					}
+					const float inverse_determinant = 1.0f / determinant;
+					const Vec3 s = origin - vertex;
+					const float u = dot(s, p) * inverse_determinant;
+					if (u < 0.0f || u > 1.0f) {
+						continue;
+					}
+					const Vec3 q = cross(s, edge_1);
+					const float v = dot(direction, q) * inverse_determinant;
+					if (v < 0.0f || u + v > 1.0f) {
+						continue;
+					}
+					const float fraction = dot(edge_2, q) * inverse_determinant;
+					if (fraction < 0.0f || fraction > best_fraction) {
+						continue;
+					}
+					best_fraction = fraction;
+					best_triangle = &triangle;
+					best_position = origin + direction * fraction;
+					continue;
+				}
+
+				const Vec3 a = vertex;
+				const Vec3 b = vertex + edge_1;
+				const Vec3 c = vertex + edge_2;
+
+				// Already touching at the start
+				const Vec3 closest = closest_point_on_triangle(origin, a, b, c);
+				if (dot(origin - closest, origin - closest) <= p_radius * p_radius) {
+					best_fraction = 0.0f;
+					best_triangle = &triangle;
+					best_position = origin;
+					continue;
+				}
+
+				// A hit inside the face comes before any hit on its edges, which are still checked since the
+				// contact is only tested against the triangle with some tolerance
+				const Vec3 normal(triangle.normal);
+				const float start_distance = dot(origin - a, normal);
+				const float direction_normal = dot(direction, normal);
+				if (std::fabs(start_distance) > p_radius && start_distance * direction_normal < 0.0f) {
+					const float side = start_distance > 0.0f ? 1.0f : -1.0f;
+					const float fraction = (side * p_radius - start_distance) / direction_normal;
+					if (fraction >= 0.0f && fraction <= best_fraction) {
+						const Vec3 center = origin + direction * fraction;
+						const Vec3 contact = center - normal * (side * p_radius);
+						const Vec3 contact_closest = closest_point_on_triangle(contact, a, b, c);
+						if (dot(contact - contact_closest, contact - contact_closest) <= 1e-4f * p_radius * p_radius) {
+							best_fraction = fraction;
+							best_triangle = &triangle;
+							best_position = center;
+						}
+					}
+				}
+
+				float fraction;
+				const Vec3 corners[3] = { a, b, c };
+				for (int k = 0; k < 3; k++) {
+					if (sweep_sphere_point(origin, direction, corners[k], p_radius, best_fraction, fraction)) {
+						best_fraction = fraction;
+						best_triangle = &triangle;
+						best_position = origin + direction * fraction;
+					}
+					if (sweep_sphere_segment(origin, direction, corners[k], corners[(k + 1) % 3], p_radius, best_fraction, fraction)) {
+						best_fraction = fraction;
+						best_triangle = &triangle;
+						best_position = origin + direction * fraction;
+					}
+				}
+			}
+		}
+	}
+
+	if (best_triangle == nullptr) {
+		return false;
+	}
+
+	r_hit.fraction = best_fraction;
+	best_position.store(r_hit.position);
+	for (int axis = 0; axis < 3; axis++) {
+		r_hit.normal[axis] = best_triangle->normal[axis];
+	}
+	r_hit.distance = best_fraction * std::sqrt(dot(direction, direction));
+	r_hit.surface_index = best_triangle->surface_index;
+	return true;
+}
+
+bool SM64SurfaceBVH::closest_point(const float *p_position, SM64SurfaceHit &r_hit) const {
+	if (nodes.empty()) {
+		return false;
+	}
+
+	const Vec3 position(p_position);
+	float best_distance_squared = r_hit.distance * r_hit.distance;
+	const Triangle *best_triangle = nullptr;
+	Vec3 best_position;
+
+	struct StackEntry {
+		int32_t node;
+		float distance_squared;
+	};
+	StackEntry stack[TRAVERSAL_STACK_SIZE]; // NOLINT(cppcoreguidelines-pro-type-member-init)
+	int stack_size = 0;
+	stack[stack_size++] = { 0, 0.0f };
+
+	while (stack_size > 0) {
+		const StackEntry entry = stack[--stack_size];
+		if (entry.distance_squared > best_distance_squared) {
+			continue;
+		}
+		const Node &node = nodes[entry.node];
+
+		float distance_squared[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int axis = 0; axis < 3; axis++) {
+			for (int lane = 0; lane < 4; lane++) {
+				const float outside = std::max({ node.bounds_min[axis][lane] - position[axis], 0.0f, position[axis] - node.bounds_max[axis][lane] });
+				distance_squared[lane] += outside * outside;
+			}
+		}
+
+		int order[4];
+		int order_count = 0;
+		for (int lane = 0; lane < 4; lane++) {
+			if (node.children[lane] >= 0 && distance_squared[lane] <= best_distance_squared) {
+				order[order_count++] = lane;
+			}
+		}
+		sort_lanes_descending(order, order_count, distance_squared);
+
+		for (int i = 0; i < order_count; i++) {
+			const int lane = order[i];
+			if (node.counts[lane] == 0) {
+				if (stack_size < TRAVERSAL_STACK_SIZE) {
+					stack[stack_size++] = { node.children[lane], distance_squared[lane] };
+				}
+				continue;
+			}
+
+			for (int j = 0; j < node.counts[lane]; j++) {
+				const Triangle &triangle = triangles[node.children[lane] + j];
+				const Vec3 a(triangle.vertex);
+				const Vec3 closest = closest_point_on_triangle(position, a, a + Vec3(triangle.edge_1), a + Vec3(triangle.edge_2));
+				const float triangle_distance_squared = dot(position - closest, position - closest);
+				if (triangle_distance_squared <= best_distance_squared) {
+					best_distance_squared = triangle_distance_squared;
+					best_triangle = &triangle;
+					best_position = closest;
+				}
+			}
+		}
+	}
+
+	if (best_triangle == nullptr) {
+		return false;
+	}
+
+	r_hit.fraction = 0.0f;
+	best_position.store(r_hit.position);
+	for (int axis = 0; axis < 3; axis++) {
+		r_hit.normal[axis] = best_triangle->normal[axis];
+	}
+	r_hit.distance = std::sqrt(best_distance_squared);
+	r_hit.surface_index = best_triangle->surface_index;
+	return true;
+}
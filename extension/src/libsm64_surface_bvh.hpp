@@ -0,0 +1,71 @@
+#ifndef LIBSM64GD_LIBSM64SURFACEBVH_H
+#define LIBSM64GD_LIBSM64SURFACEBVH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <libsm64.h>
+
+// Bounding volume hierarchy over SM64Surface records for ray, swept sphere and closest point queries,
+// all positions and distances in SM64 units.
+// Nodes have 4 children whose bounds are stored per axis in arrays of 4 floats, so a node's children
+// are tested together in loops the compiler can vectorize.
+
+struct SM64SurfaceHit {
+	// Fraction of the cast where the hit happened, in [0, 1]
+	float fraction = 1.0f;
+	// Hit point for ray casts and closest points, center of the sphere at the hit for sphere casts
+	float position[3] = { 0.0f, 0.0f, 0.0f };
+	float normal[3] = { 0.0f, 0.0f, 0.0f };
+	float distance = 0.0f;
+	uint32_t surface_index = 0;
+};
+
+class SM64SurfaceBVH {
+public:
+	void build(const std::vector<struct SM64Surface> &p_surfaces);
+	bool is_empty() const;
+
+	// Casts a sphere of p_radius (a ray when 0) from p_from to p_to. r_hit.fraction is read as the
+	// farthest fraction to look at and only overwritten by a closer hit.
+	bool cast(const float *p_from, const float *p_to, float p_radius, SM64SurfaceHit &r_hit) const;
+	// Finds the closest point to p_position. r_hit.distance is read as the maximum distance to look at
+	// and only overwritten by a closer point.
+	bool closest_point(const float *p_position, SM64SurfaceHit &r_hit) const;
+
+private:
+	static constexpr int LEAF_SIZE = 4;
+
+	struct Node {
+		float bounds_min[3][4];
+		float bounds_max[3][4];
+		// Node index for inner children, first triangle for leaves, -1 for empty slots
+		int32_t children[4];
+		// Number of triangles of leaves, 0 for inner children
+		uint8_t counts[4];
+	};
+
+	struct Triangle {
+		float vertex[3];
+		float edge_1[3];
+		float edge_2[3];
+		float normal[3];
+		uint32_t surface_index;
+	};
+
+	struct BuildItem {
+		float bounds_min[3];
+		float bounds_max[3];
+		float centroid[3];
+		uint32_t surface_index;
+	};
+
+	int32_t build_node(std::vector<BuildItem> &r_items, size_t p_begin, size_t p_end, const std::vector<struct SM64Surface> &p_surfaces);
+	void set_child(int32_t p_node, int p_child, std::vector<BuildItem> &r_items, size_t p_begin, size_t p_end, const std::vector<struct SM64Surface> &p_surfaces);
+
+	std::vector<Node> nodes;
+	std::vector<Triangle> triangles;
+};
+
+#endif // LIBSM64GD_LIBSM64SURFACEBVH_H
@@ -0,0 +1,139 @@
+#include <libsm64_surface_object.hpp>
+
+#include <godot_cpp/classes/engine.hpp>
+
+#include <libsm64.hpp>
+#include <libsm64_face_extractor.hpp>
+
+// Same metadata as LibSM64SurfaceHandlerBase.BAKED_SURFACES_META, written by the surfaces export plugin
+static const char BAKED_SURFACES_META[] = "libsm64_baked_surfaces";
+
+void LibSM64SurfaceObject::set_surfaces(const godot::Ref<LibSM64SurfaceArray> &p_value) {
+	surfaces = p_value;
+}
+
+godot::Ref<LibSM64SurfaceArray> LibSM64SurfaceObject::get_surfaces() const {
+	return surfaces;
+}
+
+void LibSM64SurfaceObject::set_surface_properties(const godot::Ref<LibSM64SurfaceProperties> &p_value) {
+	surface_properties = p_value;
+}
+
+godot::Ref<LibSM64SurfaceProperties> LibSM64SurfaceObject::get_surface_properties() const {
+	return surface_properties;
+}
+
+void LibSM64SurfaceObject::set_auto_create(bool p_value) {
+	auto_create = p_value;
+}
+
+bool LibSM64SurfaceObject::get_auto_create() const {
+	return auto_create;
+}
+
+void LibSM64SurfaceObject::create_surface_object() {
+	ERR_FAIL_COND_MSG(has_surface_object(), "[libsm64-godot] The surface object was already created.");
+	ERR_FAIL_COND(!is_inside_tree());
+	LibSM64 *libsm64 = LibSM64::get_singleton();
+	ERR_FAIL_NULL(libsm64);
+	ERR_FAIL_COND_MSG(!libsm64->is_initialized(), "[libsm64-godot] libsm64 must be initialized before creating surface objects.");
+
+	// Surface objects only have a position and a rotation, the rest of the global basis (i.e. the scale) is baked into the surfaces
+	const godot::Transform3D transform = get_global_transform();
+	const godot::Quaternion rotation = transform.basis.get_rotation_quaternion();
+	const godot::Basis scale_basis = godot::Basis(rotation).transposed() * transform.basis;
+
+	godot::Ref<LibSM64SurfaceArray> object_surfaces;
+	if (surfaces.is_null()) {
+		object_surfaces = build_parent_surfaces(scale_basis);
+	} else if (scale_basis.is_equal_approx(godot::Basis())) {
+		object_surfaces = surfaces;
+	} else {
+		object_surfaces.instantiate();
+		object_surfaces->append_surfaces(surfaces, godot::Transform3D(scale_basis, godot::Vector3()));
+	}
+	ERR_FAIL_COND_MSG(object_surfaces.is_null() || object_surfaces->get_surface_count() == 0, godot::vformat("[libsm64-godot] %s has no surfaces.", get_path()));
+
+	object_id = libsm64->surface_object_create(transform.origin, rotation, object_surfaces);
+	object_init_generation = libsm64->get_init_generation();
+}
+
+void LibSM64SurfaceObject::delete_surface_object() {
+	if (has_surface_object()) {
+		LibSM64::get_singleton()->surface_object_delete(object_id);
+	}
+	object_id = -1;
+}
+
+int LibSM64SurfaceObject::get_object_id() const {
+	return has_surface_object() ? object_id : -1;
+}
+
+void LibSM64SurfaceObject::_notification(int p_what) {
+	if (godot::Engine::get_singleton()->is_editor_hint()) {
+		return;
+	}
+
+	switch (p_what) {
+		case NOTIFICATION_ENTER_TREE: {
+			set_notify_transform(true);
+			if (auto_create && LibSM64::get_singleton() != nullptr && LibSM64::get_singleton()->is_initialized()) {
+				create_surface_object();
+			}
+		} break;
+		case NOTIFICATION_EXIT_TREE: {
+			set_notify_transform(false);
+			delete_surface_object();
+		} break;
+		case NOTIFICATION_TRANSFORM_CHANGED: {
+			// Only queued, the move is applied once before the next tick no matter how often the node moves
+			if (has_surface_object()) {
+				LibSM64::get_singleton()->surface_object_queue_move(object_id, get_global_transform());
+			}
+		} break;
+	}
+}
+
+godot::Ref<LibSM64SurfaceArray> LibSM64SurfaceObject::build_parent_surfaces(const godot::Basis &p_scale_basis) const {
+	godot::Node3D *parent = Object::cast_to<godot::Node3D>(get_parent());
+	ERR_FAIL_NULL_V_MSG(parent, godot::Ref<LibSM64SurfaceArray>(), "[libsm64-godot] Without surfaces, LibSM64SurfaceObject builds them from its parent, which must be a Node3D.");
+
+	// Parent surfaces are in the parent's space, the surface object follows this node without its scale
+	const godot::Transform3D parent_to_local = godot::Transform3D(p_scale_basis, godot::Vector3()) * get_transform().affine_inverse();
+
+	godot::Ref<LibSM64SurfaceArray> object_surfaces;
+	object_surfaces.instantiate();
+
+	const godot::Ref<LibSM64SurfaceArray> baked_surfaces = parent->get_meta(BAKED_SURFACES_META, godot::Variant());
+	if (baked_surfaces.is_valid()) {
+		object_surfaces->append_surfaces(baked_surfaces, parent_to_local);
+		return object_surfaces;
+	}
+
+	godot::Ref<LibSM64FaceExtractor> face_extractor;
+	face_extractor.instantiate();
+	face_extractor->add_node_faces(object_surfaces, parent, parent_to_local, surface_properties);
+	return object_surfaces;
+}
+
+bool LibSM64SurfaceObject::has_surface_object() const {
+	const LibSM64 *libsm64 = LibSM64::get_singleton();
+	return object_id >= 0 && libsm64 != nullptr && libsm64->is_initialized() && libsm64->get_init_generation() == object_init_generation;
+}
+
+void LibSM64SurfaceObject::_bind_methods() {
+	godot::ClassDB::bind_method(godot::D_METHOD("set_surfaces", "value"), &LibSM64SurfaceObject::set_surfaces);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_surfaces"), &LibSM64SurfaceObject::get_surfaces);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::OBJECT, "surfaces", godot::PROPERTY_HINT_RESOURCE_TYPE, "LibSM64SurfaceArray"), "set_surfaces", "get_surfaces");
+	godot::ClassDB::bind_method(godot::D_METHOD("set_surface_properties", "value"), &LibSM64SurfaceObject::set_surface_properties);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_surface_properties"), &LibSM64SurfaceObject::get_surface_properties);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::OBJECT, "surface_properties", godot::PROPERTY_HINT_RESOURCE_TYPE, "LibSM64SurfaceProperties"), "set_surface_properties", "get_surface_properties");
+	godot::ClassDB::bind_method(godot::D_METHOD("set_auto_create", "value"), &LibSM64SurfaceObject::set_auto_create);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_auto_create"), &LibSM64SurfaceObject::get_auto_create);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::BOOL, "auto_create"), "set_auto_create", "get_auto_create");
+
+	godot::ClassDB::bind_method(godot::D_METHOD("create_surface_object"), &LibSM64SurfaceObject::create_surface_object);
+	godot::ClassDB::bind_method(godot::D_METHOD("delete_surface_object"), &LibSM64SurfaceObject::delete_surface_object);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_object_id"), &LibSM64SurfaceObject::get_object_id);
+}
@@ -0,0 +1,48 @@
+#ifndef LIBSM64GD_LIBSM64SURFACEOBJECT_H
+#define LIBSM64GD_LIBSM64SURFACEOBJECT_H
+
+#include <cstdint>
+
+#include <godot_cpp/classes/node3d.hpp>
+#include <godot_cpp/classes/ref.hpp>
+
+#include <libsm64_surface_array.hpp>
+#include <libsm64_surface_properties.hpp>
+
+class LibSM64SurfaceObject : public godot::Node3D {
+	GDCLASS(LibSM64SurfaceObject, godot::Node3D);
+
+public:
+	LibSM64SurfaceObject() = default;
+
+	void set_surfaces(const godot::Ref<LibSM64SurfaceArray> &p_value);
+	godot::Ref<LibSM64SurfaceArray> get_surfaces() const;
+
+	void set_surface_properties(const godot::Ref<LibSM64SurfaceProperties> &p_value);
+	godot::Ref<LibSM64SurfaceProperties> get_surface_properties() const;
+
+	void set_auto_create(bool p_value);
+	bool get_auto_create() const;
+
+	void create_surface_object();
+	void delete_surface_object();
+	int get_object_id() const;
+
+protected:
+	void _notification(int p_what);
+	static void _bind_methods();
+
+private:
+	godot::Ref<LibSM64SurfaceArray> build_parent_surfaces(const godot::Basis &p_scale_basis) const;
+	bool has_surface_object() const;
+
+	godot::Ref<LibSM64SurfaceArray> surfaces;
+	godot::Ref<LibSM64SurfaceProperties> surface_properties;
+	bool auto_create = true;
+
+	int object_id = -1;
+	// libsm64 initialization the object was created in, its ID is meaningless after a global_terminate
+	uint64_t object_init_generation = 0;
+};
+
+#endif // LIBSM64GD_LIBSM64SURFACEOBJECT_H
@@ -0,0 +1,242 @@
+#include <libsm64_surface_object_queue.hpp>
+
+#include <godot_cpp/classes/time.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
+#include <godot_cpp/core/object.hpp>
+
+#include <libsm64.hpp>
+
+LibSM64SurfaceObjectQueue::LibSM64SurfaceObjectQueue() {
+	face_extractor.instantiate();
+}
+
+LibSM64SurfaceObjectQueue::~LibSM64SurfaceObjectQueue() {
+	cancel();
+}
+
+void LibSM64SurfaceObjectQueue::set_face_extractor(const godot::Ref<LibSM64FaceExtractor> &p_value) {
+	ERR_FAIL_NULL(p_value);
+	face_extractor = p_value;
+}
+
+godot::Ref<LibSM64FaceExtractor> LibSM64SurfaceObjectQueue::get_face_extractor() const {
+	return face_extractor;
+}
+
+void LibSM64SurfaceObjectQueue::set_template_cache(const godot::Ref<LibSM64SurfaceTemplateCache> &p_value) {
+	template_cache = p_value;
+}
+
+godot::Ref<LibSM64SurfaceTemplateCache> LibSM64SurfaceObjectQueue::get_template_cache() const {
+	return template_cache;
+}
+
+void LibSM64SurfaceObjectQueue::set_budget_msec(double p_value) {
+	ERR_FAIL_COND(p_value < 0.0);
+	budget_msec = p_value;
+}
+
+double LibSM64SurfaceObjectQueue::get_budget_msec() const {
+	return budget_msec;
+}
+
+void LibSM64SurfaceObjectQueue::queue_node(godot::Node3D *p_node, const godot::Ref<LibSM64SurfaceProperties> &p_properties, const godot::Ref<LibSM64SurfaceArray> &p_surfaces) {
+	ERR_FAIL_NULL(p_node);
+
+	Entry &entry = entries.emplace_back();
+	entry.node_id = p_node->get_instance_id();
+	entry.snapshot.properties = p_properties;
+	entry.surfaces = p_surfaces;
+}
+
+int LibSM64SurfaceObjectQueue::process() {
+	if (entries.empty()) {
+		return 0;
+	}
+
+	LibSM64 *libsm64 = LibSM64::get_singleton();
+	ERR_FAIL_NULL_V(libsm64, 0);
+	ERR_FAIL_COND_V_MSG(!libsm64->is_initialized(), 0, "[libsm64-godot] libsm64 must be initialized before creating surface objects.");
+
+	const godot::Time *time = godot::Time::get_singleton();
+	const uint64_t start_usec = time->get_ticks_usec();
+	const uint64_t budget_usec = static_cast<uint64_t>(budget_msec * 1000.0);
+	// At least one step is done per call, so a tiny budget still makes progress
+	bool stepped = false;
+	auto has_budget = [&]() {
+		return !stepped || time->get_ticks_usec() - start_usec < budget_usec;
+	};
+
+	int created_count = 0;
+
+	// Objects whose conversion finished are created first, they only cost the libsm64 call
+	for (auto it = entries.begin(); it != entries.end() && has_budget();) {
+		if (!is_entry_built(*it)) {
+			++it;
+			continue;
+		}
+		created_count += create_entry_object(*it);
+		it = entries.erase(it);
+		stepped = true;
+	}
+
+	// Then conversions are started, snapshots are taken here and shapes are tessellated on workers
+	for (auto it = entries.begin(); it != entries.end() && has_budget();) {
+		if (it->surfaces.is_valid()) {
+			++it;
+			continue;
+		}
+		start_entry(*it);
+		stepped = true;
+
+		if (is_entry_built(*it)) {
+			// Converted on this thread or found in the template cache, create it right away
+			created_count += create_entry_object(*it);
+			it = entries.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	if (entries.empty()) {
+		emit_signal("finished");
+	}
+
+	return created_count;
+}
+
+void LibSM64SurfaceObjectQueue::cancel() {
+	godot::WorkerThreadPool *worker_thread_pool = godot::WorkerThreadPool::get_singleton();
+	for (auto &entry : entries) {
+		if (entry.task_id >= 0 && worker_thread_pool != nullptr) {
+			worker_thread_pool->wait_for_task_completion(entry.task_id);
+		}
+	}
+	entries.clear();
+	pending_templates.clear();
+}
+
+int LibSM64SurfaceObjectQueue::get_pending_count() const {
+	return static_cast<int>(entries.size());
+}
+
+void LibSM64SurfaceObjectQueue::build_entry_task(void *p_userdata) {
+	Entry *entry = static_cast<Entry *>(p_userdata);
+	entry->face_extractor->build_snapshot(entry->snapshot);
+}
+
+void LibSM64SurfaceObjectQueue::start_entry(Entry &r_entry) {
+	r_entry.face_extractor = face_extractor;
+	r_entry.surfaces.instantiate();
+
+	godot::Node3D *node = godot::Object::cast_to<godot::Node3D>(godot::ObjectDB::get_instance(r_entry.node_id));
+	if (node == nullptr) {
+		// Freed while queued, nothing to convert
+		return;
+	}
+
+	if (template_cache.is_valid() && template_cache->make_key(node, r_entry.snapshot.properties, r_entry.template_key, r_entry.template_sources)) {
+		godot::Ref<LibSM64SurfaceArray> surfaces = template_cache->find_template(r_entry.template_key);
+		if (surfaces.is_valid()) {
+			r_entry.surfaces = surfaces;
+			return;
+		}
+
+		auto it = pending_templates.find(r_entry.template_key);
+		if (it != pending_templates.end()) {
+			// Another entry is converting the same template, its surfaces are used once built
+			r_entry.surfaces = it->second->surfaces;
+			r_entry.shares_template = true;
+			return;
+		}
+
+		// Converted like LibSM64SurfaceTemplateCache.get_node_surfaces() would, and added to it once built
+		r_entry.template_cache = template_cache;
+		r_entry.template_clear_count = template_cache->clear_count;
+		r_entry.face_extractor = template_cache->face_extractor;
+		pending_templates.emplace(r_entry.template_key, &r_entry);
+	}
+
+	// Surfaces are built in the node's local space, the object is placed when created
+	r_entry.snapshot.node = node;
+	r_entry.snapshot.transform = godot::Transform3D();
+	r_entry.snapshot.surface_array = r_entry.surfaces;
+	r_entry.face_extractor->snapshot_node(r_entry.snapshot);
+
+	if (r_entry.face_extractor->get_use_threads()) {
+		r_entry.task_id = godot::WorkerThreadPool::get_singleton()->add_native_task(&LibSM64SurfaceObjectQueue::build_entry_task, &r_entry, false, "LibSM64SurfaceObjectQueue");
+	} else {
+		r_entry.face_extractor->build_snapshot(r_entry.snapshot);
+	}
+}
+
+bool LibSM64SurfaceObjectQueue::is_entry_built(const Entry &p_entry) const {
+	if (p_entry.surfaces.is_null()) {
+		return false;
+	}
+	if (p_entry.shares_template) {
+		auto it = pending_templates.find(p_entry.template_key);
+		return it == pending_templates.end() || is_entry_built(*it->second);
+	}
+	return p_entry.task_id < 0 || godot::WorkerThreadPool::get_singleton()->is_task_completed(p_entry.task_id);
+}
+
+void LibSM64SurfaceObjectQueue::finish_template(Entry &r_entry) {
+	pending_templates.erase(r_entry.template_key);
+	// Templates converted before the cache was cleared may be out of date
+	if (r_entry.template_clear_count == r_entry.template_cache->clear_count) {
+		r_entry.template_cache->add_template(std::move(r_entry.template_key), std::move(r_entry.template_sources), r_entry.surfaces);
+	}
+	r_entry.template_cache.unref();
+}
+
+int LibSM64SurfaceObjectQueue::create_entry_object(Entry &r_entry) {
+	if (r_entry.task_id >= 0) {
+		// Completed tasks still have to be waited on to be released
+		godot::WorkerThreadPool::get_singleton()->wait_for_task_completion(r_entry.task_id);
+		r_entry.task_id = -1;
+	}
+	if (r_entry.template_cache.is_valid()) {
+		// Done even if the node was freed, the entries sharing the template still need it
+		finish_template(r_entry);
+	}
+
+	godot::Node3D *node = godot::Object::cast_to<godot::Node3D>(godot::ObjectDB::get_instance(r_entry.node_id));
+	if (node == nullptr || !node->is_inside_tree()) {
+		return 0;
+	}
+	if (r_entry.surfaces->get_surface_count() == 0) {
+		ERR_PRINT("[libsm64-godot] Faces array empty, skipping node " + node->get_name() + ".");
+		return 0;
+	}
+
+	// The node may have moved since it was queued
+	const godot::Transform3D transform = node->get_global_transform();
+	const int object_id = LibSM64::get_singleton()->surface_object_create(transform.origin, transform.basis.get_rotation_quaternion(), r_entry.surfaces);
+	if (object_id < 0) {
+		// Already reported by surface_object_create, e.g. the capacity is reached
+		return 0;
+	}
+	emit_signal("surface_object_created", node, object_id);
+	return 1;
+}
+
+void LibSM64SurfaceObjectQueue::_bind_methods() {
+	godot::ClassDB::bind_method(godot::D_METHOD("set_face_extractor", "value"), &LibSM64SurfaceObjectQueue::set_face_extractor);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_face_extractor"), &LibSM64SurfaceObjectQueue::get_face_extractor);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::OBJECT, "face_extractor"), "set_face_extractor", "get_face_extractor");
+	godot::ClassDB::bind_method(godot::D_METHOD("set_template_cache", "value"), &LibSM64SurfaceObjectQueue::set_template_cache);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_template_cache"), &LibSM64SurfaceObjectQueue::get_template_cache);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::OBJECT, "template_cache"), "set_template_cache", "get_template_cache");
+	godot::ClassDB::bind_method(godot::D_METHOD("set_budget_msec", "value"), &LibSM64SurfaceObjectQueue::set_budget_msec);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_budget_msec"), &LibSM64SurfaceObjectQueue::get_budget_msec);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::FLOAT, "budget_msec"), "set_budget_msec", "get_budget_msec");
+
+	godot::ClassDB::bind_method(godot::D_METHOD("queue_node", "node", "properties", "surfaces"), &LibSM64SurfaceObjectQueue::queue_node, DEFVAL(godot::Variant()), DEFVAL(godot::Variant()));
+	godot::ClassDB::bind_method(godot::D_METHOD("process"), &LibSM64SurfaceObjectQueue::process);
+	godot::ClassDB::bind_method(godot::D_METHOD("cancel"), &LibSM64SurfaceObjectQueue::cancel);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_pending_count"), &LibSM64SurfaceObjectQueue::get_pending_count);
+
+	ADD_SIGNAL(godot::MethodInfo("surface_object_created", godot::PropertyInfo(godot::Variant::OBJECT, "node", godot::PROPERTY_HINT_NONE, "", godot::PROPERTY_USAGE_DEFAULT, "Node3D"), godot::PropertyInfo(godot::Variant::INT, "object_id")));
+	ADD_SIGNAL(godot::MethodInfo("finished"));
+}
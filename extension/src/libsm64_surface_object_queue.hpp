@@ -0,0 +1,76 @@
+#ifndef LIBSM64GD_LIBSM64SURFACEOBJECTQUEUE_H
+#define LIBSM64GD_LIBSM64SURFACEOBJECTQUEUE_H
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <vector>
+
+#include <godot_cpp/classes/node3d.hpp>
+#include <godot_cpp/classes/ref.hpp>
+
+#include <libsm64_face_extractor.hpp>
+#include <libsm64_surface_array.hpp>
+#include <libsm64_surface_properties.hpp>
+#include <libsm64_surface_template_cache.hpp>
+
+class LibSM64SurfaceObjectQueue : public godot::RefCounted {
+	GDCLASS(LibSM64SurfaceObjectQueue, godot::RefCounted);
+
+public:
+	LibSM64SurfaceObjectQueue();
+	~LibSM64SurfaceObjectQueue();
+
+	void set_face_extractor(const godot::Ref<LibSM64FaceExtractor> &p_value);
+	godot::Ref<LibSM64FaceExtractor> get_face_extractor() const;
+
+	void set_template_cache(const godot::Ref<LibSM64SurfaceTemplateCache> &p_value);
+	godot::Ref<LibSM64SurfaceTemplateCache> get_template_cache() const;
+
+	void set_budget_msec(double p_value);
+	double get_budget_msec() const;
+
+	void queue_node(godot::Node3D *p_node, const godot::Ref<LibSM64SurfaceProperties> &p_properties = godot::Ref<LibSM64SurfaceProperties>(), const godot::Ref<LibSM64SurfaceArray> &p_surfaces = godot::Ref<LibSM64SurfaceArray>());
+	int process();
+	void cancel();
+
+	int get_pending_count() const;
+
+protected:
+	static void _bind_methods();
+
+private:
+	struct Entry {
+		godot::ObjectID node_id;
+		godot::Ref<LibSM64FaceExtractor> face_extractor;
+		LibSM64FaceExtractor::NodeSnapshot snapshot;
+		// Set up front for prebuilt surfaces, or once the conversion is started
+		godot::Ref<LibSM64SurfaceArray> surfaces;
+		int64_t task_id = -1;
+
+		// Set when the surfaces are converted for template_cache, or shared with the entry converting them
+		godot::Ref<LibSM64SurfaceTemplateCache> template_cache;
+		LibSM64SurfaceTemplateCache::TemplateKey template_key;
+		std::vector<godot::Ref<godot::Resource>> template_sources;
+		uint64_t template_clear_count = 0;
+		bool shares_template = false;
+	};
+
+	static void build_entry_task(void *p_userdata);
+
+	void start_entry(Entry &r_entry);
+	bool is_entry_built(const Entry &p_entry) const;
+	void finish_template(Entry &r_entry);
+	int create_entry_object(Entry &r_entry);
+
+	godot::Ref<LibSM64FaceExtractor> face_extractor;
+	godot::Ref<LibSM64SurfaceTemplateCache> template_cache;
+	double budget_msec = 2.0;
+
+	// std::list keeps entries in place while worker tasks write to them
+	std::list<Entry> entries;
+	// Entries converting a template not in template_cache yet, other entries with the same key wait for them
+	std::map<LibSM64SurfaceTemplateCache::TemplateKey, Entry *> pending_templates;
+};
+
+#endif // LIBSM64GD_LIBSM64SURFACEOBJECTQUEUE_H
@@ -0,0 +1,504 @@
+#include <libsm64_surface_optimizer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+// Coplanar merging uses exact int64 plane equations, which stay in range for coordinates below this
+static constexpr int64_t MERGE_COORDINATE_LIMIT = 1 << 18;
+// Larger regions are left as they are to bound the ear clipping cost
+static constexpr size_t MERGE_MAX_LOOP_SIZE = 4096;
+
+namespace {
+
+struct Vertex {
+	int32_t x, y, z;
+
+	bool operator==(const Vertex &p_other) const {
+		return x == p_other.x && y == p_other.y && z == p_other.z;
+	}
+	bool operator<(const Vertex &p_other) const {
+		return x != p_other.x ? x < p_other.x : (y != p_other.y ? y < p_other.y : z < p_other.z);
+	}
+};
+
+struct VertexHash {
+	size_t operator()(const Vertex &p_vertex) const {
+		uint64_t hash = static_cast<uint32_t>(p_vertex.x);
+		hash = hash * 0x9E3779B97F4A7C15ull + static_cast<uint32_t>(p_vertex.y);
+		hash = hash * 0x9E3779B97F4A7C15ull + static_cast<uint32_t>(p_vertex.z);
+		return static_cast<size_t>(hash ^ (hash >> 29));
+	}
+};
+
+// Triangle with its vertices rotated so the smallest comes first, preserving the winding
+struct TriangleKey {
+	Vertex vertices[3];
+	int16_t type;
+	int16_t force;
+	uint16_t terrain;
+
+	bool operator==(const TriangleKey &p_other) const {
+		return vertices[0] == p_other.vertices[0] && vertices[1] == p_other.vertices[1] && vertices[2] == p_other.vertices[2] && type == p_other.type && force == p_other.force && terrain == p_other.terrain;
+	}
+};
+
+struct TriangleKeyHash {
+	size_t operator()(const TriangleKey &p_key) const {
+		VertexHash vertex_hash;
+		uint64_t hash = vertex_hash(p_key.vertices[0]);
+		hash = hash * 31 + vertex_hash(p_key.vertices[1]);
+		hash = hash * 31 + vertex_hash(p_key.vertices[2]);
+		hash = hash * 31 + ((static_cast<uint64_t>(static_cast<uint16_t>(p_key.type)) << 32) ^ (static_cast<uint64_t>(static_cast<uint16_t>(p_key.force)) << 16) ^ p_key.terrain);
+		return static_cast<size_t>(hash ^ (hash >> 29));
+	}
+};
+
+// Surface properties and exact plane of a triangle
+struct PlaneKey {
+	int64_t normal[3];
+	int64_t distance;
+	int16_t type;
+	int16_t force;
+	uint16_t terrain;
+
+	bool operator==(const PlaneKey &p_other) const {
+		return normal[0] == p_other.normal[0] && normal[1] == p_other.normal[1] && normal[2] == p_other.normal[2] && distance == p_other.distance && type == p_other.type && force == p_other.force && terrain == p_other.terrain;
+	}
+};
+
+struct PlaneKeyHash {
+	size_t operator()(const PlaneKey &p_key) const {
+		uint64_t hash = static_cast<uint64_t>(p_key.normal[0]);
+		hash = hash * 0x9E3779B97F4A7C15ull + static_cast<uint64_t>(p_key.normal[1]);
+		hash = hash * 0x9E3779B97F4A7C15ull + static_cast<uint64_t>(p_key.normal[2]);
+		hash = hash * 0x9E3779B97F4A7C15ull + static_cast<uint64_t>(p_key.distance);
+		hash = hash * 0x9E3779B97F4A7C15ull + ((static_cast<uint64_t>(static_cast<uint16_t>(p_key.type)) << 32) ^ (static_cast<uint64_t>(static_cast<uint16_t>(p_key.force)) << 16) ^ p_key.terrain);
+		return static_cast<size_t>(hash ^ (hash >> 29));
+	}
+};
+
+struct Point2 {
+	int64_t u, v;
+};
+
+} // namespace
+
+static Vertex get_vertex(const struct SM64Surface &p_surface, int p_index) {
+	return { p_surface.vertices[p_index][0], p_surface.vertices[p_index][1], p_surface.vertices[p_index][2] };
+}
+
+static int32_t snap_coordinate(int32_t p_value, int32_t p_step) {
+	// Round to the nearest multiple of p_step, halves away from zero
+	const int64_t value = p_value;
+	const int64_t half = p_step / 2;
+	const int64_t snapped = value >= 0 ? (value + half) / p_step : -((-value + half) / p_step);
+	return static_cast<int32_t>(snapped * p_step);
+}
+
+static bool is_within_merge_limit(const struct SM64Surface &p_surface) {
+	for (const auto &vertex : p_surface.vertices) {
+		for (const int32_t coordinate : vertex) {
+			if (std::llabs(coordinate) >= MERGE_COORDINATE_LIMIT) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static void triangle_normal(const Vertex &p_a, const Vertex &p_b, const Vertex &p_c, int64_t r_normal[3]) {
+	const int64_t ab[3] = { int64_t(p_b.x) - p_a.x, int64_t(p_b.y) - p_a.y, int64_t(p_b.z) - p_a.z };
+	const int64_t ac[3] = { int64_t(p_c.x) - p_a.x, int64_t(p_c.y) - p_a.y, int64_t(p_c.z) - p_a.z };
+	r_normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+	r_normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+	r_normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+}
+
+static bool is_degenerate(const struct SM64Surface &p_surface) {
+	const Vertex a = get_vertex(p_surface, 0);
+	const Vertex b = get_vertex(p_surface, 1);
+	const Vertex c = get_vertex(p_surface, 2);
+	if (is_within_merge_limit(p_surface)) {
+		int64_t normal[3];
+		triangle_normal(a, b, c, normal);
+		return normal[0] == 0 && normal[1] == 0 && normal[2] == 0;
+	}
+
+	// Out of the exact range, a zero length normal in double precision is close enough
+	const double ab[3] = { double(b.x) - a.x, double(b.y) - a.y, double(b.z) - a.z };
+	const double ac[3] = { double(c.x) - a.x, double(c.y) - a.y, double(c.z) - a.z };
+	return ab[1] * ac[2] - ab[2] * ac[1] == 0 && ab[2] * ac[0] - ab[0] * ac[2] == 0 && ab[0] * ac[1] - ab[1] * ac[0] == 0;
+}
+
+static TriangleKey make_triangle_key(const struct SM64Surface &p_surface) {
+	Vertex vertices[3] = { get_vertex(p_surface, 0), get_vertex(p_surface, 1), get_vertex(p_surface, 2) };
+	const int first = vertices[1] < vertices[0] ? (vertices[2] < vertices[1] ? 2 : 1) : (vertices[2] < vertices[0] ? 2 : 0);
+	return {
+		{ vertices[first], vertices[(first + 1) % 3], vertices[(first + 2) % 3] },
+		p_surface.type,
+		p_surface.force,
+		p_surface.terrain,
+	};
+}
+
+static PlaneKey make_plane_key(const struct SM64Surface &p_surface) {
+	const Vertex a = get_vertex(p_surface, 0);
+	PlaneKey key;
+	triangle_normal(a, get_vertex(p_surface, 1), get_vertex(p_surface, 2), key.normal);
+	const int64_t divisor = std::gcd(std::gcd(std::llabs(key.normal[0]), std::llabs(key.normal[1])), std::llabs(key.normal[2]));
+	for (auto &component : key.normal) {
+		component /= divisor;
+	}
+	key.distance = key.normal[0] * a.x + key.normal[1] * a.y + key.normal[2] * a.z;
+	key.type = p_surface.type;
+	key.force = p_surface.force;
+	key.terrain = p_surface.terrain;
+	return key;
+}
+
+static int64_t cross_2d(const Point2 &p_a, const Point2 &p_b, const Point2 &p_c) {
+	return (p_b.u - p_a.u) * (p_c.v - p_a.v) - (p_b.v - p_a.v) * (p_c.u - p_a.u);
+}
+
+static double distance_to_line(const Vertex &p_point, const Vertex &p_from, const Vertex &p_to) {
+	const double direction[3] = { double(p_to.x) - p_from.x, double(p_to.y) - p_from.y, double(p_to.z) - p_from.z };
+	const double offset[3] = { double(p_point.x) - p_from.x, double(p_point.y) - p_from.y, double(p_point.z) - p_from.z };
+	const double cross[3] = {
+		offset[1] * direction[2] - offset[2] * direction[1],
+		offset[2] * direction[0] - offset[0] * direction[2],
+		offset[0] * direction[1] - offset[1] * direction[0],
+	};
+	const double length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+	if (length == 0) {
+		return std::sqrt(offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2]);
+	}
+	return std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]) / length;
+}
+
+// Drops loop vertices lying on (or within p_tolerance of) the edge between their neighbours.
+// Vertices in p_shared are used by other triangles, so they are only dropped when exactly on the edge,
+// moving them would open a gap along the seam.
+static void simplify_loop(std::vector<Vertex> &r_loop, double p_tolerance, const std::unordered_set<Vertex, VertexHash> &p_shared) {
+	bool changed = true;
+	while (changed && r_loop.size() > 3) {
+		changed = false;
+		for (size_t i = 0; i < r_loop.size() && r_loop.size() > 3; i++) {
+			const Vertex &previous = r_loop[(i + r_loop.size() - 1) % r_loop.size()];
+			const Vertex &current = r_loop[i];
+			const Vertex &next = r_loop[(i + 1) % r_loop.size()];
+
+			bool removable;
+			if (p_tolerance > 0 && p_shared.count(current) == 0) {
+				removable = distance_to_line(current, previous, next) <= p_tolerance;
+			} else {
+				int64_t normal[3];
+				triangle_normal(previous, current, next, normal);
+				removable = normal[0] == 0 && normal[1] == 0 && normal[2] == 0;
+			}
+
+			if (removable) {
+				r_loop.erase(r_loop.begin() + i);
+				i--;
+				changed = true;
+			}
+		}
+	}
+}
+
+// Ear clipping of a simple polygon, emitting triangles in the loop's winding
+static bool triangulate_loop(const std::vector<Vertex> &p_loop, const int64_t p_normal[3], std::vector<std::array<size_t, 3>> &r_triangles) {
+	// Project on the plane of the two axes with the smallest normal components
+	int drop_axis = 0;
+	for (int axis = 1; axis < 3; axis++) {
+		if (std::llabs(p_normal[axis]) > std::llabs(p_normal[drop_axis])) {
+			drop_axis = axis;
+		}
+	}
+	std::vector<Point2> points(p_loop.size());
+	for (size_t i = 0; i < p_loop.size(); i++) {
+		const int64_t coordinates[3] = { p_loop[i].x, p_loop[i].y, p_loop[i].z };
+		points[i] = { coordinates[(drop_axis + 1) % 3], coordinates[(drop_axis + 2) % 3] };
+	}
+
+	int64_t area = 0;
+	for (size_t i = 0; i < points.size(); i++) {
+		const Point2 &a = points[i];
+		const Point2 &b = points[(i + 1) % points.size()];
+		area += a.u * b.v - b.u * a.v;
+	}
+	if (area == 0) {
+		return false;
+	}
+	const int64_t orientation = area > 0 ? 1 : -1;
+
+	std::vector<size_t> previous(points.size());
+	std::vector<size_t> next(points.size());
+	for (size_t i = 0; i < points.size(); i++) {
+		previous[i] = (i + points.size() - 1) % points.size();
+		next[i] = (i + 1) % points.size();
+	}
+
+	size_t remaining = points.size();
+	size_t current = 0;
+	size_t attempts = 0;
+	while (remaining > 3) {
+		if (attempts++ > remaining) {
+			// No ear left, the loop is self-intersecting
+			return false;
+		}
+
+		const size_t a = previous[current];
+		const size_t c = next[current];
+		bool is_ear = cross_2d(points[a], points[current], points[c]) * orientation > 0;
+		for (size_t j = next[c]; is_ear && j != a; j = next[j]) {
+			const Point2 &point = points[j];
+			is_ear = !(cross_2d(points[a], points[current], point) * orientation >= 0 && cross_2d(points[current], points[c], point) * orientation >= 0 && cross_2d(points[c], points[a], point) * orientation >= 0);
+		}
+
+		if (is_ear) {
+			r_triangles.push_back({ a, current, c });
+			next[a] = c;
+			previous[c] = a;
+			remaining--;
+			current = a;
+			attempts = 0;
+		} else {
+			current = c;
+		}
+	}
+
+	const size_t a = previous[current];
+	const size_t c = next[current];
+	if (cross_2d(points[a], points[current], points[c]) * orientation <= 0) {
+		return false;
+	}
+	r_triangles.push_back({ a, current, c });
+	return true;
+}
+
+static size_t find_root(std::vector<size_t> &r_parents, size_t p_index) {
+	while (r_parents[p_index] != p_index) {
+		r_parents[p_index] = r_parents[r_parents[p_index]];
+		p_index = r_parents[p_index];
+	}
+	return p_index;
+}
+
+// Re-triangulates a connected coplanar region if its boundary is a single simple loop.
+// Returns false to keep the original triangles.
+static bool merge_region(const std::vector<struct SM64Surface> &p_surfaces, const std::vector<size_t> &p_region, const int64_t p_normal[3], double p_tolerance, const std::unordered_map<Vertex, size_t, VertexHash> &p_vertex_uses, std::vector<struct SM64Surface> &r_merged) {
+	struct EdgeHash {
+		size_t operator()(const std::pair<Vertex, Vertex> &p_edge) const {
+			VertexHash vertex_hash;
+			return vertex_hash(p_edge.first) * 31 + vertex_hash(p_edge.second);
+		}
+	};
+
+	std::unordered_set<std::pair<Vertex, Vertex>, EdgeHash> edges;
+	for (const size_t index : p_region) {
+		for (int i = 0; i < 3; i++) {
+			if (!edges.insert({ get_vertex(p_surfaces[index], i), get_vertex(p_surfaces[index], (i + 1) % 3) }).second) {
+				// Overlapping triangles, the region is not a manifold surface
+				return false;
+			}
+		}
+	}
+
+	std::unordered_map<Vertex, Vertex, VertexHash> boundary_next;
+	for (const auto &edge : edges) {
+		if (edges.count({ edge.second, edge.first }) == 0) {
+			if (!boundary_next.emplace(edge.first, edge.second).second) {
+				// Pinched boundary
+				return false;
+			}
+		}
+	}
+	if (boundary_next.size() < 3) {
+		return false;
+	}
+
+	// Start from the smallest vertex so the result doesn't depend on hash ordering
+	Vertex start = boundary_next.begin()->first;
+	for (const auto &entry : boundary_next) {
+		if (entry.first < start) {
+			start = entry.first;
+		}
+	}
+
+	std::vector<Vertex> loop;
+	Vertex current = start;
+	do {
+		loop.push_back(current);
+		auto it = boundary_next.find(current);
+		if (it == boundary_next.end() || loop.size() > boundary_next.size()) {
+			return false;
+		}
+		current = it->second;
+	} while (!(current == start));
+	if (loop.size() != boundary_next.size() || loop.size() > MERGE_MAX_LOOP_SIZE) {
+		// Several loops, i.e. holes or disjoint boundaries
+		return false;
+	}
+
+	// Boundary vertices also used outside of the region are shared with its neighbours
+	std::unordered_set<Vertex, VertexHash> shared;
+	if (p_tolerance > 0) {
+		std::unordered_map<Vertex, size_t, VertexHash> region_uses;
+		for (const size_t index : p_region) {
+			for (int i = 0; i < 3; i++) {
+				region_uses[get_vertex(p_surfaces[index], i)]++;
+			}
+		}
+		for (const Vertex &vertex : loop) {
+			const auto uses = p_vertex_uses.find(vertex);
+			if (uses != p_vertex_uses.end() && uses->second > region_uses[vertex]) {
+				shared.insert(vertex);
+			}
+		}
+	}
+
+	simplify_loop(loop, p_tolerance, shared);
+
+	std::vector<std::array<size_t, 3>> triangles;
+	if (!triangulate_loop(loop, p_normal, triangles) || triangles.size() >= p_region.size()) {
+		return false;
+	}
+
+	const struct SM64Surface &properties = p_surfaces[p_region.front()];
+	for (const auto &triangle : triangles) {
+		struct SM64Surface surface = properties;
+		for (int i = 0; i < 3; i++) {
+			const Vertex &vertex = loop[triangle[i]];
+			surface.vertices[i][0] = vertex.x;
+			surface.vertices[i][1] = vertex.y;
+			surface.vertices[i][2] = vertex.z;
+		}
+		r_merged.push_back(surface);
+	}
+	return true;
+}
+
+void optimize_sm64_surfaces(std::vector<struct SM64Surface> &r_surfaces, int32_t p_weld_distance, double p_tolerance, SM64SurfaceOptimizeStats &r_stats) {
+	r_stats = SM64SurfaceOptimizeStats();
+	r_stats.surfaces_before = static_cast<int64_t>(r_surfaces.size());
+
+	if (p_weld_distance > 1) {
+		std::unordered_set<Vertex, VertexHash> before;
+		std::unordered_set<Vertex, VertexHash> after;
+		for (auto &surface : r_surfaces) {
+			for (auto &vertex : surface.vertices) {
+				before.insert({ vertex[0], vertex[1], vertex[2] });
+				for (auto &coordinate : vertex) {
+					coordinate = snap_coordinate(coordinate, p_weld_distance);
+				}
+				after.insert({ vertex[0], vertex[1], vertex[2] });
+			}
+		}
+		r_stats.vertices_welded = static_cast<int64_t>(before.size() - after.size());
+	}
+
+	std::vector<struct SM64Surface> surfaces;
+	surfaces.reserve(r_surfaces.size());
+	std::unordered_set<TriangleKey, TriangleKeyHash> seen;
+	for (const auto &surface : r_surfaces) {
+		if (is_degenerate(surface)) {
+			r_stats.degenerate_removed++;
+		} else if (!seen.insert(make_triangle_key(surface)).second) {
+			r_stats.duplicates_removed++;
+		} else {
+			surfaces.push_back(surface);
+		}
+	}
+
+	// Only needed to keep shared vertices in place when simplifying with a tolerance
+	std::unordered_map<Vertex, size_t, VertexHash> vertex_uses;
+	if (p_tolerance > 0) {
+		for (const auto &surface : surfaces) {
+			for (int i = 0; i < 3; i++) {
+				vertex_uses[get_vertex(surface, i)]++;
+			}
+		}
+	}
+
+	// Group mergeable triangles by exact plane and surface properties
+	std::unordered_map<PlaneKey, std::vector<size_t>, PlaneKeyHash> planes;
+	for (size_t i = 0; i < surfaces.size(); i++) {
+		if (is_within_merge_limit(surfaces[i])) {
+			planes[make_plane_key(surfaces[i])].push_back(i);
+		}
+	}
+
+	// Regions are emitted in place of their first triangle to keep the output order stable
+	std::vector<std::vector<struct SM64Surface>> replacements(surfaces.size());
+	std::vector<bool> removed(surfaces.size(), false);
+	for (const auto &plane : planes) {
+		const std::vector<size_t> &members = plane.second;
+		if (members.size() < 2) {
+			continue;
+		}
+
+		// Split the plane into regions connected through shared edges
+		std::vector<size_t> parents(members.size());
+		std::iota(parents.begin(), parents.end(), 0);
+		std::unordered_map<Vertex, std::vector<size_t>, VertexHash> vertex_members;
+		for (size_t i = 0; i < members.size(); i++) {
+			for (int j = 0; j < 3; j++) {
+				vertex_members[get_vertex(surfaces[members[i]], j)].push_back(i);
+			}
+		}
+		for (size_t i = 0; i < members.size(); i++) {
+			for (int j = 0; j < 3; j++) {
+				const Vertex from = get_vertex(surfaces[members[i]], j);
+				const Vertex to = get_vertex(surfaces[members[i]], (j + 1) % 3);
+				for (const size_t other : vertex_members[to]) {
+					const struct SM64Surface &other_surface = surfaces[members[other]];
+					for (int k = 0; k < 3; k++) {
+						if (get_vertex(other_surface, k) == to && get_vertex(other_surface, (k + 1) % 3) == from) {
+							parents[find_root(parents, i)] = find_root(parents, other);
+						}
+					}
+				}
+			}
+		}
+
+		std::unordered_map<size_t, std::vector<size_t>> regions;
+		for (size_t i = 0; i < members.size(); i++) {
+			regions[find_root(parents, i)].push_back(members[i]);
+		}
+
+		for (auto &region : regions) {
+			std::vector<size_t> &indices = region.second;
+			if (indices.size() < 2) {
+				continue;
+			}
+			std::sort(indices.begin(), indices.end());
+
+			std::vector<struct SM64Surface> merged;
+			if (!merge_region(surfaces, indices, plane.first.normal, p_tolerance, vertex_uses, merged)) {
+				continue;
+			}
+
+			r_stats.merged_removed += static_cast<int64_t>(indices.size() - merged.size());
+			for (const size_t index : indices) {
+				removed[index] = true;
+			}
+			replacements[indices.front()] = std::move(merged);
+		}
+	}
+
+	r_surfaces.clear();
+	for (size_t i = 0; i < surfaces.size(); i++) {
+		if (!removed[i]) {
+			r_surfaces.push_back(surfaces[i]);
+		} else {
+			r_surfaces.insert(r_surfaces.end(), replacements[i].begin(), replacements[i].end());
+		}
+	}
+
+	r_stats.surfaces_after = static_cast<int64_t>(r_surfaces.size());
+}
@@ -0,0 +1,25 @@
+#ifndef LIBSM64GD_LIBSM64SURFACEOPTIMIZER_H
+#define LIBSM64GD_LIBSM64SURFACEOPTIMIZER_H
+
+#include <cstdint>
+#include <vector>
+
+#include <libsm64.h>
+
+// Collision mesh cleanup over SM64Surface records, all distances in SM64 units.
+
+struct SM64SurfaceOptimizeStats {
+	int64_t surfaces_before = 0;
+	int64_t surfaces_after = 0;
+	int64_t vertices_welded = 0;
+	int64_t degenerate_removed = 0;
+	int64_t duplicates_removed = 0;
+	int64_t merged_removed = 0;
+};
+
+// Snaps vertices to a p_weld_distance grid, removes zero area and duplicate triangles, and
+// re-triangulates connected coplanar regions sharing the same surface type, force and terrain.
+// Region boundary vertices deviating less than p_tolerance from a straight edge are dropped.
+void optimize_sm64_surfaces(std::vector<struct SM64Surface> &r_surfaces, int32_t p_weld_distance, double p_tolerance, SM64SurfaceOptimizeStats &r_stats);
+
+#endif // LIBSM64GD_LIBSM64SURFACEOPTIMIZER_H
@@ -5,6 +5,9 @@
 
 #include <libsm64.hpp>
 
+// Enum hint of LibSM64::TerrainType, shared by every terrain_type property
+#define TERRAIN_TYPE_HINT_STRING "Grass,Stone,Snow,Sand,Spooky,Water,Slide,Mask"
+
 class LibSM64SurfaceProperties : public godot::Resource {
 	GDCLASS(LibSM64SurfaceProperties, godot::Resource);
 
@@ -0,0 +1,242 @@
+#include <libsm64_surface_streamer.hpp>
+
+#include <algorithm>
+#include <utility>
+
+#include <godot_cpp/core/math.hpp>
+
+#include <libsm64.hpp>
+
+LibSM64SurfaceStreamer::~LibSM64SurfaceStreamer() {
+	unload_all();
+}
+
+void LibSM64SurfaceStreamer::set_chunk_size(godot::real_t p_value) {
+	ERR_FAIL_COND(p_value <= 0);
+	chunk_size = p_value;
+}
+
+godot::real_t LibSM64SurfaceStreamer::get_chunk_size() const {
+	return chunk_size;
+}
+
+void LibSM64SurfaceStreamer::set_load_distance(godot::real_t p_value) {
+	ERR_FAIL_COND(p_value < 0);
+	load_distance = p_value;
+}
+
+godot::real_t LibSM64SurfaceStreamer::get_load_distance() const {
+	return load_distance;
+}
+
+void LibSM64SurfaceStreamer::set_unload_distance(godot::real_t p_value) {
+	ERR_FAIL_COND(p_value < 0);
+	unload_distance = p_value;
+}
+
+godot::real_t LibSM64SurfaceStreamer::get_unload_distance() const {
+	return unload_distance;
+}
+
+void LibSM64SurfaceStreamer::set_max_loads_per_update(int p_value) {
+	max_loads_per_update = p_value;
+}
+
+int LibSM64SurfaceStreamer::get_max_loads_per_update() const {
+	return max_loads_per_update;
+}
+
+void LibSM64SurfaceStreamer::set_surfaces(const godot::Ref<LibSM64SurfaceArray> &p_surfaces) {
+	unload_all();
+	chunks.clear();
+	chunk_indices.clear();
+	max_chunk_overhang = 0.0;
+
+	if (p_surfaces.is_null()) {
+		return;
+	}
+
+	LibSM64 *libsm64 = LibSM64::get_singleton();
+	ERR_FAIL_NULL(libsm64);
+	// Native SM64 data is placed with the current scale factor
+	const godot::real_t scale_factor = p_surfaces->scale_factor != 0 ? p_surfaces->scale_factor : libsm64->get_scale_factor();
+
+	for (const auto &surface : p_surfaces->sm64_surfaces) {
+		// SM64 (x, y, z) is Godot (-z, y, x) scaled
+		godot::Vector2 points[3];
+		for (int i = 0; i < 3; i++) {
+			points[i] = godot::Vector2(-surface.vertices[i][2] / scale_factor, surface.vertices[i][0] / scale_factor);
+		}
+		const godot::real_t centroid_x = (points[0].x + points[1].x + points[2].x) / 3;
+		const godot::real_t centroid_z = (points[0].y + points[1].y + points[2].y) / 3;
+		const int64_t cell_x = static_cast<int64_t>(godot::Math::floor(centroid_x / chunk_size));
+		const int64_t cell_z = static_cast<int64_t>(godot::Math::floor(centroid_z / chunk_size));
+
+		// Chunk origin at the cell corner, in whole SM64 units so the surfaces stay exact
+		const int32_t offset_x = static_cast<int32_t>(godot::Math::round(cell_z * chunk_size * scale_factor));
+		const int32_t offset_z = static_cast<int32_t>(godot::Math::round(-cell_x * chunk_size * scale_factor));
+
+		auto it = chunk_indices.find(make_chunk_key(cell_x, cell_z));
+		if (it == chunk_indices.end()) {
+			it = chunk_indices.emplace(make_chunk_key(cell_x, cell_z), chunks.size()).first;
+			Chunk &chunk = chunks.emplace_back();
+			chunk.surfaces.instantiate();
+			chunk.surfaces->scale_factor = p_surfaces->scale_factor;
+			chunk.position = godot::Vector3(-offset_z / scale_factor, 0.0, offset_x / scale_factor);
+			chunk.bounds_min = points[0];
+			chunk.bounds_max = points[0];
+		}
+
+		Chunk &chunk = chunks[it->second];
+		struct SM64Surface local_surface = surface;
+		for (int i = 0; i < 3; i++) {
+			local_surface.vertices[i][0] -= offset_x;
+			local_surface.vertices[i][2] -= offset_z;
+		}
+		chunk.surfaces->sm64_surfaces.push_back(local_surface);
+		for (const auto &point : points) {
+			chunk.bounds_min = godot::Vector2(godot::MIN(chunk.bounds_min.x, point.x), godot::MIN(chunk.bounds_min.y, point.y));
+			chunk.bounds_max = godot::Vector2(godot::MAX(chunk.bounds_max.x, point.x), godot::MAX(chunk.bounds_max.y, point.y));
+		}
+
+		const godot::Vector2 cell_min(cell_x * chunk_size, cell_z * chunk_size);
+		const godot::Vector2 cell_max = cell_min + godot::Vector2(chunk_size, chunk_size);
+		max_chunk_overhang = godot::MAX(max_chunk_overhang, godot::MAX(godot::MAX(cell_min.x - chunk.bounds_min.x, cell_min.y - chunk.bounds_min.y), godot::MAX(chunk.bounds_max.x - cell_max.x, chunk.bounds_max.y - cell_max.y)));
+	}
+}
+
+void LibSM64SurfaceStreamer::update(const godot::PackedVector3Array &p_positions) {
+	// Unloading farther than loading keeps chunks near the border from being swapped every update
+	const godot::real_t keep_distance = godot::MAX(unload_distance, load_distance);
+
+	for (size_t i = 0; i < loaded_chunks.size();) {
+		Chunk &chunk = chunks[loaded_chunks[i]];
+		godot::real_t distance = Math_INF;
+		for (int64_t j = 0; j < p_positions.size(); j++) {
+			distance = godot::MIN(distance, distance_to_chunk(chunk, p_positions[j]));
+		}
+
+		if (distance > keep_distance) {
+			unload_chunk(chunk);
+			loaded_chunks[i] = loaded_chunks.back();
+			loaded_chunks.pop_back();
+		} else {
+			i++;
+		}
+	}
+
+	// Only the cells around each position are visited, so the cost doesn't grow with the world size
+	std::unordered_map<size_t, godot::real_t> candidates;
+	const godot::real_t reach = load_distance + max_chunk_overhang;
+	for (int64_t i = 0; i < p_positions.size(); i++) {
+		const godot::Vector3 &position = p_positions[i];
+		const int64_t min_x = static_cast<int64_t>(godot::Math::floor((position.x - reach) / chunk_size));
+		const int64_t max_x = static_cast<int64_t>(godot::Math::floor((position.x + reach) / chunk_size));
+		const int64_t min_z = static_cast<int64_t>(godot::Math::floor((position.z - reach) / chunk_size));
+		const int64_t max_z = static_cast<int64_t>(godot::Math::floor((position.z + reach) / chunk_size));
+		for (int64_t x = min_x; x <= max_x; x++) {
+			for (int64_t z = min_z; z <= max_z; z++) {
+				auto it = chunk_indices.find(make_chunk_key(x, z));
+				if (it == chunk_indices.end() || chunks[it->second].object_id >= 0) {
+					continue;
+				}
+
+				const godot::real_t distance = distance_to_chunk(chunks[it->second], position);
+				if (distance > load_distance) {
+					continue;
+				}
+				auto candidate = candidates.find(it->second);
+				if (candidate == candidates.end()) {
+					candidates.emplace(it->second, distance);
+				} else {
+					candidate->second = godot::MIN(candidate->second, distance);
+				}
+			}
+		}
+	}
+
+	// Nearest chunks first, the rest are loaded on the next updates
+	std::vector<std::pair<godot::real_t, size_t>> sorted_candidates;
+	sorted_candidates.reserve(candidates.size());
+	for (const auto &candidate : candidates) {
+		sorted_candidates.emplace_back(candidate.second, candidate.first);
+	}
+	std::sort(sorted_candidates.begin(), sorted_candidates.end());
+
+	size_t load_count = sorted_candidates.size();
+	if (max_loads_per_update > 0) {
+		load_count = godot::MIN(load_count, static_cast<size_t>(max_loads_per_update));
+	}
+	for (size_t i = 0; i < load_count; i++) {
+		load_chunk(chunks[sorted_candidates[i].second]);
+		loaded_chunks.push_back(sorted_candidates[i].second);
+	}
+}
+
+void LibSM64SurfaceStreamer::unload_all() {
+	for (const size_t index : loaded_chunks) {
+		unload_chunk(chunks[index]);
+	}
+	loaded_chunks.clear();
+}
+
+int LibSM64SurfaceStreamer::get_chunk_count() const {
+	return static_cast<int>(chunks.size());
+}
+
+int LibSM64SurfaceStreamer::get_loaded_chunk_count() const {
+	return static_cast<int>(loaded_chunks.size());
+}
+
+int LibSM64SurfaceStreamer::get_loaded_surface_count() const {
+	int64_t count = 0;
+	for (const size_t index : loaded_chunks) {
+		count += chunks[index].surfaces->get_surface_count();
+	}
+	return static_cast<int>(count);
+}
+
+int64_t LibSM64SurfaceStreamer::make_chunk_key(int64_t p_x, int64_t p_z) {
+	return static_cast<int64_t>((static_cast<uint64_t>(p_x) << 32) ^ (static_cast<uint64_t>(p_z) & 0xFFFFFFFF));
+}
+
+godot::real_t LibSM64SurfaceStreamer::distance_to_chunk(const Chunk &p_chunk, const godot::Vector3 &p_position) {
+	const godot::real_t dx = godot::MAX(godot::MAX(p_chunk.bounds_min.x - p_position.x, p_position.x - p_chunk.bounds_max.x), static_cast<godot::real_t>(0));
+	const godot::real_t dz = godot::MAX(godot::MAX(p_chunk.bounds_min.y - p_position.z, p_position.z - p_chunk.bounds_max.y), static_cast<godot::real_t>(0));
+	return godot::Math::sqrt(dx * dx + dz * dz);
+}
+
+void LibSM64SurfaceStreamer::load_chunk(Chunk &r_chunk) {
+	LibSM64 *libsm64 = LibSM64::get_singleton();
+	ERR_FAIL_NULL(libsm64);
+	r_chunk.object_id = libsm64->surface_object_create(r_chunk.position, godot::Quaternion(), r_chunk.surfaces);
+}
+
+void LibSM64SurfaceStreamer::unload_chunk(Chunk &r_chunk) {
+	LibSM64 *libsm64 = LibSM64::get_singleton();
+	if (libsm64 != nullptr && r_chunk.object_id >= 0) {
+		libsm64->surface_object_delete(r_chunk.object_id);
+	}
+	r_chunk.object_id = -1;
+}
+
+void LibSM64SurfaceStreamer::_bind_methods() {
+	godot::ClassDB::bind_method(godot::D_METHOD("set_chunk_size", "value"), &LibSM64SurfaceStreamer::set_chunk_size);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_chunk_size"), &LibSM64SurfaceStreamer::get_chunk_size);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::FLOAT, "chunk_size"), "set_chunk_size", "get_chunk_size");
+	godot::ClassDB::bind_method(godot::D_METHOD("set_load_distance", "value"), &LibSM64SurfaceStreamer::set_load_distance);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_load_distance"), &LibSM64SurfaceStreamer::get_load_distance);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::FLOAT, "load_distance"), "set_load_distance", "get_load_distance");
+	godot::ClassDB::bind_method(godot::D_METHOD("set_unload_distance", "value"), &LibSM64SurfaceStreamer::set_unload_distance);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_unload_distance"), &LibSM64SurfaceStreamer::get_unload_distance);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::FLOAT, "unload_distance"), "set_unload_distance", "get_unload_distance");
+	godot::ClassDB::bind_method(godot::D_METHOD("set_max_loads_per_update", "value"), &LibSM64SurfaceStreamer::set_max_loads_per_update);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_max_loads_per_update"), &LibSM64SurfaceStreamer::get_max_loads_per_update);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::INT, "max_loads_per_update"), "set_max_loads_per_update", "get_max_loads_per_update");
+	godot::ClassDB::bind_method(godot::D_METHOD("set_surfaces", "surfaces"), &LibSM64SurfaceStreamer::set_surfaces);
+	godot::ClassDB::bind_method(godot::D_METHOD("update", "positions"), &LibSM64SurfaceStreamer::update);
+	godot::ClassDB::bind_method(godot::D_METHOD("unload_all"), &LibSM64SurfaceStreamer::unload_all);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_chunk_count"), &LibSM64SurfaceStreamer::get_chunk_count);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_loaded_chunk_count"), &LibSM64SurfaceStreamer::get_loaded_chunk_count);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_loaded_surface_count"), &LibSM64SurfaceStreamer::get_loaded_surface_count);
+}
@@ -0,0 +1,71 @@
+#ifndef LIBSM64GD_LIBSM64SURFACESTREAMER_H
+#define LIBSM64GD_LIBSM64SURFACESTREAMER_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <godot_cpp/classes/ref.hpp>
+
+#include <libsm64_surface_array.hpp>
+
+class LibSM64SurfaceStreamer : public godot::RefCounted {
+	GDCLASS(LibSM64SurfaceStreamer, godot::RefCounted);
+
+public:
+	LibSM64SurfaceStreamer() = default;
+	~LibSM64SurfaceStreamer();
+
+	void set_chunk_size(godot::real_t p_value);
+	godot::real_t get_chunk_size() const;
+
+	void set_load_distance(godot::real_t p_value);
+	godot::real_t get_load_distance() const;
+
+	void set_unload_distance(godot::real_t p_value);
+	godot::real_t get_unload_distance() const;
+
+	void set_max_loads_per_update(int p_value);
+	int get_max_loads_per_update() const;
+
+	void set_surfaces(const godot::Ref<LibSM64SurfaceArray> &p_surfaces);
+	void update(const godot::PackedVector3Array &p_positions);
+	void unload_all();
+
+	int get_chunk_count() const;
+	int get_loaded_chunk_count() const;
+	int get_loaded_surface_count() const;
+
+protected:
+	static void _bind_methods();
+
+private:
+	struct Chunk {
+		// Surfaces relative to the chunk's position, so they follow the world origin like any surface object
+		godot::Ref<LibSM64SurfaceArray> surfaces;
+		godot::Vector3 position;
+		// Bounds on Godot's XZ plane, as (x, z)
+		godot::Vector2 bounds_min;
+		godot::Vector2 bounds_max;
+		int object_id = -1;
+	};
+
+	static int64_t make_chunk_key(int64_t p_x, int64_t p_z);
+	static godot::real_t distance_to_chunk(const Chunk &p_chunk, const godot::Vector3 &p_position);
+
+	void load_chunk(Chunk &r_chunk);
+	void unload_chunk(Chunk &r_chunk);
+
+	godot::real_t chunk_size = 32.0;
+	godot::real_t load_distance = 32.0;
+	godot::real_t unload_distance = 48.0;
+	int max_loads_per_update = 4;
+
+	std::vector<Chunk> chunks;
+	std::unordered_map<int64_t, size_t> chunk_indices;
+	std::vector<size_t> loaded_chunks;
+	// How far triangles reach outside of their chunk's cell, to find the chunks near a position
+	godot::real_t max_chunk_overhang = 0.0;
+};
+
+#endif // LIBSM64GD_LIBSM64SURFACESTREAMER_H
@@ -0,0 +1,165 @@
+#include <libsm64_surface_template_cache.hpp>
+
+#include <cstring>
+
+#include <godot_cpp/classes/collision_object3d.hpp>
+#include <godot_cpp/classes/collision_shape3d.hpp>
+#include <godot_cpp/classes/mesh.hpp>
+#include <godot_cpp/classes/mesh_instance3d.hpp>
+#include <godot_cpp/classes/multi_mesh.hpp>
+#include <godot_cpp/classes/multi_mesh_instance3d.hpp>
+
+#include <libsm64.hpp>
+
+enum TemplateSourceKind : uint64_t {
+	TEMPLATE_SOURCE_COLLISION_OBJECT,
+	TEMPLATE_SOURCE_COLLISION_SHAPE,
+	TEMPLATE_SOURCE_MESH_INSTANCE,
+	TEMPLATE_SOURCE_MULTI_MESH_INSTANCE,
+};
+
+static uint64_t double_bits(double p_value) {
+	uint64_t bits;
+	memcpy(&bits, &p_value, sizeof(bits));
+	return bits;
+}
+
+LibSM64SurfaceTemplateCache::LibSM64SurfaceTemplateCache() {
+	face_extractor.instantiate();
+}
+
+void LibSM64SurfaceTemplateCache::set_face_extractor(const godot::Ref<LibSM64FaceExtractor> &p_value) {
+	ERR_FAIL_NULL(p_value);
+	face_extractor = p_value;
+	// Templates were tessellated with the previous extractor's settings
+	clear();
+}
+
+godot::Ref<LibSM64FaceExtractor> LibSM64SurfaceTemplateCache::get_face_extractor() const {
+	return face_extractor;
+}
+
+godot::Ref<LibSM64SurfaceArray> LibSM64SurfaceTemplateCache::get_node_surfaces(godot::Node3D *p_node, const godot::Ref<LibSM64SurfaceProperties> &p_properties) {
+	ERR_FAIL_NULL_V(p_node, godot::Ref<LibSM64SurfaceArray>());
+
+	TemplateKey key;
+	std::vector<godot::Ref<godot::Resource>> sources;
+	if (!make_key(p_node, p_properties, key, sources)) {
+		// Not cacheable (e.g. CSG), convert the node every time
+		godot::Ref<LibSM64SurfaceArray> surfaces;
+		surfaces.instantiate();
+		face_extractor->add_node_faces(surfaces, p_node, godot::Transform3D(), p_properties);
+		return surfaces;
+	}
+
+	auto it = templates.find(key);
+	if (it != templates.end()) {
+		hit_count++;
+		return it->second.surfaces;
+	}
+
+	miss_count++;
+	Template &surface_template = templates[std::move(key)];
+	surface_template.surfaces.instantiate();
+	surface_template.sources = std::move(sources);
+	face_extractor->add_node_faces(surface_template.surfaces, p_node, godot::Transform3D(), p_properties);
+	return surface_template.surfaces;
+}
+
+void LibSM64SurfaceTemplateCache::clear() {
+	templates.clear();
+	hit_count = 0;
+	miss_count = 0;
+	clear_count++;
+}
+
+int LibSM64SurfaceTemplateCache::get_template_count() const {
+	return static_cast<int>(templates.size());
+}
+
+int64_t LibSM64SurfaceTemplateCache::get_hit_count() const {
+	return hit_count;
+}
+
+int64_t LibSM64SurfaceTemplateCache::get_miss_count() const {
+	return miss_count;
+}
+
+godot::Ref<LibSM64SurfaceArray> LibSM64SurfaceTemplateCache::find_template(const TemplateKey &p_key) {
+	auto it = templates.find(p_key);
+	if (it == templates.end()) {
+		return godot::Ref<LibSM64SurfaceArray>();
+	}
+	hit_count++;
+	return it->second.surfaces;
+}
+
+void LibSM64SurfaceTemplateCache::add_template(TemplateKey &&p_key, std::vector<godot::Ref<godot::Resource>> &&p_sources, const godot::Ref<LibSM64SurfaceArray> &p_surfaces) {
+	miss_count++;
+	// get_node_surfaces() may have converted the same template in the meantime, the first one is kept
+	templates.emplace(std::move(p_key), Template{ p_surfaces, std::move(p_sources) });
+}
+
+void LibSM64SurfaceTemplateCache::push_transform(TemplateKey &r_key, const godot::Transform3D &p_transform) {
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			r_key.push_back(double_bits(p_transform.basis[i][j]));
+		}
+		r_key.push_back(double_bits(p_transform.origin[i]));
+	}
+}
+
+void LibSM64SurfaceTemplateCache::push_resource(TemplateKey &r_key, std::vector<godot::Ref<godot::Resource>> &r_sources, const godot::Ref<godot::Resource> &p_resource) {
+	r_key.push_back(p_resource.is_valid() ? static_cast<uint64_t>(p_resource->get_instance_id()) : 0);
+	if (p_resource.is_valid()) {
+		r_sources.push_back(p_resource);
+	}
+}
+
+bool LibSM64SurfaceTemplateCache::make_key(godot::Node3D *p_node, const godot::Ref<LibSM64SurfaceProperties> &p_properties, TemplateKey &r_key, std::vector<godot::Ref<godot::Resource>> &r_sources) const {
+	// Surfaces are converted with the current scale factor
+	const LibSM64 *libsm64 = LibSM64::get_singleton();
+	r_key.push_back(double_bits(libsm64 != nullptr ? libsm64->get_scale_factor() : 0.0));
+	push_resource(r_key, r_sources, p_properties);
+
+	// Mirrors what LibSM64FaceExtractor reads from each node type
+	if (auto *collision_object = godot::Object::cast_to<godot::CollisionObject3D>(p_node)) {
+		r_key.push_back(TEMPLATE_SOURCE_COLLISION_OBJECT);
+		for (int64_t i = 0; i < collision_object->get_child_count(); i++) {
+			auto *collision_shape = godot::Object::cast_to<godot::CollisionShape3D>(collision_object->get_child(i));
+			if (collision_shape == nullptr || collision_shape->is_disabled() || collision_shape->get_shape().is_null()) {
+				continue;
+			}
+			push_resource(r_key, r_sources, collision_shape->get_shape());
+			push_transform(r_key, collision_shape->get_transform());
+		}
+		return true;
+	} else if (auto *collision_shape = godot::Object::cast_to<godot::CollisionShape3D>(p_node)) {
+		r_key.push_back(TEMPLATE_SOURCE_COLLISION_SHAPE);
+		r_key.push_back(collision_shape->is_disabled());
+		push_resource(r_key, r_sources, collision_shape->get_shape());
+		return true;
+	} else if (auto *mesh_instance = godot::Object::cast_to<godot::MeshInstance3D>(p_node)) {
+		r_key.push_back(TEMPLATE_SOURCE_MESH_INSTANCE);
+		push_resource(r_key, r_sources, mesh_instance->get_mesh());
+		return true;
+	} else if (auto *multi_mesh_instance = godot::Object::cast_to<godot::MultiMeshInstance3D>(p_node)) {
+		r_key.push_back(TEMPLATE_SOURCE_MULTI_MESH_INSTANCE);
+		push_resource(r_key, r_sources, multi_mesh_instance->get_multimesh());
+		return true;
+	}
+
+	return false;
+}
+
+void LibSM64SurfaceTemplateCache::_bind_methods() {
+	godot::ClassDB::bind_method(godot::D_METHOD("set_face_extractor", "value"), &LibSM64SurfaceTemplateCache::set_face_extractor);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_face_extractor"), &LibSM64SurfaceTemplateCache::get_face_extractor);
+	ADD_PROPERTY(godot::PropertyInfo(godot::Variant::OBJECT, "face_extractor"), "set_face_extractor", "get_face_extractor");
+
+	godot::ClassDB::bind_method(godot::D_METHOD("get_node_surfaces", "node", "properties"), &LibSM64SurfaceTemplateCache::get_node_surfaces, DEFVAL(godot::Variant()));
+	godot::ClassDB::bind_method(godot::D_METHOD("clear"), &LibSM64SurfaceTemplateCache::clear);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_template_count"), &LibSM64SurfaceTemplateCache::get_template_count);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_hit_count"), &LibSM64SurfaceTemplateCache::get_hit_count);
+	godot::ClassDB::bind_method(godot::D_METHOD("get_miss_count"), &LibSM64SurfaceTemplateCache::get_miss_count);
+}
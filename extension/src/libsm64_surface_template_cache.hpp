@@ -0,0 +1,63 @@
+#ifndef LIBSM64GD_LIBSM64SURFACETEMPLATECACHE_H
+#define LIBSM64GD_LIBSM64SURFACETEMPLATECACHE_H
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <godot_cpp/classes/node3d.hpp>
+#include <godot_cpp/classes/ref.hpp>
+#include <godot_cpp/classes/resource.hpp>
+
+#include <libsm64_face_extractor.hpp>
+#include <libsm64_surface_array.hpp>
+#include <libsm64_surface_properties.hpp>
+
+class LibSM64SurfaceTemplateCache : public godot::RefCounted {
+	GDCLASS(LibSM64SurfaceTemplateCache, godot::RefCounted);
+
+public:
+	LibSM64SurfaceTemplateCache();
+
+	void set_face_extractor(const godot::Ref<LibSM64FaceExtractor> &p_value);
+	godot::Ref<LibSM64FaceExtractor> get_face_extractor() const;
+
+	godot::Ref<LibSM64SurfaceArray> get_node_surfaces(godot::Node3D *p_node, const godot::Ref<LibSM64SurfaceProperties> &p_properties = godot::Ref<LibSM64SurfaceProperties>());
+	void clear();
+
+	int get_template_count() const;
+	int64_t get_hit_count() const;
+	int64_t get_miss_count() const;
+
+protected:
+	static void _bind_methods();
+
+private:
+	friend class LibSM64SurfaceObjectQueue;
+
+	// Identity of the source resources, their placement in the node, the properties and the scale factor
+	using TemplateKey = std::vector<uint64_t>;
+
+	struct Template {
+		godot::Ref<LibSM64SurfaceArray> surfaces;
+		// Keeps the keyed resources alive, so their instance IDs can't be reused by other resources
+		std::vector<godot::Ref<godot::Resource>> sources;
+	};
+
+	static void push_transform(TemplateKey &r_key, const godot::Transform3D &p_transform);
+	static void push_resource(TemplateKey &r_key, std::vector<godot::Ref<godot::Resource>> &r_sources, const godot::Ref<godot::Resource> &p_resource);
+	bool make_key(godot::Node3D *p_node, const godot::Ref<LibSM64SurfaceProperties> &p_properties, TemplateKey &r_key, std::vector<godot::Ref<godot::Resource>> &r_sources) const;
+
+	// Used by LibSM64SurfaceObjectQueue, which converts missing templates on worker threads and adds them once built
+	godot::Ref<LibSM64SurfaceArray> find_template(const TemplateKey &p_key);
+	void add_template(TemplateKey &&p_key, std::vector<godot::Ref<godot::Resource>> &&p_sources, const godot::Ref<LibSM64SurfaceArray> &p_surfaces);
+
+	godot::Ref<LibSM64FaceExtractor> face_extractor;
+	std::map<TemplateKey, Template> templates;
+	int64_t hit_count = 0;
+	int64_t miss_count = 0;
+	// Bumped by clear(), so templates converted before it aren't added back
+	uint64_t clear_count = 0;
+};
+
+#endif // LIBSM64GD_LIBSM64SURFACETEMPLATECACHE_H
@@ -0,0 +1,110 @@
+#include <libsm64_vector_math.hpp>
+
+#if !defined(REAL_T_IS_DOUBLE) && (defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64))
+#define LIBSM64GD_SIMD_SSE
+#include <emmintrin.h>
+#elif !defined(REAL_T_IS_DOUBLE) && defined(__aarch64__)
+#define LIBSM64GD_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+// The kernels treat Vector3 arrays as flat streams of 3 * count real_t
+static_assert(sizeof(godot::Vector3) == 3 * sizeof(godot::real_t), "Vector3 is expected to be tightly packed");
+
+void lerp_vector3_array(const godot::Vector3 *p_from, const godot::Vector3 *p_to, godot::Vector3 *p_out, int64_t p_count, godot::real_t p_t) {
+	const auto *from = reinterpret_cast<const godot::real_t *>(p_from);
+	const auto *to = reinterpret_cast<const godot::real_t *>(p_to);
+	auto *out = reinterpret_cast<godot::real_t *>(p_out);
+	const int64_t scalar_count = 3 * p_count;
+
+	int64_t i = 0;
+#if defined(LIBSM64GD_SIMD_SSE)
+	const __m128 t = _mm_set1_ps(p_t);
+	for (; i + 4 <= scalar_count; i += 4) {
+		const __m128 a = _mm_loadu_ps(from + i);
+		const __m128 b = _mm_loadu_ps(to + i);
+		_mm_storeu_ps(out + i, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t)));
+	}
+#elif defined(LIBSM64GD_SIMD_NEON)
+	const float32x4_t t = vdupq_n_f32(p_t);
+	for (; i + 4 <= scalar_count; i += 4) {
+		const float32x4_t a = vld1q_f32(from + i);
+		const float32x4_t b = vld1q_f32(to + i);
+		vst1q_f32(out + i, vmlaq_f32(a, vsubq_f32(b, a), t));
+	}
+#endif
+	for (; i < scalar_count; i++) {
+		out[i] = from[i] + (to[i] - from[i]) * p_t;
+	}
+}
+
+void nlerp_vector3_array(const godot::Vector3 *p_from, const godot::Vector3 *p_to, godot::Vector3 *p_out, int64_t p_count, godot::real_t p_t) {
+	int64_t i = 0;
+#if defined(LIBSM64GD_SIMD_SSE)
+	// Four vectors per iteration: three registers holding x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+	const auto *from = reinterpret_cast<const float *>(p_from);
+	const auto *to = reinterpret_cast<const float *>(p_to);
+	auto *out = reinterpret_cast<float *>(p_out);
+	const __m128 t = _mm_set1_ps(p_t);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	for (; i + 4 <= p_count; i += 4) {
+		const int64_t offset = 3 * i;
+		__m128 v[3];
+		for (int j = 0; j < 3; j++) {
+			const __m128 a = _mm_loadu_ps(from + offset + 4 * j);
+			const __m128 b = _mm_loadu_ps(to + offset + 4 * j);
+			v[j] = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+		}
+
+		// Deinterleave the squared components to get one squared length per lane
+		const __m128 s0 = _mm_mul_ps(v[0], v[0]);
+		const __m128 s1 = _mm_mul_ps(v[1], v[1]);
+		const __m128 s2 = _mm_mul_ps(v[2], v[2]);
+		const __m128 xx = _mm_shuffle_ps(s0, _mm_shuffle_ps(s1, s2, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+		const __m128 yy = _mm_shuffle_ps(_mm_shuffle_ps(s0, s1, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(s1, s2, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+		const __m128 zz = _mm_shuffle_ps(_mm_shuffle_ps(s0, s1, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(s2, s2, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+		const __m128 length_squared = _mm_add_ps(_mm_add_ps(xx, yy), zz);
+
+		// Zero-length vectors stay zero, like Vector3::normalize()
+		const __m128 nonzero = _mm_cmpgt_ps(length_squared, zero);
+		const __m128 inv_length = _mm_and_ps(_mm_div_ps(one, _mm_sqrt_ps(length_squared)), nonzero);
+
+		// Interleave the scale factors back into the xyz layout
+		_mm_storeu_ps(out + offset + 0, _mm_mul_ps(v[0], _mm_shuffle_ps(inv_length, inv_length, _MM_SHUFFLE(1, 0, 0, 0))));
+		_mm_storeu_ps(out + offset + 4, _mm_mul_ps(v[1], _mm_shuffle_ps(inv_length, inv_length, _MM_SHUFFLE(2, 2, 1, 1))));
+		_mm_storeu_ps(out + offset + 8, _mm_mul_ps(v[2], _mm_shuffle_ps(inv_length, inv_length, _MM_SHUFFLE(3, 3, 3, 2))));
+	}
+#elif defined(LIBSM64GD_SIMD_NEON)
+	// Four vectors per iteration, deinterleaved into x, y and z registers by vld3q
+	const auto *from = reinterpret_cast<const float *>(p_from);
+	const auto *to = reinterpret_cast<const float *>(p_to);
+	auto *out = reinterpret_cast<float *>(p_out);
+	const float32x4_t t = vdupq_n_f32(p_t);
+	const float32x4_t zero = vdupq_n_f32(0.0f);
+	for (; i + 4 <= p_count; i += 4) {
+		const float32x4x3_t a = vld3q_f32(from + 3 * i);
+		const float32x4x3_t b = vld3q_f32(to + 3 * i);
+		float32x4x3_t v;
+		for (int j = 0; j < 3; j++) {
+			v.val[j] = vmlaq_f32(a.val[j], vsubq_f32(b.val[j], a.val[j]), t);
+		}
+
+		float32x4_t length_squared = vmulq_f32(v.val[0], v.val[0]);
+		length_squared = vmlaq_f32(length_squared, v.val[1], v.val[1]);
+		length_squared = vmlaq_f32(length_squared, v.val[2], v.val[2]);
+
+		// Zero-length vectors stay zero, like Vector3::normalize()
+		const uint32x4_t nonzero = vcgtq_f32(length_squared, zero);
+		const float32x4_t inv_length = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(vdivq_f32(vdupq_n_f32(1.0f), vsqrtq_f32(length_squared))), nonzero));
+
+		for (int j = 0; j < 3; j++) {
+			v.val[j] = vmulq_f32(v.val[j], inv_length);
+		}
+		vst3q_f32(out + 3 * i, v);
+	}
+#endif
+	for (; i < p_count; i++) {
+		p_out[i] = p_from[i].lerp(p_to[i], p_t).normalized();
+	}
+}
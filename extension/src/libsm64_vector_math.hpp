@@ -0,0 +1,17 @@
+#ifndef LIBSM64GD_LIBSM64VECTORMATH_H
+#define LIBSM64GD_LIBSM64VECTORMATH_H
+
+#include <cstdint>
+
+#include <godot_cpp/variant/vector3.hpp>
+
+// Bulk Vector3 kernels over contiguous arrays (e.g. PackedVector3Array::ptr()).
+// The output array may alias either of the input arrays.
+
+// p_out[i] = p_from[i].lerp(p_to[i], p_t)
+void lerp_vector3_array(const godot::Vector3 *p_from, const godot::Vector3 *p_to, godot::Vector3 *p_out, int64_t p_count, godot::real_t p_t);
+
+// p_out[i] = p_from[i].lerp(p_to[i], p_t).normalized()
+void nlerp_vector3_array(const godot::Vector3 *p_from, const godot::Vector3 *p_to, godot::Vector3 *p_out, int64_t p_count, godot::real_t p_t);
+
+#endif // LIBSM64GD_LIBSM64VECTORMATH_H
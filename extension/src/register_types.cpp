@@ -3,21 +3,35 @@
 #include <gdextension_interface.h>
 
 #include <godot_cpp/classes/engine.hpp>
+#include <godot_cpp/classes/resource_loader.hpp>
+#include <godot_cpp/classes/resource_saver.hpp>
 #include <godot_cpp/core/class_db.hpp>
 #include <godot_cpp/core/defs.hpp>
 #include <godot_cpp/godot.hpp>
 
 #include <libsm64.hpp>
 #include <libsm64_audio_stream_player.hpp>
+#include <libsm64_collision_parser.hpp>
+#include <libsm64_face_extractor.hpp>
+#include <libsm64_mario_history.hpp>
 #include <libsm64_mario_inputs.hpp>
 #include <libsm64_mario_interpolator.hpp>
+#include <libsm64_mario_interpolator_batch.hpp>
 #include <libsm64_mario_state.hpp>
 #include <libsm64_surface_array.hpp>
+#include <libsm64_surface_array_loader.hpp>
+#include <libsm64_surface_array_saver.hpp>
+#include <libsm64_surface_object.hpp>
+#include <libsm64_surface_object_queue.hpp>
 #include <libsm64_surface_properties.hpp>
+#include <libsm64_surface_streamer.hpp>
+#include <libsm64_surface_template_cache.hpp>
 
 using namespace godot;
 
 static LibSM64 *s_libsm64;
+static Ref<LibSM64SurfaceArrayLoader> s_surface_array_loader;
+static Ref<LibSM64SurfaceArraySaver> s_surface_array_saver;
 
 void initialize_libsm64gd_module(ModuleInitializationLevel p_level) {
 	if (p_level != MODULE_INITIALIZATION_LEVEL_SCENE) {
@@ -28,14 +42,29 @@ void initialize_libsm64gd_module(ModuleInitializationLevel p_level) {
 
 	ClassDB::register_class<LibSM64>();
 	ClassDB::register_class<LibSM64AudioStreamPlayer>();
+	ClassDB::register_class<LibSM64CollisionParser>();
+	ClassDB::register_class<LibSM64FaceExtractor>();
+	ClassDB::register_class<LibSM64MarioHistory>();
 	ClassDB::register_class<LibSM64MarioInputs>();
 	ClassDB::register_class<LibSM64MarioInterpolator>();
+	ClassDB::register_class<LibSM64MarioInterpolatorBatch>();
 	ClassDB::register_class<LibSM64MarioState>();
 	ClassDB::register_class<LibSM64SurfaceArray>();
+	ClassDB::register_internal_class<LibSM64SurfaceArrayLoader>();
+	ClassDB::register_internal_class<LibSM64SurfaceArraySaver>();
+	ClassDB::register_class<LibSM64SurfaceObject>();
+	ClassDB::register_class<LibSM64SurfaceObjectQueue>();
 	ClassDB::register_class<LibSM64SurfaceProperties>();
+	ClassDB::register_class<LibSM64SurfaceStreamer>();
+	ClassDB::register_class<LibSM64SurfaceTemplateCache>();
 
 	s_libsm64 = memnew(LibSM64);
 	Engine::get_singleton()->register_singleton("LibSM64", LibSM64::get_singleton());
+
+	s_surface_array_loader.instantiate();
+	ResourceLoader::get_singleton()->add_resource_format_loader(s_surface_array_loader);
+	s_surface_array_saver.instantiate();
+	ResourceSaver::get_singleton()->add_resource_format_saver(s_surface_array_saver);
 }
 
 void uninitialize_libsm64gd_module(ModuleInitializationLevel p_level) {
@@ -43,6 +72,11 @@ void uninitialize_libsm64gd_module(ModuleInitializationLevel p_level) {
 		return;
 	}
 
+	ResourceLoader::get_singleton()->remove_resource_format_loader(s_surface_array_loader);
+	s_surface_array_loader.unref();
+	ResourceSaver::get_singleton()->remove_resource_format_saver(s_surface_array_saver);
+	s_surface_array_saver.unref();
+
 	Engine::get_singleton()->unregister_singleton("LibSM64");
 	memdelete(s_libsm64);
 }